@@ -1,7 +1,1852 @@
-#include "tabulate/table.hpp"
 #include "util/wsarg.h"
+#include "util/wshist.h"
+#include "util/wsjson.h"
+#include "util/wsout.h"
 #include "core/wsgeneral.h"
 #include "core/wsagent.h"
+#include "core/wsbroker.h"
+#include "core/wscache.h"
+#include "tabulate/table.hpp"
+
+static bool ParseSchedOptions(const argparse::ArgumentParser& cmd, WSvcSched& sched)
+{
+    bool isUsed = false;
+    if (cmd.is_used("--affinity")) {
+        sched.affinityMask = std::stoull(cmd.get<std::string>("--affinity"), nullptr, 0);
+        isUsed = true;
+    }
+    if (cmd.is_used("--numa")) {
+        long numaNode = std::stol(cmd.get<std::string>("--numa"));
+        sched.numaNode = numaNode < 0 ? WSvcSched::Inherit : (unsigned long)numaNode;
+        isUsed = true;
+    }
+    if (cmd.is_used("--priority")) {
+        sched.priorityClass = WSvcSched::GetPriorityClass(cmd.get<std::string>("--priority"));
+        isUsed = true;
+    }
+    if (cmd.is_used("--mem-priority")) {
+        sched.memoryPriority = WSvcSched::GetMemoryPriority(cmd.get<std::string>("--mem-priority"));
+        isUsed = true;
+    }
+    if (cmd.is_used("--io-priority")) {
+        sched.ioPriority = WSvcSched::GetIoPriority(cmd.get<std::string>("--io-priority"));
+        isUsed = true;
+    }
+    return isUsed;
+}
+
+static bool ParseLimitOptions(const argparse::ArgumentParser& cmd, WSvcLimit& limit)
+{
+    bool isUsed = false;
+    if (cmd.is_used("--mem-limit")) {
+        limit.memoryLimit = std::stoull(cmd.get<std::string>("--mem-limit")) << 20;
+        isUsed = true;
+    }
+    if (cmd.is_used("--cpu-rate")) {
+        limit.cpuRate = std::stoul(cmd.get<std::string>("--cpu-rate"));
+        isUsed = true;
+    }
+    if (cmd.is_used("--proc-limit")) {
+        limit.processLimit = std::stoul(cmd.get<std::string>("--proc-limit"));
+        isUsed = true;
+    }
+    return isUsed;
+}
+
+static bool ParseOnDemandOptions(const argparse::ArgumentParser& cmd, WSvcActivation& activation)
+{
+    bool isUsed = false;
+    if (cmd.is_used("--listen-port")) {
+        activation.listenPort = std::stoul(cmd.get<std::string>("--listen-port"));
+        isUsed = true;
+    }
+    if (cmd.is_used("--target-port")) {
+        activation.targetPort = std::stoul(cmd.get<std::string>("--target-port"));
+        isUsed = true;
+    }
+    if (cmd.is_used("--idle-timeout")) {
+        activation.idleTimeout = std::stoul(cmd.get<std::string>("--idle-timeout"));
+        isUsed = true;
+    }
+    return isUsed;
+}
+
+static bool ParseStandbyOptions(const argparse::ArgumentParser& cmd, WSvcStandby& standby)
+{
+    bool isUsed = false;
+    if (cmd.is_used("--standby")) {
+        standby.enabled = (cmd.get<std::string>("--standby") == "on");
+        isUsed = true;
+    }
+    if (cmd.is_used("--ready-file")) {
+        standby.readyFile = cmd.get<std::string>("--ready-file");
+        isUsed = true;
+    }
+    if (cmd.is_used("--ready-marker")) {
+        standby.readyMarker = cmd.get<std::string>("--ready-marker");
+        isUsed = true;
+    }
+    if (cmd.is_used("--ready-timeout")) {
+        standby.readyTimeout = std::stoul(cmd.get<std::string>("--ready-timeout"));
+        isUsed = true;
+    }
+    return isUsed;
+}
+
+enum ListColumn {
+    ListColumn_Name,
+    ListColumn_Alias,
+    ListColumn_Type,
+    ListColumn_State,
+    ListColumn_PID,
+    ListColumn_Path,
+    ListColumn_Startup,
+    ListColumn_Sched,
+    ListColumn_Desc,
+    ListColumn_Count,
+};
+
+static const char* ListColumnNames[ListColumn_Count] = {
+    "name", "alias", "type", "state", "pid", "path", "startup", "sched", "desc"
+};
+static const char* ListColumnTitles[ListColumn_Count] = {
+    "Name", "Alias", "Type", "State", "PID", "Path", "Startup", "Sched", "Desc"
+};
+static const size_t ListColumnWidths[ListColumn_Count] = {
+    30, 40, 12, 16, 8, 60, 10, 40, 60
+};
+
+struct ListQuery
+{
+    std::vector<int> columns;
+    std::string filterPath;
+    bool hasFilter;
+    bool needsConfig;
+    bool needsSched;
+    bool needsDesc;
+
+    int FindColumn(int column) const {
+        auto it = std::find(columns.begin(), columns.end(), column);
+        return (it != columns.end()) ? (int)std::distance(columns.begin(), it) : -1;
+    }
+};
+
+static std::optional<ListQuery> ParseListQuery(const argparse::ArgumentParser& cmd)
+{
+    ListQuery query;
+    if (!cmd.is_used("--columns")) {
+        for (int i = 0; i < ListColumn_Desc; i++)
+            query.columns.push_back(i);
+    } else {
+        std::stringstream ss(cmd.get<std::string>("--columns"));
+        std::string name;
+        while (std::getline(ss, name, ',')) {
+            auto it = std::find(std::begin(ListColumnNames), std::end(ListColumnNames), name);
+            if (it == std::end(ListColumnNames)) {
+                SPDLOG_ERROR("Unknown column: {}", name);
+                return std::nullopt;
+            }
+            query.columns.push_back((int)std::distance(std::begin(ListColumnNames), it));
+        }
+    }
+
+    // Only issue the SCM queries the projected columns need, status comes with the enumeration.
+    query.hasFilter = cmd.is_used("--filter-path");
+    if (query.hasFilter)
+        query.filterPath = cmd.get<std::string>("--filter-path");
+    query.needsSched = query.FindColumn(ListColumn_Sched) >= 0;
+    query.needsDesc = query.FindColumn(ListColumn_Desc) >= 0;
+    query.needsConfig = query.hasFilter || query.needsSched || query.FindColumn(ListColumn_Type) >= 0
+        || query.FindColumn(ListColumn_Path) >= 0 || query.FindColumn(ListColumn_Startup) >= 0;
+    return query;
+}
+
+static bool QueryListFields(const WSvcStatus& s, const ListQuery& query, std::vector<std::string>& fields, size_t& callNum)
+{
+    WSApp app(s.serviceName);
+    std::optional<WSvcConfig> wscopt;
+    if (query.needsConfig) {
+        wscopt = app.GetConfig(query.needsDesc);
+        callNum += query.needsDesc ? 2 : 1;
+        if (!wscopt)
+            return false;
+        if (query.hasFilter && wscopt->binaryPathName.find(query.filterPath) == std::string::npos)
+            return false;
+    }
+
+    fields[ListColumn_Name].assign(s.serviceName);
+    fields[ListColumn_Alias].assign(s.displayName);
+    fields[ListColumn_State].assign(s.GetCurrentState());
+    fields[ListColumn_PID].assign(std::to_string(s.processId));
+    if (wscopt) {
+        auto& config = wscopt.value();
+        fields[ListColumn_Type].assign(config.GetType());
+        fields[ListColumn_Path].assign(config.binaryPathName);
+        fields[ListColumn_Startup].assign(config.GetStartType());
+        fields[ListColumn_Desc].assign(config.description);
+        fields[ListColumn_Sched].clear();
+        if (query.needsSched && config.serviceType == SERVICE_WIN32_AS_SERVICE) {
+            WSAgent agent(s.serviceName);
+            fields[ListColumn_Sched].assign(agent.GetCurrentSched(s.currentState == SERVICE_RUNNING).ToString());
+            callNum++;
+        }
+    } else if (query.needsDesc) {
+        fields[ListColumn_Desc].assign(app.GetDescription().value_or(""));
+        callNum++;
+    }
+    return true;
+}
+
+static std::unique_ptr<WSTableWriter> MakeListTable(const ListQuery& query, FILE* out = stdout)
+{
+    std::vector<std::string> titles;
+    std::vector<size_t> widths;
+    for (int column : query.columns) {
+        titles.push_back(ListColumnTitles[column]);
+        widths.push_back(ListColumnWidths[column]);
+    }
+    return std::make_unique<WSTableWriter>(titles, widths, out);
+}
+
+static bool FillListFields(const WSBrokerRecord& record, const ListQuery& query, std::vector<std::string>& fields)
+{
+    if (query.hasFilter && record.binaryPathName.find(query.filterPath) == std::string::npos)
+        return false;
+
+    fields[ListColumn_Name].assign(record.serviceName);
+    fields[ListColumn_Alias].assign(record.displayName);
+    fields[ListColumn_Type].assign(WSvcBase::GetType(record.configType));
+    fields[ListColumn_State].assign(WSvcStatus::GetState(record.currentState));
+    fields[ListColumn_PID].assign(std::to_string(record.processId));
+    fields[ListColumn_Path].assign(record.binaryPathName);
+    fields[ListColumn_Startup].assign(WSvcConfig::GetStartType(record.startType));
+    fields[ListColumn_Sched].assign(record.sched);
+    fields[ListColumn_Desc].assign(record.description);
+    return true;
+}
+
+static std::vector<WSBrokerRecord> LoadServiceRecords()
+{
+    std::vector<WSBrokerRecord> records;
+    auto services = WSGeneral::Inst().GetServices();
+    records.reserve(services.size());
+    for (auto& s : services) {
+        auto wscopt = WSApp(s.serviceName).GetConfig(true);
+        if (!wscopt)
+            continue;
+
+        std::string sched;
+        if (wscopt->serviceType == SERVICE_WIN32_AS_SERVICE)
+            sched = WSAgent(s.serviceName).GetCurrentSched(s.currentState == SERVICE_RUNNING).ToString();
+        records.push_back(WSBrokerRecord::FromService(s, wscopt.value(), sched));
+    }
+    return records;
+}
+
+static void RefreshCacheDetached()
+{
+    char modulePath[MAX_PATH];
+    GetModuleFileName(NULL, modulePath, MAX_PATH);
+    std::string cmdline = fmt::format("\"{}\" list --refresh-cache", modulePath);
+
+    // A hidden console of its own, so the GUI build does not open a window and Ctrl+C here does not reach it.
+    STARTUPINFO si = {sizeof(si)};
+    PROCESS_INFORMATION pi = {};
+    if (!CreateProcess(NULL, (LPTSTR)cmdline.data(), NULL, NULL, FALSE, CREATE_NO_WINDOW | CREATE_NEW_PROCESS_GROUP,
+        NULL, NULL, &si, &pi)) {
+        SPDLOG_ERROR("CreateProcess failed! WinApi@");
+        return;
+    }
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+}
+
+static void ListServices(const argparse::ArgumentParser& cmd, const ListQuery& query)
+{
+    auto format = WSRowWriter::GetFormat(cmd.get<std::string>("--format"));
+    if (!format) {
+        SPDLOG_ERROR("Unknown format: {}", cmd.get<std::string>("--format"));
+        return;
+    }
+
+    std::vector<std::string> names;
+    for (int column : query.columns)
+        names.push_back(ListColumnNames[column]);
+    WSRowWriter writer(format.value(), names);
+    writer.WriteHeader();
+
+    auto table = MakeListTable(query);
+    std::vector<std::string> fields(ListColumn_Count);
+    auto addRow = [&](unsigned long processId) {
+        if (format.value() == WSRowWriter::Format_Table) {
+            table->AddRow();
+            for (int column : query.columns)
+                table->AddCell(fields[column], true);
+            return;
+        }
+
+        writer.BeginRow();
+        for (int column : query.columns) {
+            if (column == ListColumn_PID)
+                writer.AddField(processId);
+            else
+                writer.AddField(fields[column], true);
+        }
+        writer.EndRow();
+    };
+
+    // A running broker already holds every column, otherwise the SCM is walked here.
+    ULONGLONG startTick = GetTickCount64();
+    WSBrokerClient client;
+    std::optional<std::vector<WSBrokerRecord>> records;
+    if (!cmd.get<bool>("--no-broker") && client.Connect())
+        records = client.List();
+
+    // The cached rows are printed first, the full walk afterwards only refreshes the cache.
+    bool isCached = !records && cmd.get<bool>("--cached");
+    std::optional<uint64_t> cacheAgeMS;
+    if (isCached) {
+        WSSnapshotCache cache;
+        if (cache.Open()) {
+            records = cache.ReadAll();
+            if (records)
+                cacheAgeMS = cache.GetAgeMS();
+        }
+        if (!records)
+            records = LoadServiceRecords();
+    }
+
+    bool isTable = (format.value() == WSRowWriter::Format_Table);
+    if (records) {
+        if (isTable)
+            table->Reserve(records->size());
+        for (auto& record : records.value()) {
+            if (FillListFields(record, query, fields))
+                addRow(record.processId);
+        }
+        SPDLOG_DEBUG("List {} services from {} in {} ms.", records->size(), cacheAgeMS ? "cache" : (isCached ? "SCM" : "broker"),
+            GetTickCount64() - startTick);
+    } else {
+        size_t callNum = 1;
+        auto services = WSGeneral::Inst().GetServices();
+        if (isTable)
+            table->Reserve(services.size());
+        for (auto& s : services) {
+            if (QueryListFields(s, query, fields, callNum))
+                addRow(s.processId);
+        }
+        SPDLOG_DEBUG("List {} services with {} SCM calls in {} ms.", services.size(), callNum, GetTickCount64() - startTick);
+    }
+
+    if (isTable)
+        table->Write();
+    if (!isCached)
+        return;
+
+    // A cold cache was just filled by the walk above. A warm one is walked by a detached copy, so the
+    // command returns with the rows on screen, a cache refreshed moments ago is left alone.
+    if (!cacheAgeMS) {
+        WSSnapshotCache().Save(records.value());
+        return;
+    }
+    if (isTable)
+        SPDLOG_COUT("(cached {} s ago)", cacheAgeMS.value() / 1000);
+    if (cacheAgeMS.value() >= 5000)
+        RefreshCacheDetached();
+}
+
+static void TailLog(const argparse::ArgumentParser& cmd)
+{
+    auto name = cmd.get<std::string>("name");
+    auto lineNum = (uint32_t)std::stoul(cmd.get<std::string>("--lines"));
+    WSBrokerClient client;
+    std::optional<std::string> text;
+    if (client.Connect())
+        text = client.Tail(name, lineNum);
+    if (!text) {
+        std::filesystem::path logPath = std::filesystem::path(GetLogDirectory()) / (name + ".log");
+        std::ifstream logFile(logPath.string(), std::ios::binary);
+        std::deque<std::string> lines;
+        std::string line;
+        while (std::getline(logFile, line)) {
+            lines.push_back(line + "\n");
+            if (lines.size() > lineNum)
+                lines.pop_front();
+        }
+        text = std::string();
+        for (auto& l : lines)
+            text.value() += l;
+    }
+    fwrite(text->data(), 1, text->size(), stdout);
+}
+
+static void RunBroker(const argparse::ArgumentParser& cmd)
+{
+    WSBroker broker(std::stoul(cmd.get<std::string>("--interval")),
+        std::stoul(cmd.get<std::string>("--config-interval")));
+    broker.Run();
+}
+
+struct WatchState
+{
+    unsigned long state;
+    unsigned long processId;
+    size_t row;
+    long long changedTick;
+};
+
+using WatchFill = std::function<bool(const WSvcStatus& s, std::vector<std::string>& fields, size_t& callNum)>;
+
+// One list --watch screen. On a VT console the frame is clipped to the window and later ticks only rewrite
+// the changed rows, otherwise every tick prints the whole table again without escapes.
+class WatchView
+{
+public:
+    WatchView(const ListQuery& query, FILE* out = stdout, bool isVirtual = false)
+        : query_(query)
+        , out_(out)
+        , isVirtual_(isVirtual)
+        , stateColumn_(query.FindColumn(ListColumn_State))
+        , pidColumn_(query.FindColumn(ListColumn_PID))
+        , tick_(-1)
+        , windowRowNum_(0)
+        , fields_(ListColumn_Count) {}
+
+    bool Tick(const std::vector<WSvcStatus>& services, const WatchFill& fill, size_t windowRowNum, size_t& callNum);
+    void Flush(const std::string& status);
+
+private:
+    // Config columns are refreshed every few ticks, between them only the enumeration status is fetched.
+    static constexpr long long fullRefreshTicks = 30;
+
+    const ListQuery& query_;
+    FILE* out_;
+    bool isVirtual_;
+    int stateColumn_;
+    int pidColumn_;
+    long long tick_;
+    size_t windowRowNum_;
+    std::unique_ptr<WSTableWriter> table_;
+    std::unordered_set<std::string> known_;
+    std::unordered_map<std::string, WatchState> states_;
+    std::vector<std::string> fields_;
+};
+
+bool WatchView::Tick(const std::vector<WSvcStatus>& services, const WatchFill& fill, size_t windowRowNum,
+    size_t& callNum)
+{
+    tick_++;
+    bool isFull = !table_ || tick_ % fullRefreshTicks == 0 || services.size() != known_.size()
+        || windowRowNum != windowRowNum_
+        || std::any_of(services.begin(), services.end(), [this](const WSvcStatus& s) {
+            return !known_.count(s.serviceName);
+        });
+    windowRowNum_ = windowRowNum;
+
+    if (isFull) {
+        table_ = MakeListTable(query_, out_);
+        if (isVirtual_)
+            table_->SetColor(true);
+        // The header, its rule and the status line take three lines of the window.
+        if (table_->HasColor() && windowRowNum > 3)
+            table_->SetRowLimit(windowRowNum - 2);
+        table_->Reserve(services.size());
+        known_.clear();
+        std::unordered_map<std::string, WatchState> lastStates;
+        lastStates.swap(states_);
+        for (auto& s : services) {
+            known_.insert(s.serviceName);
+            if (!fill(s, fields_, callNum))
+                continue;
+
+            table_->AddRow();
+            for (int column : query_.columns)
+                table_->AddCell(fields_[column], true);
+
+            WatchState state{s.currentState, s.processId, table_->GetRowNum() - 1, -2};
+            auto it = lastStates.find(s.serviceName);
+            if (it != lastStates.end()) {
+                state.changedTick = it->second.changedTick;
+                if (it->second.state != s.currentState || it->second.processId != s.processId)
+                    state.changedTick = tick_;
+            }
+            states_.emplace(s.serviceName, state);
+        }
+        if (table_->HasColor())
+            table_->Append("\033[H\033[2J");
+        table_->Write();
+    } else {
+        for (auto& s : services) {
+            auto it = states_.find(s.serviceName);
+            if (it == states_.end())
+                continue;
+
+            auto& state = it->second;
+            if (state.state == s.currentState && state.processId == s.processId)
+                continue;
+
+            state.state = s.currentState;
+            state.processId = s.processId;
+            state.changedTick = tick_;
+            if (stateColumn_ >= 0)
+                table_->SetCell(state.row, stateColumn_, s.GetCurrentState());
+            if (pidColumn_ >= 0)
+                table_->SetCell(state.row, pidColumn_, std::to_string(s.processId));
+        }
+        if (!table_->HasColor())
+            table_->Write();
+    }
+    if (!table_->HasColor())
+        return isFull;
+
+    // Rows changed in this tick are highlighted, rows highlighted in the last tick are restored.
+    char text[64];
+    for (auto& [name, state] : states_) {
+        bool isChanged = (state.changedTick == tick_);
+        if (state.row >= table_->GetShownRowNum() || (!isChanged && (isFull || state.changedTick + 1 != tick_)))
+            continue;
+
+        snprintf(text, sizeof(text), "\033[%zu;1H\033[2K", state.row + 2);
+        table_->Append(text);
+        if (isChanged) {
+            table_->Append(state.state == SERVICE_RUNNING ? "\033[1;42;30m"
+                : state.state == SERVICE_STOPPED ? "\033[1;41;37m" : "\033[1;43;30m");
+        }
+        table_->AppendRow(state.row);
+        if (isChanged)
+            table_->Append("\033[0m");
+    }
+    return isFull;
+}
+
+void WatchView::Flush(const std::string& status)
+{
+    size_t shownNum = table_->GetShownRowNum();
+    if (!table_->HasColor()) {
+        table_->Append(status);
+        table_->Append("\n");
+    } else {
+        char text[64];
+        snprintf(text, sizeof(text), "\033[%zu;1H\033[2K", shownNum + 2);
+        table_->Append(text);
+        table_->Append(status);
+        if (shownNum < table_->GetRowNum())
+            table_->Append(fmt::format(", {} of {} rows shown", shownNum - 1, table_->GetRowNum() - 1));
+    }
+    table_->Flush();
+}
+
+// User and kernel time of this process in 100 ns units.
+static uint64_t GetProcessCpuTime()
+{
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+        return 0;
+    return (((uint64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime)
+        + (((uint64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime);
+}
+
+static void WatchServices(const argparse::ArgumentParser& cmd, const ListQuery& query)
+{
+    DWORD interval = (DWORD)(std::stod(cmd.get<std::string>("--interval")) * 1000);
+    WatchView view(query);
+    auto fill = [&query](const WSvcStatus& s, std::vector<std::string>& fields, size_t& callNum) {
+        return QueryListFields(s, query, fields, callNum);
+    };
+    for (;;) {
+        ULONGLONG startTick = GetTickCount64();
+        uint64_t startCpuTime = GetProcessCpuTime();
+        size_t callNum = 1;
+        auto services = WSGeneral::Inst().GetServices();
+        bool isFull = view.Tick(services, fill, WSTableWriter::GetWindowRowNum(), callNum);
+        view.Flush(fmt::format("{} {} services, {} SCM calls, {} ms, {} ms CPU, every {} ms", isFull ? "Full" : "Status",
+            services.size(), callNum, GetTickCount64() - startTick, (GetProcessCpuTime() - startCpuTime) / 10000,
+            interval));
+
+        ULONGLONG elapsed = GetTickCount64() - startTick;
+        if (elapsed < interval)
+            Sleep((DWORD)(interval - elapsed));
+    }
+}
+
+enum TopColumn {
+    TopColumn_Name,
+    TopColumn_PID,
+    TopColumn_CPU,
+    TopColumn_Memory,
+    TopColumn_IO,
+    TopColumn_ChildPID,
+    TopColumn_ChildCPU,
+    TopColumn_ChildMemory,
+    TopColumn_ChildIO,
+    TopColumn_Count,
+};
+
+static const char* TopColumnNames[TopColumn_Count] = {
+    "name", "pid", "cpu", "mem", "io", "cpid", "ccpu", "cmem", "cio"
+};
+static const char* TopColumnTitles[TopColumn_Count] = {
+    "Name", "PID", "CPU%", "Mem(MB)", "IO(KB/s)", "Child", "Child CPU%", "Child Mem(MB)", "Child IO(KB/s)"
+};
+
+struct TopRow
+{
+    const WSvcStatus* status;
+    double values[TopColumn_Count];
+};
+
+static void TopServices(const argparse::ArgumentParser& cmd)
+{
+    auto sortName = cmd.get<std::string>("--sort");
+    auto sortIt = std::find(std::begin(TopColumnNames), std::end(TopColumnNames), sortName);
+    if (sortIt == std::end(TopColumnNames)) {
+        SPDLOG_ERROR("Unknown column: {}", sortName);
+        return;
+    }
+    int sortColumn = (int)std::distance(std::begin(TopColumnNames), sortIt);
+    DWORD interval = (DWORD)(std::stod(cmd.get<std::string>("--interval")) * 1000);
+
+    // Agent services are found from their configs every few ticks, the rest is one enumeration
+    // and one process table sample per tick.
+    const long long agentRefreshTicks = 30;
+    const DWORD cpuNum = (std::max)(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS), (DWORD)1);
+    std::unordered_set<std::string> agents;
+    std::unordered_map<unsigned long, WSProcessSample> samples;
+    std::unordered_map<unsigned long, WSProcessSample> lastSamples;
+    ULONGLONG lastTick = 0;
+    std::vector<std::string> titles(std::begin(TopColumnTitles), std::end(TopColumnTitles));
+    std::vector<TopRow> rows;
+    char text[160];
+    for (long long tick = 0;; tick++) {
+        ULONGLONG startTick = GetTickCount64();
+        size_t callNum = 1;
+        auto services = WSGeneral::Inst().GetServices();
+        if (tick % agentRefreshTicks == 0) {
+            agents.clear();
+            for (auto& s : services) {
+                if (!s.processId)
+                    continue;
+                auto wscopt = WSApp(s.serviceName).GetConfig();
+                callNum++;
+                if (wscopt && wscopt->serviceType == SERVICE_WIN32_AS_SERVICE)
+                    agents.insert(s.serviceName);
+            }
+        }
+
+        lastSamples.swap(samples);
+        SampleProcesses(samples);
+        ULONGLONG sampleTick = GetTickCount64();
+        double elapsed = lastTick ? (double)(sampleTick - lastTick) / 1000 : 0;
+        lastTick = sampleTick;
+
+        auto fillUsage = [&](unsigned long processId, double* values) {
+            values[0] = processId;
+            auto it = samples.find(processId);
+            if (!processId || it == samples.end())
+                return;
+
+            values[2] = (double)it->second.workingSet / (1 << 20);
+            auto lastIt = lastSamples.find(processId);
+            if (lastIt == lastSamples.end() || elapsed <= 0)
+                return;
+            values[1] = (double)(it->second.cpuTime - lastIt->second.cpuTime) / (elapsed * 1e7 * cpuNum) * 100;
+            values[3] = (double)(it->second.ioBytes - lastIt->second.ioBytes) / 1024 / elapsed;
+        };
+
+        rows.clear();
+        for (auto& s : services) {
+            if (!s.processId)
+                continue;
+
+            TopRow row{&s, {0,}};
+            fillUsage(s.processId, &row.values[TopColumn_PID]);
+            if (agents.count(s.serviceName)) {
+                fillUsage(WSAgent(s.serviceName).GetChildPid(), &row.values[TopColumn_ChildPID]);
+                callNum++;
+            }
+            rows.push_back(row);
+        }
+
+        std::sort(rows.begin(), rows.end(), [sortColumn](const TopRow& a, const TopRow& b) {
+            if (sortColumn == TopColumn_Name)
+                return a.status->serviceName < b.status->serviceName;
+            if (sortColumn == TopColumn_PID || sortColumn == TopColumn_ChildPID)
+                return a.values[sortColumn] < b.values[sortColumn];
+            return a.values[sortColumn] > b.values[sortColumn];
+        });
+
+        WSTableWriter table(titles, {40});
+        table.SetInPlace(true);
+        table.Reserve(rows.size());
+        for (auto& row : rows) {
+            table.AddRow();
+            table.AddCell(row.status->serviceName, true);
+            for (int column = TopColumn_PID; column < TopColumn_Count; column++) {
+                bool isPid = (column == TopColumn_PID || column == TopColumn_ChildPID);
+                if (column > TopColumn_ChildPID && !row.values[TopColumn_ChildPID]) {
+                    table.AddCell("");
+                    continue;
+                }
+                snprintf(text, sizeof(text), isPid ? "%.0f" : "%.1f", row.values[column]);
+                table.AddCell(text);
+            }
+        }
+
+        snprintf(text, sizeof(text), "\033[H%zu running services, %zu SCM calls, %llu ms, sort by %s\033[K\n",
+            rows.size(), callNum, GetTickCount64() - startTick, TopColumnNames[sortColumn]);
+        table.Append(text);
+        table.Write();
+
+        ULONGLONG elapsedTick = GetTickCount64() - startTick;
+        if (elapsedTick < interval)
+            Sleep((DWORD)(interval - elapsedTick));
+    }
+}
+
+static void RunParallel(size_t jobNum, size_t taskNum, const std::function<void(size_t)>& task)
+{
+    std::atomic<size_t> nextTask = 0;
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < (std::min)(jobNum, taskNum); i++) {
+        workers.emplace_back([&] {
+            for (size_t index; (index = nextTask++) < taskNum;)
+                task(index);
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+}
+
+struct BatchCommand
+{
+    size_t line;
+    std::string name;
+    std::vector<std::string> args;
+};
+
+static std::vector<std::string> SplitBatchLine(const std::string& line)
+{
+    std::vector<std::string> args;
+    std::string arg;
+    bool isQuoted = false;
+    bool hasArg = false;
+    for (char c : line) {
+        if (c == '"') {
+            isQuoted = !isQuoted;
+            hasArg = true;
+        } else if (!isQuoted && (c == ' ' || c == '\t' || c == '\r')) {
+            if (hasArg)
+                args.push_back(arg);
+            arg.clear();
+            hasArg = false;
+        } else {
+            arg += c;
+            hasArg = true;
+        }
+    }
+    if (hasArg)
+        args.push_back(arg);
+    return args;
+}
+
+static std::string GetBatchOption(const std::vector<std::string>& args, const std::string& shortName, const std::string& longName)
+{
+    for (size_t i = 1; i + 1 < args.size(); i++) {
+        if (args[i] == shortName || args[i] == longName)
+            return args[i + 1];
+    }
+    return "";
+}
+
+static std::string GetBatchName(const std::vector<std::string>& args)
+{
+    if (args[0] == "install")
+        return GetBatchOption(args, "-n", "--name");
+    return (args.size() > 1) ? args[1] : "";
+}
+
+static std::pair<bool, DWORD> RunBatchCommand(const std::vector<std::string>& args)
+{
+    auto& action = args[0];
+    if (action == "install") {
+        auto name = GetBatchOption(args, "-n", "--name");
+        auto alias = GetBatchOption(args, "-s", "--alias");
+        auto desc = GetBatchOption(args, "-d", "--desc");
+        auto path = GetBatchOption(args, "-p", "--path");
+        bool isAgent = std::find(args.begin(), args.end(), "-a") != args.end()
+            || std::find(args.begin(), args.end(), "--agent") != args.end();
+        if (name.empty() || path.empty()) {
+            SPDLOG_ERROR("install needs --name and --path.");
+            return {false, ERROR_INVALID_PARAMETER};
+        }
+
+        std::unique_ptr<WSApp> app = isAgent ? std::make_unique<WSAgent>(name, alias) : std::make_unique<WSApp>(name, alias);
+        if (!app->Install(path))
+            return app->Result(false);
+        return app->Result(desc.empty() || app->SetDescription(desc));
+    }
+
+    if (args.size() < 2) {
+        SPDLOG_ERROR("{} needs a service name.", action);
+        return {false, ERROR_INVALID_PARAMETER};
+    }
+
+    WSApp app(args[1]);
+    if (action == "uninstall") {
+        return app.Result(app.Uninstall());
+    } else if (action == "start") {
+        return app.Result(app.Start());
+    } else if (action == "stop") {
+        return app.Result(app.Stop(10000));
+    } else if (action == "set-startup") {
+        DWORD startType = (args.size() > 2) ? WSvcConfig::GetStartType(args[2]) : 0;
+        if (!startType && (args.size() < 3 || args[2] != "Boot")) {
+            SPDLOG_ERROR("set-startup needs Boot|System|Automatic|Manual|Disabled.");
+            return {false, ERROR_INVALID_PARAMETER};
+        }
+        return app.Result(app.SetStartup(startType));
+    }
+
+    SPDLOG_ERROR("Unknown batch command: {}", action);
+    return {false, ERROR_INVALID_FUNCTION};
+}
+
+static void RunBatch(const argparse::ArgumentParser& cmd)
+{
+    auto file = cmd.get<std::string>("--file");
+    size_t jobNum = (std::max)(std::stoul(cmd.get<std::string>("--jobs")), 1ul);
+    std::ifstream fs;
+    std::istream* in = &std::cin;
+    if (file != "-") {
+        fs.open(file);
+        if (!fs) {
+            SPDLOG_ERROR("Open {} failed!", file);
+            return;
+        }
+        in = &fs;
+    }
+
+    // A wait line is a barrier between stages, inside a stage only the lines of one service keep their order.
+    std::vector<std::vector<std::vector<BatchCommand>>> stages(1);
+    std::unordered_map<std::string, size_t> groups;
+    std::string line;
+    for (size_t lineNum = 1; std::getline(*in, line); lineNum++) {
+        auto args = SplitBatchLine(line);
+        if (args.empty() || args[0][0] == '#')
+            continue;
+
+        if (args[0] == "wait") {
+            if (!stages.back().empty())
+                stages.emplace_back();
+            groups.clear();
+            continue;
+        }
+
+        BatchCommand command{lineNum, GetBatchName(args), std::move(args)};
+        auto key = command.name.empty() ? "#" + std::to_string(lineNum) : command.name;
+        auto it = groups.find(key);
+        if (it == groups.end()) {
+            it = groups.emplace(key, stages.back().size()).first;
+            stages.back().emplace_back();
+        }
+        stages.back()[it->second].push_back(std::move(command));
+    }
+
+    if (!WSHandle::OpenShared())
+        return;
+
+    WSRowWriter writer(WSRowWriter::Format_NDJson, {"line", "command", "name", "ok", "error", "ms"});
+    std::mutex writerMutex;
+    std::atomic<size_t> failedNum = 0;
+    size_t commandNum = 0;
+    for (auto& stage : stages) {
+        RunParallel(jobNum, stage.size(), [&](size_t group) {
+            for (auto& command : stage[group]) {
+                ULONGLONG startTick = GetTickCount64();
+                auto [isOK, lastError] = RunBatchCommand(command.args);
+                unsigned long elapsed = (unsigned long)(GetTickCount64() - startTick);
+                if (!isOK)
+                    failedNum++;
+
+                std::lock_guard<std::mutex> lock(writerMutex);
+                writer.BeginRow();
+                writer.AddField((unsigned long)command.line);
+                writer.AddField(command.args[0], true);
+                writer.AddField(command.name, true);
+                writer.AddFlag(isOK);
+                writer.AddField(lastError);
+                writer.AddField(elapsed);
+                writer.EndRow();
+            }
+        });
+        for (auto& group : stage)
+            commandNum += group.size();
+    }
+
+    WSHandle::CloseShared();
+    SPDLOG_DEBUG("Batch {} commands in {} stages, {} failed.", commandNum, stages.size(), failedNum.load());
+}
+
+struct ApplyService
+{
+    std::string name;
+    std::string alias;
+    std::string path;
+    std::string startup;
+    std::string description;
+    std::string dependencies;
+    bool isAgent = false;
+    bool hasDependencies = false;
+};
+
+struct ApplyChange
+{
+    size_t service;
+    bool isInstall;
+    std::vector<std::string> fields;
+};
+
+static std::string ToLower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)tolower(c); });
+    return text;
+}
+
+static std::optional<std::vector<ApplyService>> LoadManifest(const std::string& path)
+{
+    std::ifstream fs(path, std::ios::binary);
+    if (!fs) {
+        SPDLOG_ERROR("Open {} failed!", path);
+        return std::nullopt;
+    }
+
+    std::stringstream ss;
+    ss << fs.rdbuf();
+    std::string error;
+    auto json = WSJson::Parse(ss.str(), error);
+    if (!json) {
+        SPDLOG_ERROR("Parse {} failed: {}", path, error);
+        return std::nullopt;
+    }
+
+    const WSJson* list = (json->GetType() == WSJson::Type_Array) ? &json.value() : json->Find("services");
+    if (!list || list->GetType() != WSJson::Type_Array) {
+        SPDLOG_ERROR("{} needs a services array.", path);
+        return std::nullopt;
+    }
+
+    // Manifests are UTF-8, the SCM api here takes the ANSI code page.
+    auto getText = [](const WSJson& item, const std::string& key) {
+        auto value = item.Find(key);
+        return (value && value->GetType() == WSJson::Type_String) ? Utf8ToAnsi(value->GetString()) : "";
+    };
+
+    std::vector<ApplyService> services;
+    std::unordered_set<std::string> names;
+    for (auto& item : list->GetArray()) {
+        ApplyService service;
+        service.name = getText(item, "name");
+        service.alias = getText(item, "alias");
+        service.path = getText(item, "path");
+        service.startup = getText(item, "startup");
+        service.description = getText(item, "description");
+        auto agent = item.Find("agent");
+        service.isAgent = agent && agent->GetBool();
+
+        auto dependencies = item.Find("dependencies");
+        service.hasDependencies = (dependencies != nullptr);
+        if (dependencies && dependencies->GetType() == WSJson::Type_String)
+            service.dependencies = Utf8ToAnsi(dependencies->GetString());
+        else if (dependencies) {
+            for (auto& dependency : dependencies->GetArray()) {
+                if (!service.dependencies.empty())
+                    service.dependencies += '/';
+                service.dependencies += Utf8ToAnsi(dependency.GetString());
+            }
+        }
+
+        if (service.name.empty()) {
+            SPDLOG_ERROR("{} has a service without name.", path);
+            return std::nullopt;
+        }
+        if (!names.insert(ToLower(service.name)).second) {
+            SPDLOG_ERROR("{} has duplicated service: {}", path, service.name);
+            return std::nullopt;
+        }
+        if (!service.startup.empty() && !WSvcConfig::GetStartType(service.startup) && service.startup != "Boot") {
+            SPDLOG_ERROR("{} has unknown startup of {}: {}", path, service.name, service.startup);
+            return std::nullopt;
+        }
+        services.push_back(std::move(service));
+    }
+    return services;
+}
+
+static std::optional<std::vector<size_t>> GetApplyLevels(const std::vector<ApplyService>& services)
+{
+    // A service is applied one level after the manifest services it depends on.
+    std::unordered_map<std::string, size_t> indexes;
+    for (size_t i = 0; i < services.size(); i++)
+        indexes[ToLower(services[i].name)] = i;
+
+    std::vector<size_t> levels(services.size(), 0);
+    std::vector<int> marks(services.size(), 0);
+    std::function<bool(size_t)> visit = [&](size_t i) {
+        if (marks[i] == 2)
+            return true;
+        if (marks[i] == 1) {
+            SPDLOG_ERROR("Dependency cycle at {}", services[i].name);
+            return false;
+        }
+
+        marks[i] = 1;
+        std::stringstream ss(services[i].dependencies);
+        std::string dependency;
+        while (std::getline(ss, dependency, '/')) {
+            auto it = indexes.find(ToLower(dependency));
+            if (it == indexes.end())
+                continue;
+            if (!visit(it->second))
+                return false;
+            levels[i] = (std::max)(levels[i], levels[it->second] + 1);
+        }
+        marks[i] = 2;
+        return true;
+    };
+
+    for (size_t i = 0; i < services.size(); i++) {
+        if (!visit(i))
+            return std::nullopt;
+    }
+    return levels;
+}
+
+using ApplyConfigQuery = std::function<std::optional<WSvcConfig>(const std::string&)>;
+
+static std::vector<ApplyChange> DiffManifest(const std::vector<ApplyService>& services,
+    const std::vector<WSvcStatus>& statuses, const ApplyConfigQuery& getConfig)
+{
+    // One enumeration decides what exists, configs are only read for those manifest services.
+    std::unordered_set<std::string> installed;
+    for (auto& s : statuses)
+        installed.insert(ToLower(s.serviceName));
+
+    std::vector<ApplyChange> changes;
+    for (size_t i = 0; i < services.size(); i++) {
+        auto& service = services[i];
+        if (!installed.count(ToLower(service.name))) {
+            changes.push_back({i, true, {}});
+            continue;
+        }
+
+        auto wscopt = getConfig(service.name);
+        if (!wscopt)
+            continue;
+
+        auto& config = wscopt.value();
+        bool isAgent = (config.serviceType == SERVICE_WIN32_AS_SERVICE);
+        std::string command = isAgent ? WSAgent::GetPath(config.binaryPathName) : config.binaryPathName;
+        ApplyChange change{i, false, {}};
+        if (!service.path.empty() && (isAgent != service.isAgent || command != service.path))
+            change.fields.push_back("path");
+        if (!service.alias.empty() && service.alias != config.displayName)
+            change.fields.push_back("alias");
+        if (!service.startup.empty() && WSvcConfig::GetStartType(service.startup) != config.startType)
+            change.fields.push_back("startup");
+        if (!service.description.empty() && service.description != config.description)
+            change.fields.push_back("description");
+        if (service.hasDependencies && ToLower(service.dependencies) != ToLower(config.dependencies))
+            change.fields.push_back("dependencies");
+        if (!change.fields.empty())
+            changes.push_back(std::move(change));
+    }
+    return changes;
+}
+
+static std::pair<bool, DWORD> ApplyServiceChange(const ApplyService& service, const ApplyChange& change)
+{
+    std::unique_ptr<WSApp> app = service.isAgent ? std::make_unique<WSAgent>(service.name, service.alias)
+        : std::make_unique<WSApp>(service.name, service.alias);
+    if (change.isInstall) {
+        if (service.path.empty()) {
+            SPDLOG_ERROR("Install {} needs a path.", service.name);
+            return {false, ERROR_INVALID_PARAMETER};
+        }
+        return app->Result(app->Install(service.path)
+            && (service.description.empty() || app->SetDescription(service.description))
+            && (service.startup.empty() || app->SetStartup(WSvcConfig::GetStartType(service.startup)))
+            && (!service.hasDependencies || app->SetDependencies(service.dependencies)));
+    }
+
+    // Every field is tried, the error reported is the one of the last field that failed.
+    bool isOK = true;
+    DWORD lastError = NO_ERROR;
+    for (auto& field : change.fields) {
+        bool isFieldOK = true;
+        if (field == "path")
+            isFieldOK = app->SetPath(service.path);
+        else if (field == "alias")
+            isFieldOK = app->SetAlias(service.alias);
+        else if (field == "startup")
+            isFieldOK = app->SetStartup(WSvcConfig::GetStartType(service.startup));
+        else if (field == "description")
+            isFieldOK = app->SetDescription(service.description);
+        else if (field == "dependencies")
+            isFieldOK = app->SetDependencies(service.dependencies);
+        if (!isFieldOK) {
+            isOK = false;
+            lastError = app->GetError();
+        }
+    }
+    return {isOK, lastError};
+}
+
+static void ApplyManifest(const argparse::ArgumentParser& cmd)
+{
+    ULONGLONG startTick = GetTickCount64();
+    auto manifest = cmd.get<std::string>("manifest");
+    auto services = LoadManifest(manifest);
+    if (!services)
+        return;
+
+    auto levels = GetApplyLevels(services.value());
+    if (!levels)
+        return;
+
+    if (!WSHandle::OpenShared())
+        return;
+
+    auto changes = DiffManifest(services.value(), WSGeneral::Inst().GetServices(), [](const std::string& name) {
+        return WSApp(name).GetConfig(true);
+    });
+    size_t installNum = 0;
+    for (auto& change : changes) {
+        auto& service = services->at(change.service);
+        if (change.isInstall) {
+            installNum++;
+            SPDLOG_COUT("+ {} ({}) {}", service.name, service.isAgent ? "agent" : "app", service.path);
+            continue;
+        }
+
+        std::string fields;
+        for (auto& field : change.fields)
+            fields += (fields.empty() ? "" : ", ") + field;
+        SPDLOG_COUT("~ {}: {}", service.name, fields);
+    }
+    SPDLOG_COUT("Plan: {} to install, {} to change, {} unchanged.", installNum, changes.size() - installNum,
+        services->size() - changes.size());
+
+    if (cmd.get<bool>("--dry-run") || changes.empty()) {
+        WSHandle::CloseShared();
+        return;
+    }
+
+    // Changes of one level run in parallel, a level starts after the ones it depends on.
+    size_t jobNum = (std::max)(std::stoul(cmd.get<std::string>("--jobs")), 1ul);
+    size_t maxLevel = 0;
+    for (auto& change : changes)
+        maxLevel = (std::max)(maxLevel, levels->at(change.service));
+
+    std::atomic<size_t> failedNum = 0;
+    for (size_t level = 0; level <= maxLevel; level++) {
+        std::vector<const ApplyChange*> levelChanges;
+        for (auto& change : changes) {
+            if (levels->at(change.service) == level)
+                levelChanges.push_back(&change);
+        }
+
+        RunParallel(jobNum, levelChanges.size(), [&](size_t index) {
+            auto& change = *levelChanges[index];
+            auto& service = services->at(change.service);
+            auto [isOK, lastError] = ApplyServiceChange(service, change);
+            if (isOK) {
+                SPDLOG_COUT("done {}", service.name);
+            } else {
+                failedNum++;
+                SPDLOG_COUT("failed {} ({})", service.name, lastError);
+            }
+        });
+    }
+
+    WSHandle::CloseShared();
+    SPDLOG_COUT("Applied {} changes, {} failed, in {} ms.", changes.size(), failedNum.load(), GetTickCount64() - startTick);
+}
+
+#define BENCH_SCRATCH_NAME "winsvc-bench"
+
+// Scenarios run against this interface, so the simulated backend separates tool cost from SCM cost.
+class BenchBackend
+{
+public:
+    virtual ~BenchBackend() {}
+    virtual const char* GetName() const = 0;
+    virtual std::vector<WSvcStatus> GetServices() = 0;
+    virtual std::optional<WSvcConfig> GetConfig(const std::string& name) = 0;
+    virtual bool OpenService(const std::string& name) = 0;
+    virtual bool HasScratch() const = 0;
+    virtual bool InstallScratch() = 0;
+    virtual bool StartStop() = 0;
+    virtual void UninstallScratch() = 0;
+    virtual bool HasBroker() const = 0;
+};
+
+class ScmBenchBackend final : public BenchBackend
+{
+public:
+    const char* GetName() const override { return "scm"; }
+    std::vector<WSvcStatus> GetServices() override { return WSGeneral::Inst().GetServices(); }
+    std::optional<WSvcConfig> GetConfig(const std::string& name) override { return WSApp(name).GetConfig(true); }
+
+    bool OpenService(const std::string& name) override {
+        WSHandle handle(SC_MANAGER_CONNECT, SERVICE_QUERY_STATUS, name);
+        return handle.Service != NULL;
+    }
+
+    bool HasScratch() const override { return true; }
+
+    bool InstallScratch() override {
+        // A scratch service left by an interrupted run is reused after it is stopped.
+        auto services = WSGeneral::Inst().GetServices();
+        auto it = std::find_if(services.begin(), services.end(), [](const WSvcStatus& s) {
+            return s.serviceName == BENCH_SCRATCH_NAME;
+        });
+        if (it != services.end()) {
+            SPDLOG_INFO("Reuse scratch service {}.", BENCH_SCRATCH_NAME);
+            return it->currentState == SERVICE_STOPPED || WSAgent(BENCH_SCRATCH_NAME).Stop(10000);
+        }
+
+        // The agent keeps a long ping alive, so a round trip covers the SCM and the agent.
+        return WSAgent(BENCH_SCRATCH_NAME, "Winsvc Bench").Install("ping.exe -n 86400 127.0.0.1");
+    }
+
+    bool StartStop() override {
+        WSAgent agent(BENCH_SCRATCH_NAME);
+        return agent.Start() && agent.Stop(10000);
+    }
+
+    void UninstallScratch() override { WSAgent(BENCH_SCRATCH_NAME).Uninstall(); }
+    bool HasBroker() const override { return true; }
+};
+
+class SimulatedBenchBackend final : public BenchBackend
+{
+public:
+    SimulatedBenchBackend(size_t serviceNum) {
+        static const DWORD states[] = {SERVICE_STOPPED, SERVICE_RUNNING, SERVICE_PAUSED, SERVICE_START_PENDING};
+        static const DWORD startTypes[] = {SERVICE_AUTO_START, SERVICE_DEMAND_START, SERVICE_DISABLED};
+        for (size_t i = 0; i < serviceNum; i++) {
+            std::string name = fmt::format("bench-svc-{:06}", i);
+            std::string path = fmt::format("C:\\bench\\app{}.exe --id {}", i % 97, i);
+            std::string desc = fmt::format("Simulated service {} for bench", i);
+            std::string displayName = "Bench " + name;
+
+            SERVICE_STATUS_PROCESS ssp = {};
+            ssp.dwServiceType = SERVICE_WIN32_OWN_PROCESS;
+            ssp.dwCurrentState = states[i % 4];
+            ssp.dwProcessId = (ssp.dwCurrentState == SERVICE_RUNNING) ? (DWORD)(1000 + i) : 0;
+            statuses_.emplace_back(name, displayName, ssp);
+
+            QUERY_SERVICE_CONFIG qsc = {};
+            qsc.dwServiceType = SERVICE_WIN32_OWN_PROCESS;
+            qsc.dwStartType = startTypes[i % 3];
+            qsc.lpBinaryPathName = path.data();
+            qsc.lpDisplayName = displayName.data();
+            SERVICE_DESCRIPTION sd = {};
+            sd.lpDescription = desc.data();
+            configs_.emplace_back(name, qsc, sd);
+            indexes_[name] = i;
+        }
+    }
+
+    const char* GetName() const override { return "simulated"; }
+    std::vector<WSvcStatus> GetServices() override { return statuses_; }
+
+    std::optional<WSvcConfig> GetConfig(const std::string& name) override {
+        auto it = indexes_.find(name);
+        if (it == indexes_.end())
+            return std::nullopt;
+        return configs_[it->second];
+    }
+
+    bool OpenService(const std::string& name) override { return indexes_.count(name) > 0; }
+
+    // Start and stop time is spent in the SCM and the command, nothing here would model it.
+    bool HasScratch() const override { return false; }
+    bool InstallScratch() override { return false; }
+    bool StartStop() override { return false; }
+    void UninstallScratch() override {}
+    bool HasBroker() const override { return false; }
+
+private:
+    std::vector<WSvcStatus> statuses_;
+    std::vector<WSvcConfig> configs_;
+    std::unordered_map<std::string, size_t> indexes_;
+};
+
+struct BenchResult
+{
+    std::string name;
+    WSHistogram histogram;
+    uint64_t failedNum = 0;
+    uint64_t byteNum = 0;
+    double elapsedMS = 0.0;
+};
+
+static void RunBenchLoop(BenchResult& result, size_t iterationNum, const std::function<bool()>& op,
+    const std::function<bool()>& prepare = nullptr)
+{
+    // Only the operations are timed, an untimed prepare step puts each one back in its starting state.
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    LONGLONG elapsed = 0;
+    for (size_t i = 0; i < iterationNum; i++) {
+        if (prepare && !prepare()) {
+            result.failedNum++;
+            continue;
+        }
+        QueryPerformanceCounter(&start);
+        bool isOK = op();
+        QueryPerformanceCounter(&end);
+        elapsed += end.QuadPart - start.QuadPart;
+        result.histogram.Record((uint64_t)(end.QuadPart - start.QuadPart) * 1000000000 / frequency.QuadPart);
+        if (!isOK)
+            result.failedNum++;
+    }
+    result.elapsedMS = elapsed * 1000.0 / frequency.QuadPart;
+}
+
+#define BENCH_ONDEMAND_NAME "winsvc-bench-ondemand"
+#define BENCH_ONDEMAND_LISTEN_PORT 18471
+#define BENCH_ONDEMAND_TARGET_PORT 18472
+
+static SOCKET ConnectLoopback(unsigned long port)
+{
+    sockaddr_in addr;
+    ZeroMemory(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((u_short)port);
+    SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s != INVALID_SOCKET && connect(s, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
+        closesocket(s);
+        return INVALID_SOCKET;
+    }
+    return s;
+}
+
+static bool EchoRoundTrip(SOCKET s, const std::string& payload, std::string& reply)
+{
+    for (size_t sent = 0; sent < payload.size();) {
+        int n = send(s, payload.data() + sent, (int)(payload.size() - sent), 0);
+        if (n <= 0)
+            return false;
+        sent += n;
+    }
+    reply.resize(payload.size());
+    for (size_t received = 0; received < reply.size();) {
+        int n = recv(s, reply.data() + received, (int)(reply.size() - received), 0);
+        if (n <= 0)
+            return false;
+        received += n;
+    }
+    return reply == payload;
+}
+
+// The command of the on-demand scratch agent, it echoes each connection until the peer closes it.
+static void RunEchoServer(unsigned long port)
+{
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        SPDLOG_ERROR("WSAStartup failed! WinApi@");
+        return;
+    }
+
+    sockaddr_in addr;
+    ZeroMemory(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((u_short)port);
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener == INVALID_SOCKET
+        || bind(listener, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR
+        || listen(listener, SOMAXCONN) == SOCKET_ERROR) {
+        SPDLOG_ERROR("Echo listen on 127.0.0.1:{} failed! WinApi@", port);
+        return;
+    }
+
+    for (SOCKET client; (client = accept(listener, NULL, NULL)) != INVALID_SOCKET;) {
+        std::thread([client] {
+            char buffer[8192];
+            bool isOpen = true;
+            for (int size; isOpen && (size = recv(client, buffer, sizeof(buffer), 0)) > 0;) {
+                for (int sent = 0, n; isOpen && sent < size; sent += n)
+                    isOpen = (n = send(client, buffer + sent, size - sent, 0)) > 0;
+            }
+            closesocket(client);
+        }).detach();
+    }
+    closesocket(listener);
+}
+
+static bool InstallOnDemandScratch()
+{
+    char modulePath[MAX_PATH];
+    GetModuleFileName(NULL, modulePath, MAX_PATH);
+    std::string command = fmt::format("\"{}\" bench --echo {}", modulePath, BENCH_ONDEMAND_TARGET_PORT);
+
+    // A scratch service left by an interrupted run is stopped and pointed at this build.
+    WSAgent agent(BENCH_ONDEMAND_NAME, "Winsvc Bench On Demand");
+    auto services = WSGeneral::Inst().GetServices();
+    auto it = std::find_if(services.begin(), services.end(), [](const WSvcStatus& s) {
+        return s.serviceName == BENCH_ONDEMAND_NAME;
+    });
+    if (it != services.end()) {
+        SPDLOG_INFO("Reuse scratch service {}.", BENCH_ONDEMAND_NAME);
+        if ((it->currentState != SERVICE_STOPPED && !agent.Stop(10000)) || !agent.SetPath(command))
+            return false;
+    } else if (!agent.Install(command)) {
+        return false;
+    }
+
+    WSvcActivation activation;
+    activation.listenPort = BENCH_ONDEMAND_LISTEN_PORT;
+    activation.targetPort = BENCH_ONDEMAND_TARGET_PORT;
+    return agent.SetActivation(activation);
+}
+
+static std::optional<BenchResult> RunBenchScenario(BenchBackend& backend, const std::string& name, size_t iterationNum)
+{
+    BenchResult result;
+    result.name = name;
+    if (name == "enumerate") {
+        RunBenchLoop(result, iterationNum, [&] { return !backend.GetServices().empty(); });
+    } else if (name == "config") {
+        // One operation is a full pass, like list with every column.
+        RunBenchLoop(result, iterationNum, [&] {
+            bool isOK = true;
+            for (auto& s : backend.GetServices())
+                isOK = backend.GetConfig(s.serviceName).has_value() && isOK;
+            return isOK;
+        });
+    } else if (name == "list-cold" || name == "list-broker") {
+        // One operation is the rows of list, walked here or answered by a running broker.
+        bool isBroker = (name == "list-broker");
+        if (isBroker && (!backend.HasBroker() || !WSBrokerClient().Connect())) {
+            SPDLOG_ERROR("Scenario list-broker needs a running broker, start winsvc broker first.");
+            return std::nullopt;
+        }
+        RunBenchLoop(result, iterationNum, [&] {
+            std::vector<WSBrokerRecord> records;
+            if (isBroker) {
+                WSBrokerClient client;
+                auto listed = client.Connect() ? client.List() : std::nullopt;
+                if (!listed)
+                    return false;
+                records = std::move(listed.value());
+            } else {
+                for (auto& s : backend.GetServices()) {
+                    auto wscopt = backend.GetConfig(s.serviceName);
+                    if (wscopt)
+                        records.push_back(WSBrokerRecord::FromService(s, wscopt.value(), ""));
+                }
+            }
+            return !records.empty();
+        });
+    } else if (name == "list-cached" || name == "list-cached-cold") {
+        // Time to first paint of list --cached: the table from a warm cache file, or the walk that fills a
+        // cold one first. The cache is a scratch file, the one the GUI and list use is not touched.
+        FILE* null = fopen("NUL", "wb");
+        if (!null)
+            return std::nullopt;
+
+        ListQuery query = {};
+        for (int i = 0; i < ListColumn_Count; i++)
+            query.columns.push_back(i);
+        auto walk = [&] {
+            std::vector<WSBrokerRecord> records;
+            for (auto& s : backend.GetServices()) {
+                auto wscopt = backend.GetConfig(s.serviceName);
+                if (wscopt)
+                    records.push_back(WSBrokerRecord::FromService(s, wscopt.value(), ""));
+            }
+            return records;
+        };
+
+        bool isCold = (name == "list-cached-cold");
+        std::string cachePath = (std::filesystem::temp_directory_path() / "winsvc-bench-cache.bin").string();
+        if (!isCold && !WSSnapshotCache(cachePath).Save(walk())) {
+            fclose(null);
+            return std::nullopt;
+        }
+        std::vector<std::string> fields(ListColumn_Count);
+        RunBenchLoop(result, iterationNum, [&] {
+            std::optional<std::vector<WSBrokerRecord>> records;
+            WSSnapshotCache cache(cachePath);
+            if (!isCold && cache.Open())
+                records = cache.ReadAll();
+            if (isCold)
+                records = walk();
+            if (!records)
+                return false;
+
+            auto table = MakeListTable(query, null);
+            table->Reserve(records->size());
+            for (auto& record : records.value()) {
+                if (!FillListFields(record, query, fields))
+                    continue;
+                table->AddRow();
+                for (int column : query.columns)
+                    table->AddCell(fields[column], true);
+            }
+            table->Write();
+            return !isCold || cache.Save(records.value());
+        });
+        fclose(null);
+        std::error_code ec;
+        std::filesystem::remove(cachePath, ec);
+    } else if (name == "apply") {
+        // A manifest of the current services, so one operation is the load and diff of a no-op apply.
+        auto escape = [](const std::string& text) {
+            std::string escaped;
+            for (char c : AnsiToUtf8(text)) {
+                if (c == '\\' || c == '"')
+                    escaped += '\\';
+                if ((unsigned char)c >= 0x20)
+                    escaped += c;
+            }
+            return escaped;
+        };
+        std::string manifest = "[\n";
+        for (auto& s : backend.GetServices()) {
+            auto wscopt = backend.GetConfig(s.serviceName);
+            if (!wscopt)
+                continue;
+            auto& config = wscopt.value();
+            bool isAgent = (config.serviceType == SERVICE_WIN32_AS_SERVICE);
+            manifest += fmt::format("{}{{\"name\": \"{}\", \"alias\": \"{}\", \"path\": \"{}\", \"agent\": {}, "
+                "\"startup\": \"{}\", \"description\": \"{}\"}}", manifest.size() > 2 ? ",\n" : "",
+                escape(s.serviceName), escape(config.displayName),
+                escape(isAgent ? WSAgent::GetPath(config.binaryPathName) : config.binaryPathName),
+                isAgent ? "true" : "false", config.GetStartType(), escape(config.description));
+        }
+        manifest += "\n]\n";
+
+        std::filesystem::path manifestPath = std::filesystem::temp_directory_path() / "winsvc-bench-apply.json";
+        std::ofstream(manifestPath.string(), std::ios::binary) << manifest;
+        RunBenchLoop(result, iterationNum, [&] {
+            auto services = LoadManifest(manifestPath.string());
+            if (!services || !GetApplyLevels(services.value()))
+                return false;
+            auto changes = DiffManifest(services.value(), backend.GetServices(), [&](const std::string& name) {
+                return backend.GetConfig(name);
+            });
+            return changes.empty();
+        });
+        result.byteNum = manifest.size() * iterationNum;
+        std::error_code ec;
+        std::filesystem::remove(manifestPath, ec);
+    } else if (name == "list-stream" || name == "list-stream-first") {
+        // list --format ndjson into the null device, stopped at the first row for the time-to-first-row.
+        FILE* null = fopen("NUL", "wb");
+        if (!null)
+            return std::nullopt;
+
+        ListQuery query = {};
+        std::vector<std::string> names;
+        for (int i = 0; i < ListColumn_Count; i++) {
+            query.columns.push_back(i);
+            names.push_back(ListColumnNames[i]);
+        }
+        bool isFirstOnly = (name == "list-stream-first");
+        std::vector<std::string> fields(ListColumn_Count);
+        RunBenchLoop(result, iterationNum, [&] {
+            WSRowWriter writer(WSRowWriter::Format_NDJson, names, null);
+            size_t rowNum = 0;
+            for (auto& s : backend.GetServices()) {
+                auto wscopt = backend.GetConfig(s.serviceName);
+                if (!wscopt || !FillListFields(WSBrokerRecord::FromService(s, wscopt.value(), ""), query, fields))
+                    continue;
+                writer.BeginRow();
+                for (int column : query.columns) {
+                    if (column == ListColumn_PID)
+                        writer.AddField(s.processId);
+                    else
+                        writer.AddField(fields[column], true);
+                }
+                writer.EndRow();
+                if (++rowNum == 1 && isFirstOnly)
+                    break;
+            }
+            return rowNum > 0;
+        });
+        fclose(null);
+    } else if (name == "table-render" || name == "table-render-tabulate") {
+        // One operation lays out every service as list does, the table goes to the null device.
+        ListQuery query = {};
+        for (int i = 0; i < ListColumn_Count; i++)
+            query.columns.push_back(i);
+        std::vector<std::vector<std::string>> rows;
+        std::vector<std::string> fields(ListColumn_Count);
+        for (auto& s : backend.GetServices()) {
+            auto wscopt = backend.GetConfig(s.serviceName);
+            if (wscopt && FillListFields(WSBrokerRecord::FromService(s, wscopt.value(), ""), query, fields))
+                rows.push_back(fields);
+        }
+        FILE* null = fopen("NUL", "wb");
+        if (!null)
+            return std::nullopt;
+
+        std::vector<std::string> titles(std::begin(ListColumnTitles), std::end(ListColumnTitles));
+        std::vector<size_t> widths(std::begin(ListColumnWidths), std::end(ListColumnWidths));
+        bool isTabulate = (name == "table-render-tabulate");
+        RunBenchLoop(result, iterationNum, [&] {
+            if (!isTabulate) {
+                WSTableWriter table(titles, widths, null);
+                table.Reserve(rows.size());
+                for (auto& row : rows) {
+                    table.AddRow();
+                    for (auto& field : row)
+                        table.AddCell(field);
+                }
+                table.Write();
+                return true;
+            }
+
+            // The layout list had before WSTableWriter.
+            tabulate::Table table;
+            table.format().multi_byte_characters(true);
+            table.add_row(tabulate::Table::Row_t(titles.begin(), titles.end()));
+            table.row(0).format().font_color(tabulate::Color::yellow)
+                .font_align(tabulate::FontAlign::center)
+                .font_style({tabulate::FontStyle::bold});
+            for (size_t i = 0; i < ListColumn_Count; i++)
+                table.column(i).format().width(ListColumnWidths[i]);
+            for (auto& row : rows)
+                table.add_row(tabulate::Table::Row_t(row.begin(), row.end()));
+            std::string text = table.str();
+            return fwrite(text.data(), 1, text.size(), null) == text.size();
+        });
+        fclose(null);
+    } else if (name == "watch-status" || name == "watch-full") {
+        // One operation is a list --watch tick drawn for a 50 line VT console into the null device, a fifth
+        // of the services change state between ticks. SCM calls and CPU time per tick are logged.
+        FILE* null = fopen("NUL", "wb");
+        if (!null)
+            return std::nullopt;
+
+        ListQuery query = {};
+        for (int i = 0; i < ListColumn_Count; i++)
+            query.columns.push_back(i);
+        auto fill = [&](const WSvcStatus& s, std::vector<std::string>& fields, size_t& callNum) {
+            auto wscopt = backend.GetConfig(s.serviceName);
+            callNum++;
+            return wscopt && FillListFields(WSBrokerRecord::FromService(s, wscopt.value(), ""), query, fields);
+        };
+
+        // A full tick is the first one of a view, the status scenario draws it before the loop.
+        bool isFull = (name == "watch-full");
+        auto view = std::make_unique<WatchView>(query, null, true);
+        size_t callNum = 0;
+        if (!isFull)
+            view->Tick(backend.GetServices(), fill, 50, callNum);
+        callNum = 0;
+        size_t tick = 0;
+        uint64_t startCpuTime = GetProcessCpuTime();
+        RunBenchLoop(result, iterationNum, [&] {
+            // Every other tick flips each fifth service, the ticks between flip them back.
+            auto services = backend.GetServices();
+            bool isFlipped = (tick++ % 2 == 0);
+            for (size_t i = 0; isFlipped && i < services.size(); i += 5) {
+                auto& s = services[i];
+                s.currentState = (s.currentState == SERVICE_RUNNING) ? SERVICE_STOPPED : SERVICE_RUNNING;
+                s.processId = (s.currentState == SERVICE_RUNNING) ? (unsigned long)(1000 + i) : 0;
+            }
+            if (isFull)
+                view = std::make_unique<WatchView>(query, null, true);
+            callNum++;
+            view->Tick(services, fill, 50, callNum);
+            view->Flush("bench");
+            return true;
+        });
+        SPDLOG_INFO("Scenario {}: {:.1f} SCM calls and {:.3f} ms CPU per tick.", name, (double)callNum / iterationNum,
+            (GetProcessCpuTime() - startCpuTime) / 10000.0 / iterationNum);
+        fclose(null);
+    } else if (name == "open") {
+        auto services = backend.GetServices();
+        if (services.empty())
+            return std::nullopt;
+        RunBenchLoop(result, iterationNum, [&] { return backend.OpenService(services[0].serviceName); });
+    } else if (name == "startstop") {
+        if (!backend.HasScratch()) {
+            SPDLOG_ERROR("Scenario startstop needs the SCM backend.");
+            return std::nullopt;
+        }
+        if (!backend.InstallScratch()) {
+            SPDLOG_ERROR("Install scratch service {} failed.", BENCH_SCRATCH_NAME);
+            return std::nullopt;
+        }
+        RunBenchLoop(result, iterationNum, [&] { return backend.StartStop(); });
+        backend.UninstallScratch();
+    } else if (name == "ondemand-activate" || name == "ondemand-relay" || name == "ondemand-direct") {
+        // A scratch on-demand agent runs this program as an echo command. Activation is the first 64 byte
+        // round trip of a freshly started agent, relay and direct are 16 KB round trips on a warm connection
+        // through the agent or straight to the command.
+        if (!backend.HasScratch()) {
+            SPDLOG_ERROR("Scenario {} needs the SCM backend.", name);
+            return std::nullopt;
+        }
+        WSADATA wsaData;
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0 || !InstallOnDemandScratch()) {
+            SPDLOG_ERROR("Install scratch service {} failed.", BENCH_ONDEMAND_NAME);
+            return std::nullopt;
+        }
+
+        WSAgent agent(BENCH_ONDEMAND_NAME);
+        bool isActivate = (name == "ondemand-activate");
+        std::string payload(isActivate ? 64 : (16 << 10), '\0');
+        for (size_t i = 0; i < payload.size(); i++)
+            payload[i] = (char)('a' + i % 26);
+        std::string reply;
+        if (isActivate) {
+            RunBenchLoop(result, iterationNum, [&] {
+                SOCKET s = ConnectLoopback(BENCH_ONDEMAND_LISTEN_PORT);
+                bool isOK = (s != INVALID_SOCKET) && EchoRoundTrip(s, payload, reply);
+                if (s != INVALID_SOCKET)
+                    closesocket(s);
+                return isOK;
+            }, [&] {
+                auto status = agent.GetStatus();
+                return status && (status->currentState == SERVICE_STOPPED || agent.Stop(10000)) && agent.Start();
+            });
+        } else {
+            // The first connection through the agent spawns the command, it stays open so the command does too.
+            SOCKET warm = agent.Start() ? ConnectLoopback(BENCH_ONDEMAND_LISTEN_PORT) : INVALID_SOCKET;
+            bool isWarm = (warm != INVALID_SOCKET) && EchoRoundTrip(warm, payload, reply);
+            SOCKET s = isWarm ? ConnectLoopback(name == "ondemand-relay" ? BENCH_ONDEMAND_LISTEN_PORT
+                : BENCH_ONDEMAND_TARGET_PORT) : INVALID_SOCKET;
+            if (s != INVALID_SOCKET) {
+                RunBenchLoop(result, iterationNum, [&] { return EchoRoundTrip(s, payload, reply); });
+                result.byteNum = payload.size() * iterationNum;
+                closesocket(s);
+            } else {
+                SPDLOG_ERROR("Scratch service {} did not echo.", BENCH_ONDEMAND_NAME);
+            }
+            if (warm != INVALID_SOCKET)
+                closesocket(warm);
+        }
+        agent.Stop(10000);
+        agent.Uninstall();
+        WSACleanup();
+        if (!result.histogram.GetCount() && !result.failedNum)
+            return std::nullopt;
+    } else if (name == "log") {
+        // Same 2048 byte reads the agent forwards from the child stdout.
+        std::string chunk;
+        while (chunk.size() + 64 <= 2048)
+            chunk += fmt::format("{:>12} bench log line for agent throughput ..........\n", chunk.size());
+        std::string logName = std::string(BENCH_SCRATCH_NAME) + "-log";
+        RunBenchLoop(result, iterationNum, [&] {
+            WriteServiceLog(logName, chunk);
+            return true;
+        });
+        result.byteNum = chunk.size() * iterationNum;
+        std::error_code ec;
+        std::filesystem::remove(std::filesystem::path(GetLogDirectory()) / (logName + ".log"), ec);
+    } else if (name == "utf8-to-ansi" || name == "ansi-to-utf8") {
+        std::string utf8;
+        while (utf8.size() < 1024)
+            utf8 += u8"Service caf\u00e9 d\u00e9marr\u00e9 \u00fcber C:\\Program Files\\app.exe -- ";
+        std::string text = (name == "utf8-to-ansi") ? utf8 : Utf8ToAnsi(utf8);
+        bool isToAnsi = (name == "utf8-to-ansi");
+        RunBenchLoop(result, iterationNum, [&] {
+            return !(isToAnsi ? Utf8ToAnsi(text) : AnsiToUtf8(text)).empty();
+        });
+        result.byteNum = text.size() * iterationNum;
+    } else if (name == "agent-path" || name == "agent-path-cached") {
+        // Tokenizing alone against the cached lookup the GUI rows go through.
+        std::string binaryPath = "\"C:\\Program Files\\winsvc\\winsvc.exe\" /RunAsService:web "
+            "\"C:\\app dir\\server.exe\" --port 80 --name \"Web \\\"Main\\\"\"";
+        bool isCached = (name == "agent-path-cached");
+        RunBenchLoop(result, iterationNum, [&] {
+            return isCached ? !WSAgent::GetPath(binaryPath).empty() : !WSAgent::GetCommand(binaryPath).empty();
+        });
+        result.byteNum = binaryPath.size() * iterationNum;
+    } else {
+        SPDLOG_ERROR("Unknown bench scenario: {}", name);
+        return std::nullopt;
+    }
+    return result;
+}
+
+static void RunBench(const argparse::ArgumentParser& cmd)
+{
+    if (cmd.is_used("--echo")) {
+        RunEchoServer(std::stoul(cmd.get<std::string>("--echo")));
+        return;
+    }
+
+    auto format = WSRowWriter::GetFormat(cmd.get<std::string>("--format"));
+    if (!format) {
+        SPDLOG_ERROR("Unknown format: {}", cmd.get<std::string>("--format"));
+        return;
+    }
+
+    std::unique_ptr<BenchBackend> backend;
+    if (cmd.get<bool>("--simulate"))
+        backend = std::make_unique<SimulatedBenchBackend>(std::stoul(cmd.get<std::string>("--services")));
+    else
+        backend = std::make_unique<ScmBenchBackend>();
+    size_t iterationNum = (std::max)(std::stoul(cmd.get<std::string>("--iterations")), 1ul);
+
+    static const std::vector<std::string> columns({
+        "scenario", "backend", "count", "failed", "min_us", "p50_us", "p90_us", "p99_us", "p999_us", "max_us",
+        "mean_us", "ops_per_s", "mb_per_s"
+    });
+    bool isTable = (format.value() == WSRowWriter::Format_Table);
+    WSRowWriter writer(format.value(), columns);
+    writer.WriteHeader();
+    auto table = std::make_unique<WSTableWriter>(columns, std::vector<size_t>(columns.size(), 16));
+
+    std::stringstream ss(cmd.get<std::string>("--scenarios"));
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        auto result = RunBenchScenario(*backend, name, iterationNum);
+        if (!result)
+            continue;
+
+        // Latencies are recorded in ns and reported in us with ns precision.
+        auto& histogram = result->histogram;
+        double seconds = (std::max)(result->elapsedMS, 0.001) / 1000.0;
+        std::vector<double> values({
+            histogram.GetMin() / 1000.0, histogram.GetPercentile(50) / 1000.0, histogram.GetPercentile(90) / 1000.0,
+            histogram.GetPercentile(99) / 1000.0, histogram.GetPercentile(99.9) / 1000.0,
+            histogram.GetMax() / 1000.0, histogram.GetMean() / 1000.0,
+            histogram.GetCount() / seconds, result->byteNum / seconds / (1024 * 1024)
+        });
+        if (isTable) {
+            table->AddRow();
+            table->AddCell(result->name);
+            table->AddCell(backend->GetName());
+            table->AddCell(std::to_string(histogram.GetCount()));
+            table->AddCell(std::to_string(result->failedNum));
+            for (double value : values)
+                table->AddCell(fmt::format("{:.3f}", value));
+            continue;
+        }
+
+        writer.BeginRow();
+        writer.AddField(result->name);
+        writer.AddField(backend->GetName());
+        writer.AddField((unsigned long)histogram.GetCount());
+        writer.AddField((unsigned long)result->failedNum);
+        for (double value : values)
+            writer.AddField(value, 3);
+        writer.EndRow();
+    }
+
+    if (isTable)
+        table->Write();
+}
 
 int ConsoleMain(int argc, char *argv[], bool hasConsole)
 {
@@ -17,6 +1862,25 @@ int ConsoleMain(int argc, char *argv[], bool hasConsole)
             WSAgent app(name, alias);
             app.Install(path);
             app.SetDescription(desc);
+
+            if (cmd.is_used("--shutdown-timeout"))
+                app.SetPreshutdownTimeout(std::stoul(cmd.get<std::string>("--shutdown-timeout")));
+
+            WSvcSched sched;
+            if (ParseSchedOptions(cmd, sched))
+                app.SetSched(sched);
+
+            WSvcLimit limit;
+            if (ParseLimitOptions(cmd, limit))
+                app.SetLimit(limit);
+
+            WSvcActivation activation;
+            if (ParseOnDemandOptions(cmd, activation))
+                app.SetActivation(activation);
+
+            WSvcStandby standby;
+            if (ParseStandbyOptions(cmd, standby))
+                app.SetStandby(standby);
         } else {
             WSApp app(name, alias);
             app.Install(path);
@@ -37,44 +1901,83 @@ int ConsoleMain(int argc, char *argv[], bool hasConsole)
         auto name = cmd.get<std::string>("name");
         WSApp app(name);
         app.Stop(10000);
+    } else if (m.is_subcommand_used("sched")) {
+        auto& cmd = ArgManager::Inst().Get("sched");
+        auto name = cmd.get<std::string>("name");
+        WSAgent app(name);
+        WSvcSched sched = app.GetSched();
+        if (ParseSchedOptions(cmd, sched)) {
+            app.SetSched(sched);
+            SPDLOG_COUT("Restart {} to apply the new sched.", name);
+        } else {
+            SPDLOG_COUT("Configured: {}", sched.ToString());
+            auto effective = app.GetEffectiveSched();
+            if (effective)
+                SPDLOG_COUT("Effective({}): {}", app.GetChildPid(), effective->ToString());
+        }
+    } else if (m.is_subcommand_used("limit")) {
+        auto& cmd = ArgManager::Inst().Get("limit");
+        auto name = cmd.get<std::string>("name");
+        WSAgent app(name);
+        WSvcLimit limit = app.GetLimit();
+        if (ParseLimitOptions(cmd, limit)) {
+            app.SetLimit(limit);
+            SPDLOG_COUT("Restart {} to apply the new limit.", name);
+        } else {
+            SPDLOG_COUT("Limit: {}", limit.ToString());
+            SPDLOG_COUT("Usage: {}", app.GetUsage().ToString());
+        }
+    } else if (m.is_subcommand_used("ondemand")) {
+        auto& cmd = ArgManager::Inst().Get("ondemand");
+        auto name = cmd.get<std::string>("name");
+        WSAgent app(name);
+        WSvcActivation activation = app.GetActivation();
+        if (ParseOnDemandOptions(cmd, activation)) {
+            app.SetActivation(activation);
+            SPDLOG_COUT("Restart {} to apply the new activation.", name);
+        } else {
+            SPDLOG_COUT("Activation: {}", activation.ToString());
+        }
+    } else if (m.is_subcommand_used("standby")) {
+        auto& cmd = ArgManager::Inst().Get("standby");
+        auto name = cmd.get<std::string>("name");
+        WSAgent app(name);
+        WSvcStandby standby = app.GetStandby();
+        if (ParseStandbyOptions(cmd, standby)) {
+            app.SetStandby(standby);
+            SPDLOG_COUT("Restart {} to apply the new standby.", name);
+        } else {
+            SPDLOG_COUT("Standby: {}", standby.ToString());
+        }
     } else if (m.is_subcommand_used("list")) {
         auto& cmd = ArgManager::Inst().Get("list");
-        auto services = WSGeneral::Inst().GetServices();
-
-        tabulate::Table services_table;
-        services_table.format().multi_byte_characters(true);
-        services_table.add_row({"Name", "Alias", "Type", "State", "PID", "Path", "Startup"});
-        services_table.row(0).format().font_color(tabulate::Color::yellow)
-            .font_align(tabulate::FontAlign::center)
-            .font_style({tabulate::FontStyle::bold});
-        services_table.column(0).format().width(15);
-        services_table.column(1).format().width(30);
-        services_table.column(2).format().width(20);
-        services_table.column(3).format().width(10);
-        services_table.column(4).format().width(10);
-        services_table.column(5).format().width(50);
-        services_table.column(6).format().width(15);
-
-        for (auto& s : services) {
-            WSApp app(s.serviceName);
-            auto wscopt = app.GetConfig();
-            if (!wscopt)
-                continue;
-
-            auto& config = wscopt.value();
-            if (cmd.is_used("--filter-path")) {
-                auto filter_path = cmd.get<std::string>("--filter-path");
-                if (config.binaryPathName.find(filter_path) == std::string::npos) {
-                    continue;
-                }
-            }
-
-            services_table.add_row({s.serviceName, s.displayName,
-                config.GetType(), s.GetCurrentState(), std::to_string(s.processId),
-                config.binaryPathName, config.GetStartType()});
+        auto query = ParseListQuery(cmd);
+        if (cmd.get<bool>("--refresh-cache")) {
+            WSSnapshotCache().Save(LoadServiceRecords());
+        } else if (query) {
+            if (cmd.get<bool>("--watch"))
+                WatchServices(cmd, query.value());
+            else
+                ListServices(cmd, query.value());
         }
-
-        SPDLOG_COUT(AnsiToUtf8(services_table.str()));
+    } else if (m.is_subcommand_used("top")) {
+        auto& cmd = ArgManager::Inst().Get("top");
+        TopServices(cmd);
+    } else if (m.is_subcommand_used("batch")) {
+        auto& cmd = ArgManager::Inst().Get("batch");
+        RunBatch(cmd);
+    } else if (m.is_subcommand_used("tail")) {
+        auto& cmd = ArgManager::Inst().Get("tail");
+        TailLog(cmd);
+    } else if (m.is_subcommand_used("broker")) {
+        auto& cmd = ArgManager::Inst().Get("broker");
+        RunBroker(cmd);
+    } else if (m.is_subcommand_used("apply")) {
+        auto& cmd = ArgManager::Inst().Get("apply");
+        ApplyManifest(cmd);
+    } else if (m.is_subcommand_used("bench")) {
+        auto& cmd = ArgManager::Inst().Get("bench");
+        RunBench(cmd);
     } else if (m.is_subcommand_used("/RunAsService")) {
         auto& cmd = ArgManager::Inst().Get("/RunAsService");
         auto name = cmd.get<std::string>("name");
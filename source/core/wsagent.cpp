@@ -1,15 +1,50 @@
-#include "util/wsarg.h"
+#include "util/wscmdline.h"
 #include "core/wsagent.h"
 #include "core/wsgeneral.h"
 
 #pragma comment(lib, "User32.lib")
+#pragma comment(lib, "Ws2_32.lib")
+
+struct WSProxyContext
+{
+    WSAgent* app;
+    SOCKET client;
+    uint32_t spawnEpoch;
+};
+
+struct WSStandbyPipe
+{
+    WSAgent* app;
+    HANDLE stdOutRead;
+    HANDLE readyEvent;
+    std::string marker;
+};
 
 WSAgent::WSAgent(const std::string& name, const std::string& alias):
     WSApp(name, alias),
-    stopEvent_(NULL),
     svcStatusHandle_(NULL),
     stdOutRead_(NULL),
-    stdOutWrite_(NULL)
+    stdOutWrite_(NULL),
+    stopEvent_(NULL),
+    stopControl_(SERVICE_CONTROL_STOP),
+    checkPoint_(0),
+    job_(NULL),
+    jobPort_(NULL),
+    limitHits_(0),
+    listener_(INVALID_SOCKET),
+    activateEvent_(NULL),
+    childRunning_(false),
+    spawnEpoch_(0),
+    activeConnections_(0),
+    lastActivity_(0),
+    standby_({0,}),
+    standbyReady_(NULL),
+    standbyTick_(0),
+    standbyIsReady_(false),
+    coldReadyMs_(0),
+    failoverReady_(NULL),
+    failoverExitTick_(0),
+    failoverSpawnTick_(0)
 {
 }
 
@@ -19,21 +54,44 @@ WSAgent::~WSAgent()
         CloseHandle(stdOutWrite_);
     if (stdOutRead_)
         CloseHandle(stdOutRead_);
+    if (activateEvent_)
+        CloseHandle(activateEvent_);
+    if (standbyReady_)
+        CloseHandle(standbyReady_);
+    if (failoverReady_)
+        CloseHandle(failoverReady_);
+    if (jobPort_)
+        CloseHandle(jobPort_);
+    if (job_)
+        CloseHandle(job_);
 }
 
 bool WSAgent::Install(const std::string& path)
+{
+    auto agentPath = GetAgentPath(path);
+    return agentPath && WSApp::Install(agentPath.value());
+}
+
+bool WSAgent::SetPath(const std::string& path)
+{
+    auto agentPath = GetAgentPath(path);
+    return agentPath && WSApp::SetPath(agentPath.value());
+}
+
+std::optional<std::string> WSAgent::GetAgentPath(const std::string& path)
 {
     CHAR unquotedPath[MAX_PATH];
     if (!GetModuleFileName(NULL, unquotedPath, MAX_PATH)) {
+        error_ = GetLastError();
         SPDLOG_ERROR("GetModuleFileName failed! WinApi@");
-        return false;
+        return std::nullopt;
     }
 
     std::string agentPath = "\"";
     agentPath += unquotedPath;
-	agentPath += "\" /RunAsService:";
-	agentPath += GetName() + " " + path;
-    return WSApp::Install(agentPath);
+    agentPath += "\" /RunAsService:";
+    agentPath += GetName() + " " + path;
+    return agentPath;
 }
 
 std::string WSAgent::GetPath() const
@@ -41,21 +99,33 @@ std::string WSAgent::GetPath() const
     return GetPath(WSApp::GetPath());
 }
 
+std::string_view WSAgent::GetCommand(std::string_view binaryPath)
+{
+    // "<exe>" /RunAsService:<name> <command>, the command is returned as installed with its own quotes.
+    WSCommandLine cmdline(binaryPath);
+    std::string_view arg;
+    if (!cmdline.Next(arg) || !cmdline.Next(arg) || arg.substr(0, 14) != "/RunAsService:")
+        return std::string_view();
+
+    std::string_view command = cmdline.GetRemainder();
+    while (!command.empty() && (command.back() == ' ' || command.back() == '\t'))
+        command.remove_suffix(1);
+    return command;
+}
+
 std::string WSAgent::GetPath(const std::string& cmd)
 {
-    std::string path;
-    ArgManager manager(cmd);
-    auto& parser = manager.Get("/RunAsService");
-    auto argv = parser.get<std::vector<std::string>>("argv");
-    for (auto& arg : argv) {
-        if (path.empty()) {
-            path = arg;
-        } else {
-            path += " ";
-            path += arg;
-        }
-    }
-    return path;
+    // Every refresh asks for the same binary paths, so each config string is parsed once.
+    static std::mutex cacheMutex;
+    static std::unordered_map<std::string, std::string> cache;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(cmd);
+    if (it != cache.end())
+        return it->second;
+
+    if (cache.size() >= 4096)
+        cache.clear();
+    return cache.emplace(cmd, GetCommand(cmd)).first->second;
 }
 
 void WSAgent::Dispatch()
@@ -119,14 +189,23 @@ VOID WINAPI WSAgent::ServiceMainProc(DWORD argc, LPTSTR *argv)
         return;
     }
 
+    if (app.CreateJob()) {
+        HANDLE hJobThread = CreateThread(NULL, 0, JobMonitorThread, &app, 0, NULL);
+        if (hJobThread == NULL)
+            SPDLOG_ERROR("CreateThread failed! WinApi@");
+        else
+            CloseHandle(hJobThread);
+    }
+
+    WSvcActivation activation = app.GetActivation();
+    if (activation.IsOnDemand()) {
+        CloseHandle(hReadThread);
+        app.RunOnDemand(activation);
+        return;
+    }
+
 	PROCESS_INFORMATION pi = {0,};
-	STARTUPINFO si = {sizeof(STARTUPINFO),};
-    si.hStdError = app.stdOutWrite_;
-    si.hStdOutput = app.stdOutWrite_;
-    si.dwFlags |= STARTF_USESTDHANDLES;
-	si.wShowWindow = SW_HIDE;
-	if (!CreateProcess(NULL, (LPTSTR)app.GetPath().data(), NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi)) {
-        SPDLOG_ERROR("CreateProcess failed! WinApi@");
+	if (!app.SpawnChild(pi)) {
         CloseHandle(hReadThread);
         return;
     }
@@ -134,28 +213,56 @@ VOID WINAPI WSAgent::ServiceMainProc(DWORD argc, LPTSTR *argv)
     SPDLOG_INFO("cmd:{} cmdPid:{} cmdTid:{} readTid:{}",
         app.GetPath(), pi.dwProcessId, pi.dwThreadId, dwReadThreadId);
 
+    app.standbyConfig_ = app.GetStandby();
+    if (app.standbyConfig_.enabled) {
+        SPDLOG_INFO("{} standby: {}", app.GetName(), app.standbyConfig_.ToString());
+        app.SpawnStandby();
+    }
+
     app.SetStatus(SERVICE_RUNNING, NO_ERROR, 0);
 
+    // Standby readiness is polled, so wake up more often when it is enabled.
+    DWORD waitTimeout = app.standbyConfig_.enabled ? 500 : 10000;
+    ULONGLONG recordTick = GetTickCount64();
     while (true) {
-        HANDLE waitHandles[3] = {app.stopEvent_, pi.hProcess, hReadThread};
-        DWORD dwEvent = WaitForMultipleObjects(ARRAYSIZE(waitHandles), waitHandles, FALSE, 10000);
+        HANDLE waitHandles[4] = {app.stopEvent_, pi.hProcess, hReadThread, app.standby_.hProcess};
+        DWORD waitCount = app.standby_.hProcess ? 4 : 3;
+        DWORD dwEvent = WaitForMultipleObjects(waitCount, waitHandles, FALSE, waitTimeout);
         switch (dwEvent) {
             case WAIT_OBJECT_0 + 0:
                 SPDLOG_INFO("{} ({}) receive stop event, prepare stop it.", app.GetName(), pi.dwProcessId);
-                EnumWindows(WindowCloserProc, pi.dwThreadId);
-                if (WaitForSingleObject(pi.hProcess, 2000) != WAIT_OBJECT_0)
-                    TerminateProcess(pi.hProcess, -1);
+                app.StopChildren({&pi, &app.standby_}, hReadThread);
+                if (app.standby_.hProcess)
+                    app.DiscardStandby();
+                app.RecordUsage();
+                app.SetChildPid(0);
+                app.SetStatus(SERVICE_STOPPED, NO_ERROR, 0);
                 ExitProcess(0);
                 return;
             case WAIT_OBJECT_0 + 1:
                 SPDLOG_INFO("{} ({}) process exit.", app.GetName(), pi.dwProcessId);
+                if (app.standby_.hProcess) {
+                    app.PromoteStandby(pi);
+                    break;
+                }
+                app.RecordUsage();
+                app.SetChildPid(0);
                 ExitProcess(0);
                 return;
             case WAIT_OBJECT_0 + 2:
                 SPDLOG_WARN("{} ({}) read thread:{} event.", app.GetName(), pi.dwProcessId, dwReadThreadId);
                 break;
+            case WAIT_OBJECT_0 + 3:
+                SPDLOG_WARN("{} standby ({}) exit, respawn later.", app.GetName(), app.standby_.dwProcessId);
+                app.DiscardStandby();
+                break;
             case WAIT_TIMEOUT:
-                SPDLOG_INFO("{} ({}) timeout.", app.GetName(), pi.dwProcessId);
+                if (app.standbyConfig_.enabled && app.CheckFailover(pi))
+                    app.CheckStandby();
+                if (GetTickCount64() - recordTick >= 10000) {
+                    app.RecordUsage();
+                    recordTick = GetTickCount64();
+                }
                 break;
             default:
                 SPDLOG_INFO("Unknown error.");
@@ -163,6 +270,603 @@ VOID WINAPI WSAgent::ServiceMainProc(DWORD argc, LPTSTR *argv)
     }
 }
 
+bool WSAgent::SpawnChild(PROCESS_INFORMATION& pi, HANDLE stdOut, bool isActive)
+{
+    WSvcSched sched = GetSched();
+    DWORD creationFlags = CREATE_SUSPENDED;
+    if (sched.priorityClass != WSvcSched::Inherit)
+        creationFlags |= sched.priorityClass;
+
+    std::string cmd = GetPath();
+	STARTUPINFO si = {sizeof(STARTUPINFO),};
+    si.hStdError = stdOut ? stdOut : stdOutWrite_;
+    si.hStdOutput = stdOut ? stdOut : stdOutWrite_;
+    si.dwFlags |= STARTF_USESTDHANDLES;
+	si.wShowWindow = SW_HIDE;
+	if (!CreateProcess(NULL, (LPTSTR)cmd.data(), NULL, NULL, TRUE, creationFlags, NULL, NULL, &si, &pi)) {
+        SPDLOG_ERROR("CreateProcess failed! WinApi@");
+        return false;
+    }
+
+    // The child is still suspended, so it never runs outside of its job or sched settings.
+    if (job_ && !AssignProcessToJobObject(job_, pi.hProcess))
+        SPDLOG_ERROR("{} ({}) AssignProcessToJobObject failed! WinApi@", GetName(), pi.dwProcessId);
+
+    if (!sched.IsInherit()) {
+        if (SetProcessSched(pi.hProcess, sched))
+            SPDLOG_INFO("{} ({}) sched: {}", GetName(), pi.dwProcessId, sched.ToString());
+        else
+            SPDLOG_WARN("{} ({}) sched partially applied: {}", GetName(), pi.dwProcessId, sched.ToString());
+    }
+    ResumeThread(pi.hThread);
+
+    if (isActive)
+        SetChildPid(pi.dwProcessId);
+    return true;
+}
+
+bool WSAgent::SpawnStandby()
+{
+    standbyTick_ = GetTickCount64();
+    standbyIsReady_ = false;
+
+    // A file left by the active instance must not mark the new standby ready.
+    if (!standbyConfig_.readyFile.empty())
+        DeleteFile(standbyConfig_.readyFile.data());
+
+    SECURITY_ATTRIBUTES sa = {sizeof(SECURITY_ATTRIBUTES), NULL, TRUE};
+    HANDLE stdOutRead = NULL;
+    HANDLE stdOutWrite = NULL;
+    if (!CreatePipe(&stdOutRead, &stdOutWrite, &sa, 0)) {
+        SPDLOG_ERROR("CreatePipe failed! WinApi@");
+        return false;
+    }
+    SetHandleInformation(stdOutRead, HANDLE_FLAG_INHERIT, 0);
+
+    standbyReady_ = CreateEvent(NULL, TRUE, FALSE, NULL);
+    bool isSpawned = standbyReady_ && SpawnChild(standby_, stdOutWrite, false);
+    CloseHandle(stdOutWrite);
+    if (!isSpawned) {
+        CloseHandle(stdOutRead);
+        if (standbyReady_)
+            CloseHandle(standbyReady_);
+        standbyReady_ = NULL;
+        return false;
+    }
+
+    // The reader thread owns its pipe and event, so it keeps logging after the standby is promoted.
+    auto* context = new WSStandbyPipe{this, stdOutRead, NULL, standbyConfig_.readyMarker};
+    DuplicateHandle(GetCurrentProcess(), standbyReady_, GetCurrentProcess(), &context->readyEvent,
+        0, FALSE, DUPLICATE_SAME_ACCESS);
+    HANDLE hStandbyThread = CreateThread(NULL, 0, StandbyReadThread, context, 0, NULL);
+    if (hStandbyThread == NULL) {
+        SPDLOG_ERROR("CreateThread failed! WinApi@");
+        CloseHandle(context->stdOutRead);
+        if (context->readyEvent)
+            CloseHandle(context->readyEvent);
+        delete context;
+    } else {
+        CloseHandle(hStandbyThread);
+    }
+
+    SPDLOG_INFO("{} standby ({}) spawned, warming up.", GetName(), standby_.dwProcessId);
+    return true;
+}
+
+bool WSAgent::CheckStandby()
+{
+    ULONGLONG elapsed = GetTickCount64() - standbyTick_;
+    if (!standby_.hProcess) {
+        if (elapsed >= 5000)
+            SpawnStandby();
+        return false;
+    }
+
+    if (standbyIsReady_)
+        return true;
+
+    if (IsChildReady(standbyReady_)) {
+        // A standby's warm-up is exactly what a cold restart of the active child would cost.
+        standbyIsReady_ = true;
+        coldReadyMs_ = elapsed;
+        SPDLOG_INFO("{} standby ({}) ready in {}ms.", GetName(), standby_.dwProcessId, elapsed);
+        return true;
+    }
+
+    if (elapsed > standbyConfig_.readyTimeout * 1000ULL) {
+        SPDLOG_WARN("{} standby ({}) not ready after {}s, respawn it.", GetName(), standby_.dwProcessId, standbyConfig_.readyTimeout);
+        DiscardStandby();
+        SpawnStandby();
+    }
+    return false;
+}
+
+bool WSAgent::CheckFailover(const PROCESS_INFORMATION& pi)
+{
+    if (!failoverExitTick_)
+        return true;
+
+    ULONGLONG now = GetTickCount64();
+    if (IsChildReady(failoverReady_)) {
+        SPDLOG_INFO("{} failover to ({}) ready {}ms after exit, cold spawn to ready {}ms.", GetName(), pi.dwProcessId,
+            now - failoverExitTick_, now - failoverSpawnTick_);
+    } else if (now - failoverSpawnTick_ > standbyConfig_.readyTimeout * 1000ULL) {
+        SPDLOG_WARN("{} failover to ({}) not ready after {}s.", GetName(), pi.dwProcessId, standbyConfig_.readyTimeout);
+    } else {
+        return false;
+    }
+
+    // The next standby is spawned only now, as it would delete the ready file the promoted child is about to write.
+    CloseHandle(failoverReady_);
+    failoverReady_ = NULL;
+    failoverExitTick_ = 0;
+    SpawnStandby();
+    return false;
+}
+
+bool WSAgent::IsChildReady(HANDLE readyEvent)
+{
+    const auto& config = standbyConfig_;
+    bool hasProtocol = !config.readyFile.empty() || !config.readyMarker.empty();
+    return !hasProtocol
+        || (!config.readyMarker.empty() && WaitForSingleObject(readyEvent, 0) == WAIT_OBJECT_0)
+        || (!config.readyFile.empty() && GetFileAttributes(config.readyFile.data()) != INVALID_FILE_ATTRIBUTES);
+}
+
+void WSAgent::DiscardStandby()
+{
+    if (WaitForSingleObject(standby_.hProcess, 0) != WAIT_OBJECT_0)
+        StopChild(standby_);
+    CloseHandle(standby_.hThread);
+    CloseHandle(standby_.hProcess);
+    ZeroMemory(&standby_, sizeof(standby_));
+    CloseHandle(standbyReady_);
+    standbyReady_ = NULL;
+    standbyIsReady_ = false;
+}
+
+void WSAgent::PromoteStandby(PROCESS_INFORMATION& pi)
+{
+    // Back-date the exit by its real time, so the wait and the bookkeeping below are counted too.
+    ULONGLONG exitTick = GetTickCount64();
+    FILETIME creationTime, exitTime, kernelTime, userTime, now;
+    if (GetProcessTimes(pi.hProcess, &creationTime, &exitTime, &kernelTime, &userTime)) {
+        GetSystemTimeAsFileTime(&now);
+        uint64_t nowTime = ((uint64_t)now.dwHighDateTime << 32) | now.dwLowDateTime;
+        uint64_t exitedTime = ((uint64_t)exitTime.dwHighDateTime << 32) | exitTime.dwLowDateTime;
+        if (nowTime > exitedTime)
+            exitTick -= (std::min)((nowTime - exitedTime) / 10000, exitTick);
+    }
+
+    DWORD exitPid = pi.dwProcessId;
+    RecordUsage();
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+
+    pi = standby_;
+    ZeroMemory(&standby_, sizeof(standby_));
+    SetChildPid(pi.dwProcessId);
+    WriteServiceLog(GetName(), fmt::format("[{}] failover to process {}.\n", GetProgramName(), pi.dwProcessId));
+
+    if (standbyIsReady_) {
+        CloseHandle(standbyReady_);
+        standbyReady_ = NULL;
+        standbyIsReady_ = false;
+        SPDLOG_INFO("{} failover from ({}) to ({}) ready {}ms after exit, cold spawn to ready {}ms.", GetName(),
+            exitPid, pi.dwProcessId, GetTickCount64() - exitTick, coldReadyMs_);
+        SpawnStandby();
+        return;
+    }
+
+    // The promoted child is still warming up, CheckFailover reports once it is ready.
+    SPDLOG_INFO("{} failover from ({}) to ({}), still warming up.", GetName(), exitPid, pi.dwProcessId);
+    failoverReady_ = standbyReady_;
+    standbyReady_ = NULL;
+    failoverExitTick_ = exitTick;
+    failoverSpawnTick_ = standbyTick_;
+}
+
+void WSAgent::StopChild(PROCESS_INFORMATION& pi)
+{
+    EnumWindows(WindowCloserProc, pi.dwThreadId);
+    if (WaitForSingleObject(pi.hProcess, 2000) != WAIT_OBJECT_0)
+        TerminateProcess(pi.hProcess, -1);
+}
+
+DWORD WSAgent::GetStopBudget(DWORD control)
+{
+    switch (control) {
+        case SERVICE_CONTROL_PRESHUTDOWN:
+            return GetPreshutdownTimeout();
+        case SERVICE_CONTROL_SHUTDOWN:
+            // Services only get WaitToKillServiceTimeout, which is 5 seconds by default.
+            return 5000;
+        default:
+            return 2000;
+    }
+}
+
+void WSAgent::StopChildren(const std::vector<PROCESS_INFORMATION*>& children, HANDLE readThread)
+{
+    ULONGLONG startTick = GetTickCount64();
+    DWORD budget = GetStopBudget(stopControl_);
+    // Keep a slice of the budget to drain the output of children into the log.
+    ULONGLONG deadline = startTick + (budget > 1000 ? budget - 500 : budget);
+
+    // Ask all children to close at once, so their clean up overlaps instead of adding up.
+    std::vector<DWORD> processIds;
+    std::vector<HANDLE> processes;
+    for (auto* child : children) {
+        if (!child->hProcess)
+            continue;
+        processIds.push_back(child->dwProcessId);
+        processes.push_back(child->hProcess);
+    }
+    EnumWindows(ProcessCloserProc, (LPARAM)&processIds);
+
+    DWORD dwEvent = WAIT_TIMEOUT;
+    while (!processes.empty() && dwEvent == WAIT_TIMEOUT) {
+        ULONGLONG now = GetTickCount64();
+        if (now >= deadline)
+            break;
+
+        DWORD remaining = (DWORD)(deadline - now);
+        SetStatus(SERVICE_STOP_PENDING, NO_ERROR, remaining + 1000);
+        dwEvent = WaitForMultipleObjects((DWORD)processes.size(), processes.data(), TRUE, (std::min)(remaining, (DWORD)1000));
+    }
+
+    if (dwEvent == WAIT_TIMEOUT && !processes.empty()) {
+        SPDLOG_WARN("{} children not closed in {}ms, terminate them.", GetName(), budget);
+        if (job_) {
+            TerminateJobObject(job_, -1);
+        } else {
+            for (auto process : processes)
+                TerminateProcess(process, -1);
+        }
+        WaitForMultipleObjects((DWORD)processes.size(), processes.data(), TRUE, 500);
+    }
+
+    // No writer is left once children exit, so the read thread ends after the pipe is drained.
+    if (readThread) {
+        CloseHandle(stdOutWrite_);
+        stdOutWrite_ = NULL;
+        ULONGLONG now = GetTickCount64();
+        DWORD remaining = (startTick + budget > now) ? (DWORD)(startTick + budget - now) : 0;
+        SetStatus(SERVICE_STOP_PENDING, NO_ERROR, remaining + 1000);
+        WaitForSingleObject(readThread, remaining);
+    }
+    spdlog::default_logger()->flush();
+
+    SPDLOG_INFO("{} stopped {} children in {}ms of {}ms budget.", GetName(), processes.size(),
+        GetTickCount64() - startTick, budget);
+}
+
+void WSAgent::ReleaseChild(PROCESS_INFORMATION& pi)
+{
+    childRunning_ = false;
+    RecordUsage();
+    SetChildPid(0);
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+    ZeroMemory(&pi, sizeof(pi));
+}
+
+void WSAgent::RunOnDemand(const WSvcActivation& activation)
+{
+    activation_ = activation;
+
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        SPDLOG_ERROR("WSAStartup failed! WinApi@");
+        SetStatus(SERVICE_STOPPED, ERROR_NOT_SUPPORTED, 0);
+        return;
+    }
+
+    sockaddr_in addr;
+    ZeroMemory(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((u_short)activation.listenPort);
+    listener_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener_ == INVALID_SOCKET
+        || bind(listener_, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR
+        || listen(listener_, SOMAXCONN) == SOCKET_ERROR) {
+        SPDLOG_ERROR("{} listen on 127.0.0.1:{} failed! WinApi@", GetName(), activation.listenPort);
+        SetStatus(SERVICE_STOPPED, WSAGetLastError(), 0);
+        return;
+    }
+
+    activateEvent_ = CreateEvent(NULL, FALSE, FALSE, NULL);
+    HANDLE hAcceptThread = activateEvent_ ? CreateThread(NULL, 0, AcceptThread, this, 0, NULL) : NULL;
+    if (hAcceptThread == NULL) {
+        SPDLOG_ERROR("CreateThread failed! WinApi@");
+        SetStatus(SERVICE_STOPPED, GetLastError(), 0);
+        return;
+    }
+    CloseHandle(hAcceptThread);
+
+    SPDLOG_INFO("cmd:{} on demand: {}", GetPath(), activation.ToString());
+    SetStatus(SERVICE_RUNNING, NO_ERROR, 0);
+
+    // A command that fails to spawn or exits during startup is retried with a growing delay,
+    // and each failure ends the connections waiting for it through spawnEpoch_.
+    PROCESS_INFORMATION pi = {0,};
+    ULONGLONG spawnTick = 0;
+    ULONGLONG retryTick = 0;
+    DWORD failureNum = 0;
+    auto failSpawn = [&] {
+        failureNum++;
+        retryTick = GetTickCount64() + (std::min)(1000ULL << (std::min)(failureNum - 1, (DWORD)6), 60000ULL);
+        spawnEpoch_++;
+    };
+    while (true) {
+        HANDLE waitHandles[3] = {stopEvent_, activateEvent_, pi.hProcess};
+        DWORD waitCount = pi.hProcess ? 3 : 2;
+        DWORD dwEvent = WaitForMultipleObjects(waitCount, waitHandles, FALSE, 1000);
+        switch (dwEvent) {
+            case WAIT_OBJECT_0 + 0:
+                SPDLOG_INFO("{} ({}) receive stop event, prepare stop it.", GetName(), pi.dwProcessId);
+                closesocket(listener_);
+                if (pi.hProcess) {
+                    StopChildren({&pi}, NULL);
+                    ReleaseChild(pi);
+                }
+                SetStatus(SERVICE_STOPPED, NO_ERROR, 0);
+                ExitProcess(0);
+                return;
+            case WAIT_OBJECT_0 + 1:
+                if (pi.hProcess)
+                    break;
+                if (GetTickCount64() < retryTick) {
+                    SPDLOG_WARN("{} activation refused for {}ms after {} failures.", GetName(),
+                        retryTick - GetTickCount64(), failureNum);
+                    spawnEpoch_++;
+                    break;
+                }
+                spawnTick = GetTickCount64();
+                if (SpawnChild(pi)) {
+                    childRunning_ = true;
+                    SPDLOG_INFO("{} ({}) activated on demand.", GetName(), pi.dwProcessId);
+                } else {
+                    failSpawn();
+                    SPDLOG_ERROR("{} activation failed {} times in a row.", GetName(), failureNum);
+                }
+                break;
+            case WAIT_OBJECT_0 + 2: {
+                ULONGLONG uptime = GetTickCount64() - spawnTick;
+                SPDLOG_INFO("{} ({}) process exit after {}s.", GetName(), pi.dwProcessId, uptime / 1000);
+                ReleaseChild(pi);
+                if (uptime < 10000) {
+                    failSpawn();
+                } else {
+                    failureNum = 0;
+                    if (activeConnections_ > 0)
+                        SetEvent(activateEvent_);
+                }
+                break;
+            }
+            case WAIT_TIMEOUT:
+                if (pi.hProcess && activation.idleTimeout && activeConnections_ == 0
+                    && GetTickCount64() - lastActivity_ > activation.idleTimeout * 1000ULL) {
+                    SPDLOG_INFO("{} ({}) idle for {}s, stop it.", GetName(), pi.dwProcessId, activation.idleTimeout);
+                    StopChild(pi);
+                    ReleaseChild(pi);
+                    failureNum = 0;
+                }
+                break;
+            default:
+                SPDLOG_INFO("Unknown error.");
+        }
+    }
+}
+
+SOCKET WSAgent::ConnectChild(ULONGLONG deadline, uint32_t spawnEpoch)
+{
+    sockaddr_in addr;
+    ZeroMemory(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((u_short)activation_.targetPort);
+
+    // The command may still be starting, so retry until it accepts, its spawn fails or the deadline passes.
+    while (GetTickCount64() < deadline) {
+        if (spawnEpoch_ != spawnEpoch) {
+            SPDLOG_WARN("{} activation failed, drop the connection.", GetName());
+            break;
+        }
+
+        SOCKET upstream = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (upstream == INVALID_SOCKET)
+            return INVALID_SOCKET;
+        if (connect(upstream, (sockaddr*)&addr, sizeof(addr)) != SOCKET_ERROR)
+            return upstream;
+        closesocket(upstream);
+
+        if (WaitForSingleObject(stopEvent_, 100) == WAIT_OBJECT_0)
+            break;
+    }
+    return INVALID_SOCKET;
+}
+
+void WSAgent::Relay(SOCKET client, SOCKET upstream)
+{
+    // An EOF only ends its own direction and is passed on as a half close, so replies still arrive.
+    CHAR buffer[8192];
+    bool isClientOpen = true;
+    bool isUpstreamOpen = true;
+    auto forward = [&](SOCKET from, SOCKET to, bool& isOpen) {
+        int size = recv(from, buffer, sizeof(buffer), 0);
+        if (size < 0)
+            return false;
+        if (size == 0) {
+            shutdown(to, SD_SEND);
+            isOpen = false;
+            return true;
+        }
+
+        for (int sent = 0; sent < size;) {
+            int n = send(to, buffer + sent, size - sent, 0);
+            if (n <= 0)
+                return false;
+            sent += n;
+        }
+        lastActivity_ = GetTickCount64();
+        return true;
+    };
+
+    while (isClientOpen || isUpstreamOpen) {
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        if (isClientOpen)
+            FD_SET(client, &readSet);
+        if (isUpstreamOpen)
+            FD_SET(upstream, &readSet);
+        if (select(0, &readSet, NULL, NULL, NULL) == SOCKET_ERROR)
+            return;
+
+        if (isClientOpen && FD_ISSET(client, &readSet) && !forward(client, upstream, isClientOpen))
+            return;
+        if (isUpstreamOpen && FD_ISSET(upstream, &readSet) && !forward(upstream, client, isUpstreamOpen))
+            return;
+    }
+}
+
+DWORD WSAgent::GetChildPid()
+{
+    WSRegKey regKey(GetName());
+    return regKey.GetDWord("ChildProcessId").value_or(0);
+}
+
+void WSAgent::SetChildPid(DWORD processId)
+{
+    WSRegKey regKey(GetName(), KEY_READ | KEY_SET_VALUE);
+    if (processId)
+        regKey.SetDWord("ChildProcessId", processId);
+    else
+        regKey.DeleteValue("ChildProcessId");
+}
+
+std::optional<WSvcSched> WSAgent::GetEffectiveSched()
+{
+    DWORD processId = GetChildPid();
+    if (!processId)
+        return std::nullopt;
+    return GetProcessSched(processId);
+}
+
+bool WSAgent::CreateJob()
+{
+    job_ = CreateJobObject(NULL, NULL);
+    if (!job_) {
+        SPDLOG_ERROR("CreateJobObject failed! WinApi@");
+        return false;
+    }
+
+    // Children never outlive the agent, even if it is killed.
+    WSvcLimit limit = GetLimit();
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION eli;
+    ZeroMemory(&eli, sizeof(eli));
+    eli.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+    if (limit.memoryLimit) {
+        eli.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_JOB_MEMORY;
+        eli.JobMemoryLimit = (SIZE_T)limit.memoryLimit;
+    }
+    if (limit.processLimit) {
+        eli.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_ACTIVE_PROCESS;
+        eli.BasicLimitInformation.ActiveProcessLimit = limit.processLimit;
+    }
+    if (!SetInformationJobObject(job_, JobObjectExtendedLimitInformation, &eli, sizeof(eli))) {
+        SPDLOG_ERROR("SetInformationJobObject({}) failed! WinApi@", limit.ToString());
+        return false;
+    }
+
+    if (limit.cpuRate) {
+        JOBOBJECT_CPU_RATE_CONTROL_INFORMATION crci;
+        ZeroMemory(&crci, sizeof(crci));
+        crci.ControlFlags = JOB_OBJECT_CPU_RATE_CONTROL_ENABLE | JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP;
+        crci.CpuRate = (limit.cpuRate > 100 ? 100 : limit.cpuRate) * 100;
+        if (!SetInformationJobObject(job_, JobObjectCpuRateControlInformation, &crci, sizeof(crci)))
+            SPDLOG_ERROR("SetInformationJobObject(cpu={}%) failed! WinApi@", limit.cpuRate);
+    }
+
+    jobPort_ = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    if (!jobPort_) {
+        SPDLOG_ERROR("CreateIoCompletionPort failed! WinApi@");
+        return true;
+    }
+
+    JOBOBJECT_ASSOCIATE_COMPLETION_PORT acp;
+    acp.CompletionKey = job_;
+    acp.CompletionPort = jobPort_;
+    if (!SetInformationJobObject(job_, JobObjectAssociateCompletionPortInformation, &acp, sizeof(acp))) {
+        SPDLOG_ERROR("SetInformationJobObject(port) failed! WinApi@");
+        CloseHandle(jobPort_);
+        jobPort_ = NULL;
+        return true;
+    }
+
+    if (!limit.IsUnlimited())
+        SPDLOG_INFO("{} job limit: {}", GetName(), limit.ToString());
+    return true;
+}
+
+WSvcUsage WSAgent::QueryJobUsage()
+{
+    WSvcUsage usage;
+    usage.limitHits = limitHits_;
+    if (!job_)
+        return usage;
+
+    JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION bai;
+    if (QueryInformationJobObject(job_, JobObjectBasicAndIoAccountingInformation, &bai, sizeof(bai), NULL)) {
+        usage.cpuTime = bai.BasicInfo.TotalUserTime.QuadPart + bai.BasicInfo.TotalKernelTime.QuadPart;
+        usage.readBytes = bai.IoInfo.ReadTransferCount;
+        usage.writeBytes = bai.IoInfo.WriteTransferCount;
+        usage.activeProcesses = bai.BasicInfo.ActiveProcesses;
+    }
+
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION eli;
+    if (QueryInformationJobObject(job_, JobObjectExtendedLimitInformation, &eli, sizeof(eli), NULL))
+        usage.peakMemory = eli.PeakJobMemoryUsed;
+    return usage;
+}
+
+void WSAgent::RecordUsage()
+{
+    WSvcUsage usage = QueryJobUsage();
+    WSRegKey regKey(GetName(), KEY_READ | KEY_SET_VALUE);
+    regKey.SetQWord("UsageCpuTime", usage.cpuTime);
+    regKey.SetQWord("UsagePeakMemory", usage.peakMemory);
+    regKey.SetQWord("UsageReadBytes", usage.readBytes);
+    regKey.SetQWord("UsageWriteBytes", usage.writeBytes);
+    regKey.SetDWord("UsageProcesses", usage.activeProcesses);
+    regKey.SetDWord("UsageLimitHits", usage.limitHits);
+    SPDLOG_DEBUG("{} usage: {}", GetName(), usage.ToString());
+}
+
+WSvcUsage WSAgent::GetUsage()
+{
+    WSvcUsage usage;
+    WSRegKey regKey(GetName());
+    usage.cpuTime = regKey.GetQWord("UsageCpuTime").value_or(0);
+    usage.peakMemory = regKey.GetQWord("UsagePeakMemory").value_or(0);
+    usage.readBytes = regKey.GetQWord("UsageReadBytes").value_or(0);
+    usage.writeBytes = regKey.GetQWord("UsageWriteBytes").value_or(0);
+    usage.activeProcesses = regKey.GetDWord("UsageProcesses").value_or(0);
+    usage.limitHits = regKey.GetDWord("UsageLimitHits").value_or(0);
+    return usage;
+}
+
+WSvcSched WSAgent::GetCurrentSched(bool isRunning)
+{
+    if (isRunning) {
+        auto effective = GetEffectiveSched();
+        if (effective)
+            return effective.value();
+    }
+    return GetSched();
+}
+
 DWORD WINAPI WSAgent::CtrlHandlerProc(
     DWORD control,
     DWORD eventType,
@@ -172,9 +876,11 @@ DWORD WINAPI WSAgent::CtrlHandlerProc(
     WSAgent& app = *(WSAgent*)context;
     switch (control) {
         case SERVICE_CONTROL_STOP:
-            app.SetStatus(SERVICE_STOP_PENDING, NO_ERROR, 0);
+        case SERVICE_CONTROL_PRESHUTDOWN:
+        case SERVICE_CONTROL_SHUTDOWN:
+            app.stopControl_ = control;
+            app.SetStatus(SERVICE_STOP_PENDING, NO_ERROR, app.GetStopBudget(control) + 1000);
             SetEvent(app.stopEvent_);
-            app.SetStatus(app.svcStatus_.dwCurrentState, NO_ERROR, 0);
             break;
 
         case SERVICE_CONTROL_INTERROGATE:
@@ -205,6 +911,127 @@ DWORD WINAPI WSAgent::StdReadThread(LPVOID lpParam)
     return 0;
 }
 
+DWORD WINAPI WSAgent::StandbyReadThread(LPVOID lpParam)
+{
+    std::unique_ptr<WSStandbyPipe> context(reinterpret_cast<WSStandbyPipe*>(lpParam));
+    auto& app = *context->app;
+    const std::string& marker = context->marker;
+    std::string tail;
+    CHAR buffer[2048];
+    DWORD numOfRead;
+    while (ReadFile(context->stdOutRead, buffer, 2048, &numOfRead, NULL) && numOfRead > 0) {
+        std::string content(buffer, numOfRead);
+        WriteServiceLog(app.GetName(), content);
+        if (marker.empty() || !context->readyEvent)
+            continue;
+
+        // Keep the end of previous read, the marker may be split across two reads.
+        tail += content;
+        if (tail.find(marker) != std::string::npos) {
+            SetEvent(context->readyEvent);
+            CloseHandle(context->readyEvent);
+            context->readyEvent = NULL;
+        } else if (tail.size() >= marker.size()) {
+            tail.erase(0, tail.size() - marker.size() + 1);
+        }
+    }
+
+    if (context->readyEvent)
+        CloseHandle(context->readyEvent);
+    CloseHandle(context->stdOutRead);
+    return 0;
+}
+
+DWORD WINAPI WSAgent::JobMonitorThread(LPVOID lpParam)
+{
+    auto& app = *reinterpret_cast<WSAgent*>(lpParam);
+    DWORD message;
+    ULONG_PTR completionKey;
+    LPOVERLAPPED overlapped;
+    while (GetQueuedCompletionStatus(app.jobPort_, &message, &completionKey, &overlapped, INFINITE)) {
+        DWORD processId = (DWORD)(ULONG_PTR)overlapped;
+        const char* limitName = nullptr;
+        switch (message) {
+            case JOB_OBJECT_MSG_JOB_MEMORY_LIMIT:
+                limitName = "job memory";
+                break;
+            case JOB_OBJECT_MSG_PROCESS_MEMORY_LIMIT:
+                limitName = "process memory";
+                break;
+            case JOB_OBJECT_MSG_ACTIVE_PROCESS_LIMIT:
+                limitName = "active process";
+                break;
+            case JOB_OBJECT_MSG_ABNORMAL_EXIT_PROCESS:
+                SPDLOG_WARN("{} ({}) exit abnormally.", app.GetName(), processId);
+                break;
+            default:
+                break;
+        }
+
+        if (!limitName)
+            continue;
+
+        app.limitHits_++;
+        SPDLOG_WARN("{} ({}) hit {} limit: {}", app.GetName(), processId, limitName, app.GetLimit().ToString());
+        WriteServiceLog(app.GetName(), fmt::format("[{}] process {} hit {} limit.\n", GetProgramName(), processId, limitName));
+        app.RecordUsage();
+    }
+
+    return 0;
+}
+
+DWORD WINAPI WSAgent::AcceptThread(LPVOID lpParam)
+{
+    auto& app = *reinterpret_cast<WSAgent*>(lpParam);
+    while (true) {
+        SOCKET client = accept(app.listener_, NULL, NULL);
+        if (client == INVALID_SOCKET) {
+            SPDLOG_INFO("{} stop accepting.", app.GetName());
+            break;
+        }
+
+        // The epoch is taken before asking for activation, so a failure of that spawn is never missed.
+        app.activeConnections_++;
+        app.lastActivity_ = GetTickCount64();
+        uint32_t spawnEpoch = app.spawnEpoch_;
+        if (!app.childRunning_)
+            SetEvent(app.activateEvent_);
+
+        auto* context = new WSProxyContext{&app, client, spawnEpoch};
+        HANDLE hProxyThread = CreateThread(NULL, 0, ProxyThread, context, 0, NULL);
+        if (hProxyThread == NULL) {
+            SPDLOG_ERROR("CreateThread failed! WinApi@");
+            closesocket(client);
+            app.activeConnections_--;
+            delete context;
+            continue;
+        }
+        CloseHandle(hProxyThread);
+    }
+
+    return 0;
+}
+
+DWORD WINAPI WSAgent::ProxyThread(LPVOID lpParam)
+{
+    std::unique_ptr<WSProxyContext> context(reinterpret_cast<WSProxyContext*>(lpParam));
+    auto& app = *context->app;
+    ULONGLONG acceptTick = GetTickCount64();
+    SOCKET upstream = app.ConnectChild(acceptTick + 30000, context->spawnEpoch);
+    if (upstream == INVALID_SOCKET) {
+        SPDLOG_ERROR("{} connect 127.0.0.1:{} failed!", app.GetName(), app.activation_.targetPort);
+    } else {
+        SPDLOG_INFO("{} connection ready in {}ms.", app.GetName(), GetTickCount64() - acceptTick);
+        app.Relay(context->client, upstream);
+        closesocket(upstream);
+    }
+
+    closesocket(context->client);
+    app.lastActivity_ = GetTickCount64();
+    app.activeConnections_--;
+    return 0;
+}
+
 BOOL CALLBACK WSAgent::WindowCloserProc(HWND hWnd, LPARAM lParam)
 {
     if ((GetWindowThreadProcessId(hWnd, NULL) == lParam) && !(GetWindowLong(hWnd, GWL_STYLE) & WS_CHILD))
@@ -212,24 +1039,37 @@ BOOL CALLBACK WSAgent::WindowCloserProc(HWND hWnd, LPARAM lParam)
     return TRUE;
 }
 
-bool WSAgent::SetStatus(DWORD currentState, DWORD win32ExitCode, DWORD waitHint)
+BOOL CALLBACK WSAgent::ProcessCloserProc(HWND hWnd, LPARAM lParam)
 {
-    static DWORD dwCheckPoint = 1;
+    auto& processIds = *reinterpret_cast<std::vector<DWORD>*>(lParam);
+    DWORD processId = 0;
+    GetWindowThreadProcessId(hWnd, &processId);
+    if (std::find(processIds.begin(), processIds.end(), processId) != processIds.end()
+        && !(GetWindowLong(hWnd, GWL_STYLE) & WS_CHILD))
+        PostMessage(hWnd, WM_CLOSE, 0, 0);
+    return TRUE;
+}
 
+bool WSAgent::SetStatus(DWORD currentState, DWORD win32ExitCode, DWORD waitHint)
+{
     svcStatus_.dwCurrentState = currentState;
     svcStatus_.dwWin32ExitCode = win32ExitCode;
     svcStatus_.dwWaitHint = waitHint;
 
-    if (currentState == SERVICE_START_PENDING)
+    if (currentState == SERVICE_START_PENDING
+        || currentState == SERVICE_STOP_PENDING)
         svcStatus_.dwControlsAccepted = 0;
     else
-        svcStatus_.dwControlsAccepted = SERVICE_ACCEPT_STOP;
+        svcStatus_.dwControlsAccepted = SERVICE_ACCEPT_STOP | SERVICE_ACCEPT_PRESHUTDOWN | SERVICE_ACCEPT_SHUTDOWN;
 
+    // The control handler and the stop loop both report progress, every pending phase counts from one.
     if (currentState == SERVICE_RUNNING
-        || currentState == SERVICE_STOPPED)
+        || currentState == SERVICE_STOPPED) {
+        checkPoint_ = 0;
         svcStatus_.dwCheckPoint = 0;
-    else
-        svcStatus_.dwCheckPoint = dwCheckPoint++;
+    } else {
+        svcStatus_.dwCheckPoint = ++checkPoint_;
+    }
 
     return SetServiceStatus(svcStatusHandle_, &svcStatus_);
 }
@@ -5,21 +5,51 @@
 class WSAgent : public WSApp
 {
 public:
+    static std::string_view GetCommand(std::string_view binaryPath);
     static std::string GetPath(const std::string& cmd);
 
     WSAgent(const std::string& name, const std::string& alias = "");
     ~WSAgent();
 
     bool Install(const std::string& path) override;
+    bool SetPath(const std::string& path) override;
     void Dispatch();
     std::string GetPath() const override;
+    DWORD GetChildPid();
+    std::optional<WSvcSched> GetEffectiveSched();
+    WSvcSched GetCurrentSched(bool isRunning);
+    WSvcUsage GetUsage();
 
 private:
+    std::optional<std::string> GetAgentPath(const std::string& path);
     static VOID WINAPI ServiceMainProc(DWORD argc, LPTSTR *argv);
     static DWORD WINAPI CtrlHandlerProc(DWORD control, DWORD eventType, LPVOID eventData, LPVOID context);
     static DWORD WINAPI StdReadThread(LPVOID lpParam);
+    static DWORD WINAPI StandbyReadThread(LPVOID lpParam);
+    static DWORD WINAPI JobMonitorThread(LPVOID lpParam);
+    static DWORD WINAPI AcceptThread(LPVOID lpParam);
+    static DWORD WINAPI ProxyThread(LPVOID lpParam);
     static BOOL CALLBACK WindowCloserProc(HWND hWnd, LPARAM lParam);
+    static BOOL CALLBACK ProcessCloserProc(HWND hWnd, LPARAM lParam);
     bool SetStatus(DWORD currentState, DWORD win32ExitCode, DWORD waitHint);
+    bool SpawnChild(PROCESS_INFORMATION& pi, HANDLE stdOut = NULL, bool isActive = true);
+    bool SpawnStandby();
+    bool CheckStandby();
+    bool CheckFailover(const PROCESS_INFORMATION& pi);
+    bool IsChildReady(HANDLE readyEvent);
+    void DiscardStandby();
+    void PromoteStandby(PROCESS_INFORMATION& pi);
+    void StopChild(PROCESS_INFORMATION& pi);
+    void StopChildren(const std::vector<PROCESS_INFORMATION*>& children, HANDLE readThread);
+    DWORD GetStopBudget(DWORD control);
+    void ReleaseChild(PROCESS_INFORMATION& pi);
+    void RunOnDemand(const WSvcActivation& activation);
+    SOCKET ConnectChild(ULONGLONG deadline, uint32_t spawnEpoch);
+    void Relay(SOCKET client, SOCKET upstream);
+    void SetChildPid(DWORD processId);
+    bool CreateJob();
+    WSvcUsage QueryJobUsage();
+    void RecordUsage();
 
 private:
     SERVICE_STATUS svcStatus_;
@@ -27,4 +57,25 @@ private:
     HANDLE stdOutRead_;
     HANDLE stdOutWrite_;
     HANDLE stopEvent_;
+    std::atomic<DWORD> stopControl_;
+    std::atomic<DWORD> checkPoint_;
+    HANDLE job_;
+    HANDLE jobPort_;
+    std::atomic<unsigned long> limitHits_;
+    WSvcActivation activation_;
+    SOCKET listener_;
+    HANDLE activateEvent_;
+    std::atomic<bool> childRunning_;
+    std::atomic<uint32_t> spawnEpoch_;
+    std::atomic<long> activeConnections_;
+    std::atomic<ULONGLONG> lastActivity_;
+    WSvcStandby standbyConfig_;
+    PROCESS_INFORMATION standby_;
+    HANDLE standbyReady_;
+    ULONGLONG standbyTick_;
+    bool standbyIsReady_;
+    ULONGLONG coldReadyMs_;
+    HANDLE failoverReady_;
+    ULONGLONG failoverExitTick_;
+    ULONGLONG failoverSpawnTick_;
 };
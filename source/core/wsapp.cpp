@@ -2,7 +2,7 @@
 #include "core/wsgeneral.h"
 
 WSApp::WSApp(const std::string& name, const std::string& alias)
-    : name_(name), alias_(alias)
+    : error_(NO_ERROR), name_(name), alias_(alias)
 {
     if (alias_.empty())
         alias_ = name_;
@@ -15,7 +15,7 @@ WSApp::~WSApp()
 bool WSApp::Install(const std::string& path)
 {
     WSHandle wsHandle(SC_MANAGER_CREATE_SERVICE);
-    if (!wsHandle.Check())
+    if (!CheckHandle(wsHandle))
         return false;
 
     TCHAR executedPath[MAX_PATH];
@@ -30,6 +30,7 @@ bool WSApp::Install(const std::string& path)
         executedPath,
         NULL, NULL, NULL, NULL, NULL);
     if (!service) {
+        error_ = GetLastError();
         SPDLOG_ERROR("CreateService({}) failed! WinApi@", name_);
         return false;
     }
@@ -42,10 +43,11 @@ bool WSApp::Install(const std::string& path)
 bool WSApp::Uninstall()
 {
     WSHandle wsHandle(SC_MANAGER_ENUMERATE_SERVICE, DELETE, name_);
-    if (!wsHandle.Check())
+    if (!CheckHandle(wsHandle))
         return false;
 
     if (!::DeleteService(wsHandle.Service)) {
+        error_ = GetLastError();
         SPDLOG_ERROR("DeleteService({}) failed! WinApi@", name_);
         return false;
     }
@@ -56,11 +58,13 @@ bool WSApp::Uninstall()
 
 bool WSApp::SetDescription(const std::string& desc)
 {
-    if (desc.empty())
+    if (desc.empty()) {
+        error_ = ERROR_INVALID_PARAMETER;
         return false;
+    }
 
     WSHandle wsHandle(SC_MANAGER_CREATE_SERVICE, SERVICE_CHANGE_CONFIG, name_);
-    if (!wsHandle.Check())
+    if (!CheckHandle(wsHandle))
         return false;
 
     SERVICE_DESCRIPTION sd;
@@ -69,6 +73,7 @@ bool WSApp::SetDescription(const std::string& desc)
             wsHandle.Service,
             SERVICE_CONFIG_DESCRIPTION,
             &sd)) {
+        error_ = GetLastError();
         SPDLOG_ERROR("ChangeServiceConfig2({}) failed! WinApi@", name_);
         return false;
     }
@@ -77,6 +82,185 @@ bool WSApp::SetDescription(const std::string& desc)
     return true;
 }
 
+DWORD WSApp::GetPreshutdownTimeout()
+{
+    // Windows 10 and later default to 10 seconds when the service does not set its own.
+    DWORD timeoutMS = 10000;
+    WSHandle wsHandle(SC_MANAGER_CONNECT, SERVICE_QUERY_CONFIG, name_);
+    if (!CheckHandle(wsHandle))
+        return timeoutMS;
+
+    SERVICE_PRESHUTDOWN_INFO spi;
+    DWORD bytesNeeded;
+    if (!QueryServiceConfig2(wsHandle.Service, SERVICE_CONFIG_PRESHUTDOWN_INFO, (LPBYTE)&spi, sizeof(spi), &bytesNeeded)) {
+        error_ = GetLastError();
+        SPDLOG_ERROR("QueryServiceConfig2({}) failed! WinApi@", name_);
+        return timeoutMS;
+    }
+    return spi.dwPreshutdownTimeout;
+}
+
+bool WSApp::SetPreshutdownTimeout(DWORD timeoutMS)
+{
+    WSHandle wsHandle(SC_MANAGER_CONNECT, SERVICE_CHANGE_CONFIG, name_);
+    if (!CheckHandle(wsHandle))
+        return false;
+
+    SERVICE_PRESHUTDOWN_INFO spi;
+    spi.dwPreshutdownTimeout = timeoutMS;
+    if (!ChangeServiceConfig2(wsHandle.Service, SERVICE_CONFIG_PRESHUTDOWN_INFO, &spi)) {
+        error_ = GetLastError();
+        SPDLOG_ERROR("ChangeServiceConfig2({}) failed! WinApi@", name_);
+        return false;
+    }
+
+    SPDLOG_INFO("{} service preshutdown timeout updated: {}ms", name_, timeoutMS);
+    return true;
+}
+
+WSvcSched WSApp::GetSched()
+{
+    WSvcSched sched;
+    WSRegKey regKey(name_);
+    if (!regKey.Check())
+        return sched;
+
+    sched.affinityMask = regKey.GetQWord("AffinityMask").value_or(sched.affinityMask);
+    sched.numaNode = regKey.GetDWord("NumaNode").value_or(sched.numaNode);
+    sched.priorityClass = regKey.GetDWord("PriorityClass").value_or(sched.priorityClass);
+    sched.memoryPriority = regKey.GetDWord("MemoryPriority").value_or(sched.memoryPriority);
+    sched.ioPriority = regKey.GetDWord("IoPriority").value_or(sched.ioPriority);
+    return sched;
+}
+
+bool WSApp::SetSched(const WSvcSched& sched)
+{
+    WSRegKey regKey(name_, KEY_READ | KEY_SET_VALUE);
+    if (!regKey.Check())
+        return false;
+
+    bool result = true;
+    if (sched.affinityMask)
+        result &= regKey.SetQWord("AffinityMask", sched.affinityMask);
+    else
+        result &= regKey.DeleteValue("AffinityMask");
+
+    const std::pair<const char*, unsigned long> values[] = {
+        {"NumaNode", sched.numaNode},
+        {"PriorityClass", sched.priorityClass},
+        {"MemoryPriority", sched.memoryPriority},
+        {"IoPriority", sched.ioPriority},
+    };
+    for (auto& [valueName, value] : values) {
+        if (value != WSvcSched::Inherit)
+            result &= regKey.SetDWord(valueName, value);
+        else
+            result &= regKey.DeleteValue(valueName);
+    }
+
+    if (result)
+        SPDLOG_INFO("{} service sched updated: {}", name_, sched.ToString());
+    return result;
+}
+
+WSvcLimit WSApp::GetLimit()
+{
+    WSvcLimit limit;
+    WSRegKey regKey(name_);
+    if (!regKey.Check())
+        return limit;
+
+    limit.memoryLimit = regKey.GetQWord("JobMemoryLimit").value_or(limit.memoryLimit);
+    limit.cpuRate = regKey.GetDWord("CpuRateLimit").value_or(limit.cpuRate);
+    limit.processLimit = regKey.GetDWord("ActiveProcessLimit").value_or(limit.processLimit);
+    return limit;
+}
+
+bool WSApp::SetLimit(const WSvcLimit& limit)
+{
+    WSRegKey regKey(name_, KEY_READ | KEY_SET_VALUE);
+    if (!regKey.Check())
+        return false;
+
+    bool result = true;
+    if (limit.memoryLimit)
+        result &= regKey.SetQWord("JobMemoryLimit", limit.memoryLimit);
+    else
+        result &= regKey.DeleteValue("JobMemoryLimit");
+
+    if (limit.cpuRate)
+        result &= regKey.SetDWord("CpuRateLimit", limit.cpuRate);
+    else
+        result &= regKey.DeleteValue("CpuRateLimit");
+
+    if (limit.processLimit)
+        result &= regKey.SetDWord("ActiveProcessLimit", limit.processLimit);
+    else
+        result &= regKey.DeleteValue("ActiveProcessLimit");
+
+    if (result)
+        SPDLOG_INFO("{} service limit updated: {}", name_, limit.ToString());
+    return result;
+}
+
+WSvcActivation WSApp::GetActivation()
+{
+    WSvcActivation activation;
+    WSRegKey regKey(name_);
+    if (!regKey.Check())
+        return activation;
+
+    activation.listenPort = regKey.GetDWord("ListenPort").value_or(activation.listenPort);
+    activation.targetPort = regKey.GetDWord("TargetPort").value_or(activation.targetPort);
+    activation.idleTimeout = regKey.GetDWord("IdleTimeout").value_or(activation.idleTimeout);
+    return activation;
+}
+
+bool WSApp::SetActivation(const WSvcActivation& activation)
+{
+    WSRegKey regKey(name_, KEY_READ | KEY_SET_VALUE);
+    if (!regKey.Check())
+        return false;
+
+    bool result = true;
+    result &= regKey.SetDWord("ListenPort", activation.listenPort);
+    result &= regKey.SetDWord("TargetPort", activation.targetPort);
+    result &= regKey.SetDWord("IdleTimeout", activation.idleTimeout);
+    if (result)
+        SPDLOG_INFO("{} service activation updated: {}", name_, activation.ToString());
+    return result;
+}
+
+WSvcStandby WSApp::GetStandby()
+{
+    WSvcStandby standby;
+    WSRegKey regKey(name_);
+    if (!regKey.Check())
+        return standby;
+
+    standby.enabled = regKey.GetDWord("Standby").value_or(0) != 0;
+    standby.readyFile = regKey.GetString("ReadyFile").value_or(standby.readyFile);
+    standby.readyMarker = regKey.GetString("ReadyMarker").value_or(standby.readyMarker);
+    standby.readyTimeout = regKey.GetDWord("ReadyTimeout").value_or(standby.readyTimeout);
+    return standby;
+}
+
+bool WSApp::SetStandby(const WSvcStandby& standby)
+{
+    WSRegKey regKey(name_, KEY_READ | KEY_SET_VALUE);
+    if (!regKey.Check())
+        return false;
+
+    bool result = true;
+    result &= regKey.SetDWord("Standby", standby.enabled ? 1 : 0);
+    result &= regKey.SetString("ReadyFile", standby.readyFile);
+    result &= regKey.SetString("ReadyMarker", standby.readyMarker);
+    result &= regKey.SetDWord("ReadyTimeout", standby.readyTimeout);
+    if (result)
+        SPDLOG_INFO("{} service standby updated: {}", name_, standby.ToString());
+    return result;
+}
+
 std::optional<WSvcConfig> WSApp::GetConfig(bool hasDesc)
 {
     std::optional<WSvcConfig> result = std::nullopt;
@@ -84,13 +268,14 @@ std::optional<WSvcConfig> WSApp::GetConfig(bool hasDesc)
     LPSERVICE_DESCRIPTION lpsd = NULL;
 
     WSHandle wsHandle(SC_MANAGER_ENUMERATE_SERVICE, SERVICE_QUERY_CONFIG, name_);
-    if (!wsHandle.Check())
+    if (!CheckHandle(wsHandle))
         goto svc_cleanup;
 
     DWORD bytesNeeded, bufSize, lastError;
     if (!QueryServiceConfig(wsHandle.Service, NULL, 0, &bytesNeeded)) {
         lastError = GetLastError();
         if (ERROR_INSUFFICIENT_BUFFER != lastError) {
+            error_ = lastError;
             SPDLOG_ERROR("QueryServiceConfig({}) failed! WinApi@", name_);
             goto svc_cleanup;
         }
@@ -100,6 +285,7 @@ std::optional<WSvcConfig> WSApp::GetConfig(bool hasDesc)
     }
 
     if (!QueryServiceConfig(wsHandle.Service, lpsc, bufSize, &bytesNeeded)) {
+        error_ = GetLastError();
         SPDLOG_ERROR("QueryServiceConfig({}) failed! WinApi@", name_);
         goto svc_cleanup;
     }
@@ -110,6 +296,7 @@ std::optional<WSvcConfig> WSApp::GetConfig(bool hasDesc)
                 bufSize = bytesNeeded;
                 lpsd = (LPSERVICE_DESCRIPTION) LocalAlloc(LMEM_FIXED, bufSize);
                 if (!QueryServiceConfig2(wsHandle.Service, SERVICE_CONFIG_DESCRIPTION, (LPBYTE) lpsd, bufSize, &bytesNeeded)) {
+                    error_ = GetLastError();
                     SPDLOG_ERROR("QueryServiceConfig2({}) failed! WinApi@", name_);
                     goto svc_cleanup;
                 }
@@ -132,10 +319,40 @@ svc_cleanup:
     return std::move(result);
 }
 
+std::optional<std::string> WSApp::GetDescription()
+{
+    std::optional<std::string> result = std::nullopt;
+    LPSERVICE_DESCRIPTION lpsd = NULL;
+
+    WSHandle wsHandle(SC_MANAGER_ENUMERATE_SERVICE, SERVICE_QUERY_CONFIG, name_);
+    if (!CheckHandle(wsHandle))
+        return result;
+
+    DWORD bytesNeeded = 0;
+    if (!QueryServiceConfig2(wsHandle.Service, SERVICE_CONFIG_DESCRIPTION, NULL, 0, &bytesNeeded)) {
+        if (ERROR_INSUFFICIENT_BUFFER != GetLastError()) {
+            error_ = GetLastError();
+            SPDLOG_ERROR("QueryServiceConfig2({}) failed! WinApi@", name_);
+            return result;
+        }
+    }
+
+    lpsd = (LPSERVICE_DESCRIPTION) LocalAlloc(LMEM_FIXED, bytesNeeded);
+    if (!QueryServiceConfig2(wsHandle.Service, SERVICE_CONFIG_DESCRIPTION, (LPBYTE) lpsd, bytesNeeded, &bytesNeeded)) {
+        error_ = GetLastError();
+        SPDLOG_ERROR("QueryServiceConfig2({}) failed! WinApi@", name_);
+    } else {
+        result = lpsd->lpDescription ? lpsd->lpDescription : "";
+    }
+
+    LocalFree(lpsd);
+    return result;
+}
+
 bool WSApp::SetStartup(DWORD type)
 {
     WSHandle wsHandle(SC_MANAGER_CREATE_SERVICE, SERVICE_CHANGE_CONFIG, name_);
-    if (!wsHandle.Check())
+    if (!CheckHandle(wsHandle))
         return false;
 
     if (!ChangeServiceConfig(
@@ -144,6 +361,7 @@ bool WSApp::SetStartup(DWORD type)
             type,
             SERVICE_NO_CHANGE,
             NULL, NULL, NULL, NULL, NULL, NULL, NULL)) {
+        error_ = GetLastError();
         SPDLOG_ERROR("ChangeServiceConfig({}) failed! WinApi@", name_);
         return false;
     }
@@ -152,10 +370,66 @@ bool WSApp::SetStartup(DWORD type)
     return true;
 }
 
+bool WSApp::SetPath(const std::string& path)
+{
+    WSHandle wsHandle(SC_MANAGER_CONNECT, SERVICE_CHANGE_CONFIG, name_);
+    if (!CheckHandle(wsHandle))
+        return false;
+
+    if (!ChangeServiceConfig(wsHandle.Service, SERVICE_NO_CHANGE, SERVICE_NO_CHANGE, SERVICE_NO_CHANGE,
+            path.data(), NULL, NULL, NULL, NULL, NULL, NULL)) {
+        error_ = GetLastError();
+        SPDLOG_ERROR("ChangeServiceConfig({}) failed! WinApi@", name_);
+        return false;
+    }
+
+    SPDLOG_INFO("{} service path updated successfully.", name_);
+    return true;
+}
+
+bool WSApp::SetAlias(const std::string& alias)
+{
+    WSHandle wsHandle(SC_MANAGER_CONNECT, SERVICE_CHANGE_CONFIG, name_);
+    if (!CheckHandle(wsHandle))
+        return false;
+
+    if (!ChangeServiceConfig(wsHandle.Service, SERVICE_NO_CHANGE, SERVICE_NO_CHANGE, SERVICE_NO_CHANGE,
+            NULL, NULL, NULL, NULL, NULL, NULL, alias.data())) {
+        error_ = GetLastError();
+        SPDLOG_ERROR("ChangeServiceConfig({}) failed! WinApi@", name_);
+        return false;
+    }
+
+    alias_ = alias;
+    SPDLOG_INFO("{} service alias updated successfully.", name_);
+    return true;
+}
+
+bool WSApp::SetDependencies(const std::string& dependencies)
+{
+    WSHandle wsHandle(SC_MANAGER_CONNECT, SERVICE_CHANGE_CONFIG, name_);
+    if (!CheckHandle(wsHandle))
+        return false;
+
+    // '/' separated names become the double null terminated list, an empty list clears them.
+    std::string multiString(dependencies);
+    std::replace(multiString.begin(), multiString.end(), '/', '\0');
+    multiString += '\0';
+    if (!ChangeServiceConfig(wsHandle.Service, SERVICE_NO_CHANGE, SERVICE_NO_CHANGE, SERVICE_NO_CHANGE,
+            NULL, NULL, NULL, multiString.data(), NULL, NULL, NULL)) {
+        error_ = GetLastError();
+        SPDLOG_ERROR("ChangeServiceConfig({}) failed! WinApi@", name_);
+        return false;
+    }
+
+    SPDLOG_INFO("{} service dependencies updated successfully.", name_);
+    return true;
+}
+
 bool WSApp::Start()
 {
     WSHandle wsHandle(SC_MANAGER_ENUMERATE_SERVICE, SERVICE_START | SERVICE_QUERY_STATUS, name_);
-    if (!wsHandle.Check())
+    if (!CheckHandle(wsHandle))
         return false;
 
     std::optional<WSvcStatus> wssopt = GetStatus();
@@ -165,6 +439,7 @@ bool WSApp::Start()
     auto& wss = wssopt.value();
     if (wss.currentState != SERVICE_STOPPED
         && wss.currentState != SERVICE_STOP_PENDING) {
+        error_ = ERROR_SERVICE_ALREADY_RUNNING;
         SPDLOG_ERROR("{} service is already running.", wss.serviceName);
         return false;
     }
@@ -190,6 +465,7 @@ bool WSApp::Start()
             oldCheckPoint = wss.checkPoint;
         } else {
             if (GetTickCount() - startTickCount > wss.waitHint) {
+                error_ = ERROR_SERVICE_REQUEST_TIMEOUT;
                 SPDLOG_ERROR("{} service timeout waiting to stop.", wss.serviceName);
                 return false;
             }
@@ -197,6 +473,7 @@ bool WSApp::Start()
     }
 
     if (!::StartService(wsHandle.Service, 0, NULL)) {
+        error_ = GetLastError();
         SPDLOG_ERROR("StartService({}) failed! WinApi@", wss.serviceName);
         return false;
     }
@@ -233,6 +510,7 @@ bool WSApp::Start()
     }
 
     if (wss.currentState != SERVICE_RUNNING) {
+        error_ = (wss.win32ExitCode != NO_ERROR) ? wss.win32ExitCode : ERROR_SERVICE_REQUEST_TIMEOUT;
         SPDLOG_ERROR("{} service not started with state:{} exitCode:{}",
             wss.serviceName, wss.GetCurrentState(), wss.win32ExitCode);
         return false;
@@ -247,7 +525,7 @@ bool WSApp::Stop(uint32_t timeoutMS)
     WSHandle wsHandle(SC_MANAGER_ENUMERATE_SERVICE, SERVICE_STOP |
         SERVICE_QUERY_STATUS |
         SERVICE_ENUMERATE_DEPENDENTS, name_);
-    if (!wsHandle.Check())
+    if (!CheckHandle(wsHandle))
         return false;
 
     std::optional<WSvcStatus> wssopt = GetStatus();
@@ -281,6 +559,7 @@ bool WSApp::Stop(uint32_t timeoutMS)
         }
 
         if (GetTickCount() - startTime > timeoutMS) {
+            error_ = ERROR_SERVICE_REQUEST_TIMEOUT;
             SPDLOG_INFO("{} ({}) stop timeout.", wss.serviceName, wss.processId);
             ForceKillProcess(wss.processId);
             return false;
@@ -294,6 +573,7 @@ bool WSApp::Stop(uint32_t timeoutMS)
     if (!ControlService(wsHandle.Service, SERVICE_CONTROL_STOP, (LPSERVICE_STATUS) &ssp)) {
         DWORD lastError = GetLastError();
         if (ERROR_BROKEN_PIPE != lastError) {
+            error_ = lastError;
             SPDLOG_ERROR("ControlService({}) failed. WinApi@", wss.serviceName);
             return false;
         }
@@ -316,6 +596,7 @@ bool WSApp::Stop(uint32_t timeoutMS)
             break;
 
         if (GetTickCount() - startTime > timeoutMS) {
+            error_ = ERROR_SERVICE_REQUEST_TIMEOUT;
             SPDLOG_INFO("Wait {} ({}) timeout.", wss.serviceName, wss.processId);
             ForceKillProcess(wss.processId);
             return false;
@@ -420,7 +701,7 @@ dacl_cleanup:
 std::optional<WSvcStatus> WSApp::GetStatus()
 {
     WSHandle wsHandle(SC_MANAGER_ENUMERATE_SERVICE, SERVICE_QUERY_STATUS, name_);
-    if (!wsHandle.Check())
+    if (!CheckHandle(wsHandle))
         return std::nullopt;
 
     DWORD bytesNeeded;
@@ -431,6 +712,7 @@ std::optional<WSvcStatus> WSApp::GetStatus()
             (LPBYTE) &statusProcess,
             sizeof(SERVICE_STATUS_PROCESS),
             &bytesNeeded)) {
+        error_ = GetLastError();
         SPDLOG_ERROR("QueryServiceStatusEx failed! WinApi@");
         return std::nullopt;
     }
@@ -439,6 +721,12 @@ std::optional<WSvcStatus> WSApp::GetStatus()
     return std::move(result);
 }
 
+bool WSApp::CheckHandle(const WSHandle& handle)
+{
+    error_ = handle.Error;
+    return handle.Check();
+}
+
 bool WSApp::StopDependents(SC_HANDLE manager)
 {
     bool result = false;
@@ -2,6 +2,8 @@
 
 #include "util/wsutil.h"
 
+struct WSHandle;
+
 class WSApp
 {
 public:
@@ -13,18 +15,40 @@ public:
     bool Start();
     bool Stop(uint32_t timeoutMS);
     bool SetStartup(DWORD type = SERVICE_DEMAND_START);
+    virtual bool SetPath(const std::string& path);
+    bool SetAlias(const std::string& alias);
+    bool SetDependencies(const std::string& dependencies);
     std::optional<WSvcStatus> GetStatus();
     std::optional<WSvcConfig> GetConfig(bool hasDesc = false);
+    std::optional<std::string> GetDescription();
     std::vector<WSvcStatus> GetDependents();
     bool SetDescription(const std::string& desc);
     bool SetDacl(const std::string& trustee);
+    DWORD GetPreshutdownTimeout();
+    bool SetPreshutdownTimeout(DWORD timeoutMS);
+    WSvcSched GetSched();
+    bool SetSched(const WSvcSched& sched);
+    WSvcLimit GetLimit();
+    bool SetLimit(const WSvcLimit& limit);
+    WSvcActivation GetActivation();
+    bool SetActivation(const WSvcActivation& activation);
+    WSvcStandby GetStandby();
+    bool SetStandby(const WSvcStandby& standby);
 
     std::string GetName() const { return name_; }
     virtual std::string GetPath() const { return path_; }
 
+    // The Win32 error of the last failed call, captured where it failed since logging may overwrite GetLastError.
+    DWORD GetError() const { return error_; }
+    std::pair<bool, DWORD> Result(bool isOK) const { return {isOK, isOK ? NO_ERROR : error_}; }
+
 private:
+    bool CheckHandle(const WSHandle& handle);
     bool StopDependents(SC_HANDLE manager);
 
+protected:
+    DWORD error_;
+
 private:
     std::string name_;
     std::string alias_;
@@ -0,0 +1,648 @@
+#include "core/wsbroker.h"
+#include "core/wsagent.h"
+#include "core/wsgeneral.h"
+#include <sddl.h>
+
+#pragma comment(lib, "Advapi32.lib")
+
+// SYSTEM and Administrators own the pipe, other users may read and write it but not add instances.
+#define WSBROKER_PIPE_SDDL "D:P(A;;GA;;;SY)(A;;GA;;;BA)(A;;0x12008b;;;AU)"
+
+static void PutU32(std::string& out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out += (char)((value >> (i * 8)) & 0xFF);
+}
+
+static void PutU64(std::string& out, uint64_t value)
+{
+    PutU32(out, (uint32_t)value);
+    PutU32(out, (uint32_t)(value >> 32));
+}
+
+static void PutString(std::string& out, const std::string& value)
+{
+    PutU32(out, (uint32_t)value.size());
+    out += value;
+}
+
+struct WSBrokerReader
+{
+    const std::string& data;
+    size_t offset = 0;
+    bool isBad = false;
+
+    uint32_t U32() {
+        if (offset + 4 > data.size()) {
+            isBad = true;
+            return 0;
+        }
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++)
+            value |= (uint32_t)(unsigned char)data[offset + i] << (i * 8);
+        offset += 4;
+        return value;
+    }
+
+    uint64_t U64() {
+        uint64_t low = U32();
+        return low | ((uint64_t)U32() << 32);
+    }
+
+    std::string String() {
+        uint32_t size = U32();
+        if (isBad || offset + size > data.size()) {
+            isBad = true;
+            return "";
+        }
+        offset += size;
+        return data.substr(offset - size, size);
+    }
+};
+
+static void PutRecord(std::string& out, const WSBrokerRecord& record)
+{
+    out += (char)record.isRemoved;
+    PutString(out, record.serviceName);
+    if (record.isRemoved)
+        return;
+
+    PutString(out, record.displayName);
+    PutString(out, record.binaryPathName);
+    PutString(out, record.description);
+    PutString(out, record.sched);
+    PutU32(out, record.statusType);
+    PutU32(out, record.currentState);
+    PutU32(out, record.controlsAccepted);
+    PutU32(out, record.win32ExitCode);
+    PutU32(out, record.processId);
+    PutU32(out, record.configType);
+    PutU32(out, record.startType);
+    PutU32(out, record.errorControl);
+}
+
+static std::optional<std::vector<WSBrokerRecord>> GetRecords(const std::string& payload)
+{
+    WSBrokerReader reader{payload};
+    reader.U64();
+    uint32_t recordNum = reader.U32();
+    std::vector<WSBrokerRecord> records;
+    records.reserve((std::min)(recordNum, (uint32_t)(payload.size() / 8)));
+    for (uint32_t i = 0; i < recordNum && !reader.isBad; i++) {
+        WSBrokerRecord record;
+        if (reader.offset >= payload.size()) {
+            reader.isBad = true;
+            break;
+        }
+        record.isRemoved = payload[reader.offset++] != 0;
+        record.serviceName = reader.String();
+        if (!record.isRemoved) {
+            record.displayName = reader.String();
+            record.binaryPathName = reader.String();
+            record.description = reader.String();
+            record.sched = reader.String();
+            record.statusType = reader.U32();
+            record.currentState = reader.U32();
+            record.controlsAccepted = reader.U32();
+            record.win32ExitCode = reader.U32();
+            record.processId = reader.U32();
+            record.configType = reader.U32();
+            record.startType = reader.U32();
+            record.errorControl = reader.U32();
+        }
+        records.push_back(std::move(record));
+    }
+
+    if (reader.isBad) {
+        SPDLOG_ERROR("Broken broker records: {} bytes", payload.size());
+        return std::nullopt;
+    }
+    return records;
+}
+
+static bool WriteFrame(HANDLE pipe, WSBrokerMessage type, const std::string& payload)
+{
+    // Header and payload go out in one write so a frame is never interleaved.
+    std::string frame;
+    frame.reserve(payload.size() + 5);
+    PutU32(frame, (uint32_t)payload.size() + 1);
+    frame += (char)type;
+    frame += payload;
+
+    DWORD doneSize = 0;
+    return WriteFile(pipe, frame.data(), (DWORD)frame.size(), &doneSize, NULL) && doneSize == frame.size();
+}
+
+static bool ReadExact(HANDLE pipe, char* data, size_t size)
+{
+    while (size) {
+        DWORD doneSize = 0;
+        if (!ReadFile(pipe, data, (DWORD)size, &doneSize, NULL) || !doneSize)
+            return false;
+        data += doneSize;
+        size -= doneSize;
+    }
+    return true;
+}
+
+static bool ReadFrame(HANDLE pipe, WSBrokerMessage& type, std::string& payload, uint32_t maxSize)
+{
+    char header[5];
+    if (!ReadExact(pipe, header, sizeof(header)))
+        return false;
+
+    std::string sizeText(header, 4);
+    uint32_t size = WSBrokerReader{sizeText}.U32();
+    if (size == 0 || size > maxSize) {
+        SPDLOG_ERROR("Bad broker frame size: {}", size);
+        return false;
+    }
+
+    type = (WSBrokerMessage)header[4];
+    payload.resize(size - 1);
+    return ReadExact(pipe, payload.data(), payload.size());
+}
+
+bool WSBrokerRecord::operator==(const WSBrokerRecord& other) const
+{
+    return serviceName == other.serviceName && displayName == other.displayName
+        && binaryPathName == other.binaryPathName && description == other.description
+        && sched == other.sched && statusType == other.statusType
+        && currentState == other.currentState && controlsAccepted == other.controlsAccepted
+        && win32ExitCode == other.win32ExitCode && processId == other.processId
+        && configType == other.configType && startType == other.startType
+        && errorControl == other.errorControl && isRemoved == other.isRemoved;
+}
+
+WSBrokerRecord WSBrokerRecord::FromService(const WSvcStatus& status, const WSvcConfig& config, const std::string& sched)
+{
+    WSBrokerRecord record;
+    record.serviceName = status.serviceName;
+    record.displayName = status.displayName;
+    record.binaryPathName = config.binaryPathName;
+    record.description = config.description;
+    record.sched = sched;
+    record.statusType = status.serviceType;
+    record.currentState = status.currentState;
+    record.controlsAccepted = status.controlsAccepted;
+    record.win32ExitCode = status.win32ExitCode;
+    record.processId = status.processId;
+    record.configType = config.serviceType;
+    record.startType = config.startType;
+    record.errorControl = config.errorControl;
+    return record;
+}
+
+WSvcStatus WSBrokerRecord::ToStatus() const
+{
+    SERVICE_STATUS_PROCESS ssp;
+    ZeroMemory(&ssp, sizeof(ssp));
+    ssp.dwServiceType = statusType;
+    ssp.dwCurrentState = currentState;
+    ssp.dwControlsAccepted = controlsAccepted;
+    ssp.dwWin32ExitCode = win32ExitCode;
+    ssp.dwProcessId = processId;
+    return WSvcStatus(serviceName, displayName, ssp);
+}
+
+WSvcConfig WSBrokerRecord::ToConfig() const
+{
+    QUERY_SERVICE_CONFIG qsc;
+    ZeroMemory(&qsc, sizeof(qsc));
+    qsc.dwServiceType = configType;
+    qsc.dwStartType = startType;
+    qsc.dwErrorControl = errorControl;
+    qsc.lpBinaryPathName = const_cast<char*>(binaryPathName.c_str());
+    qsc.lpDisplayName = const_cast<char*>(displayName.c_str());
+
+    SERVICE_DESCRIPTION sd;
+    sd.lpDescription = const_cast<char*>(description.c_str());
+    return WSvcConfig(serviceName, qsc, sd);
+}
+
+WSBroker::WSBroker(uint32_t statusIntervalMS, uint32_t configIntervalMS)
+    : statusIntervalMS_(statusIntervalMS)
+    , configIntervalMS_(configIntervalMS)
+    , version_(0)
+    , lastConfigTick_(0)
+    , isCreatedOrDeleted_(false)
+{
+}
+
+WSBroker::~WSBroker()
+{
+    if (refreshThread_.joinable())
+        refreshThread_.detach();
+    for (auto& session : sessions_)
+        session.thread.join();
+}
+
+VOID CALLBACK WSBroker::NotifyProc(PVOID parameter)
+{
+    auto notify = (PSERVICE_NOTIFY)parameter;
+    auto broker = (WSBroker*)notify->pContext;
+    broker->isCreatedOrDeleted_ = true;
+    if (notify->pszServiceNames) {
+        LocalFree(notify->pszServiceNames);
+        notify->pszServiceNames = NULL;
+    }
+}
+
+static HANDLE CreateBrokerPipe(SECURITY_ATTRIBUTES& sa, bool isFirst)
+{
+    DWORD openMode = PIPE_ACCESS_DUPLEX | (isFirst ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0);
+    HANDLE pipe = CreateNamedPipe(WSBROKER_PIPE_NAME, openMode,
+        PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+        WSBROKER_SESSION_MAX + 2, 64 << 10, 64 << 10, 0, &sa);
+    if (pipe == INVALID_HANDLE_VALUE)
+        SPDLOG_ERROR("CreateNamedPipe({}) failed! WinApi@", WSBROKER_PIPE_NAME);
+    return pipe;
+}
+
+void WSBroker::Run()
+{
+    // The first instance claims the name, so no other process can serve it while the broker runs.
+    PSECURITY_DESCRIPTOR psd = NULL;
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptor(WSBROKER_PIPE_SDDL, SDDL_REVISION_1, &psd, NULL)) {
+        SPDLOG_ERROR("ConvertStringSecurityDescriptorToSecurityDescriptor failed! WinApi@");
+        return;
+    }
+    SECURITY_ATTRIBUTES sa = {sizeof(SECURITY_ATTRIBUTES), psd, FALSE};
+    HANDLE pipe = CreateBrokerPipe(sa, true);
+    if (pipe == INVALID_HANDLE_VALUE) {
+        SPDLOG_ERROR("Broker pipe {} is owned by another process.", WSBROKER_PIPE_NAME);
+        LocalFree(psd);
+        return;
+    }
+
+    Refresh();
+    SPDLOG_INFO("Broker @ {} with {} services", WSBROKER_PIPE_NAME, records_.size());
+
+    refreshThread_ = std::thread([this] {
+        // Creation and deletion are pushed by the SCM, state changes are polled.
+        WSHandle wsHandle(SC_MANAGER_ENUMERATE_SERVICE);
+        SERVICE_NOTIFY notify;
+        ZeroMemory(&notify, sizeof(notify));
+        notify.dwVersion = SERVICE_NOTIFY_STATUS_CHANGE;
+        notify.pfnNotifyCallback = (PFN_SC_NOTIFY_CALLBACK)NotifyProc;
+        notify.pContext = this;
+        bool isNotifying = false;
+        for (;;) {
+            if (!isNotifying && wsHandle.Check()) {
+                isNotifying = (NotifyServiceStatusChange(wsHandle.Manager,
+                    SERVICE_NOTIFY_CREATED | SERVICE_NOTIFY_DELETED, &notify) == ERROR_SUCCESS);
+            }
+            SleepEx(statusIntervalMS_, TRUE);
+            if (isCreatedOrDeleted_)
+                isNotifying = false;
+            Refresh();
+        }
+    });
+
+    for (;;) {
+        if (pipe == INVALID_HANDLE_VALUE) {
+            Sleep(1000);
+            pipe = CreateBrokerPipe(sa, false);
+            continue;
+        }
+
+        // The next instance exists before this one is handed over, so the name never lapses.
+        WaitSessionSlot();
+        bool isConnected = ConnectNamedPipe(pipe, NULL) || GetLastError() == ERROR_PIPE_CONNECTED;
+        HANDLE nextPipe = CreateBrokerPipe(sa, false);
+        if (isConnected) {
+            std::lock_guard<std::mutex> lock(sessionMutex_);
+            auto& session = sessions_.emplace_back();
+            session.thread = std::thread([this, pipe, &session] {
+                Serve(pipe);
+                std::lock_guard<std::mutex> lock(sessionMutex_);
+                session.isDone = true;
+                sessionCond_.notify_one();
+            });
+        } else
+            CloseHandle(pipe);
+        pipe = nextPipe;
+    }
+}
+
+void WSBroker::WaitSessionSlot()
+{
+    // Finished sessions are joined here, they set isDone under the lock as their last step.
+    std::unique_lock<std::mutex> lock(sessionMutex_);
+    for (;;) {
+        for (auto it = sessions_.begin(); it != sessions_.end();) {
+            if (!it->isDone) {
+                ++it;
+                continue;
+            }
+            it->thread.join();
+            it = sessions_.erase(it);
+        }
+        if (sessions_.size() < WSBROKER_SESSION_MAX)
+            return;
+        sessionCond_.wait(lock);
+    }
+}
+
+void WSBroker::Refresh()
+{
+    // Only this thread writes records_, so it reads them without the lock.
+    ULONGLONG tick = GetTickCount64();
+    bool isFull = isCreatedOrDeleted_.exchange(false) || tick - lastConfigTick_ >= configIntervalMS_;
+    if (isFull)
+        lastConfigTick_ = tick;
+
+    auto services = WSGeneral::Inst().GetServices();
+    std::vector<WSBrokerRecord> changes;
+    std::unordered_set<std::string> names;
+    for (auto& s : services) {
+        names.insert(s.serviceName);
+        auto it = records_.find(s.serviceName);
+        WSBrokerRecord record = (it != records_.end()) ? it->second : WSBrokerRecord();
+        record.serviceName = s.serviceName;
+        record.displayName = s.displayName;
+        record.statusType = s.serviceType;
+        record.currentState = s.currentState;
+        record.controlsAccepted = s.controlsAccepted;
+        record.win32ExitCode = s.win32ExitCode;
+        record.processId = s.processId;
+        if (isFull || it == records_.end())
+            RefreshRecord(s, record);
+        if (it == records_.end() || !(record == it->second))
+            changes.push_back(std::move(record));
+    }
+
+    for (auto& [name, record] : records_) {
+        if (names.count(name))
+            continue;
+        WSBrokerRecord removed;
+        removed.serviceName = name;
+        removed.isRemoved = true;
+        changes.push_back(std::move(removed));
+    }
+
+    if (changes.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& change : changes) {
+        if (change.isRemoved)
+            records_.erase(change.serviceName);
+        else
+            records_[change.serviceName] = change;
+    }
+    deltas_.emplace_back(++version_, std::move(changes));
+    while (deltas_.size() > 64)
+        deltas_.pop_front();
+    cond_.notify_all();
+}
+
+void WSBroker::RefreshRecord(const WSvcStatus& status, WSBrokerRecord& record)
+{
+    auto wscopt = WSApp(status.serviceName).GetConfig(true);
+    if (!wscopt)
+        return;
+
+    auto& config = wscopt.value();
+    record.binaryPathName = config.binaryPathName;
+    record.description = config.description;
+    record.configType = config.serviceType;
+    record.startType = config.startType;
+    record.errorControl = config.errorControl;
+    record.sched.clear();
+    if (config.serviceType == SERVICE_WIN32_AS_SERVICE) {
+        WSAgent agent(status.serviceName);
+        record.sched = agent.GetCurrentSched(status.currentState == SERVICE_RUNNING).ToString();
+    }
+}
+
+std::string WSBroker::EncodeSnapshot(uint64_t& version)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string payload;
+    payload.reserve(records_.size() * 256);
+    version = version_;
+    PutU64(payload, version_);
+    PutU32(payload, (uint32_t)records_.size());
+    for (auto& [name, record] : records_)
+        PutRecord(payload, record);
+    return payload;
+}
+
+void WSBroker::Serve(HANDLE pipe)
+{
+    WSBrokerMessage type;
+    std::string payload;
+    while (ReadFrame(pipe, type, payload, WSBROKER_REQUEST_MAX)) {
+        uint64_t version = 0;
+        if (type == WSBrokerMessage_List) {
+            if (!WriteFrame(pipe, WSBrokerMessage_Snapshot, EncodeSnapshot(version)))
+                break;
+        } else if (type == WSBrokerMessage_Tail) {
+            WSBrokerReader reader{payload};
+            std::string name = reader.String();
+            uint32_t lineNum = reader.U32();
+            if (reader.isBad || !WriteFrame(pipe, WSBrokerMessage_Text, Tail(name, lineNum)))
+                break;
+        } else if (type == WSBrokerMessage_Subscribe) {
+            // A subscriber gets the snapshot once, then the records changed since the version it has.
+            bool isOK = WriteFrame(pipe, WSBrokerMessage_Snapshot, EncodeSnapshot(version));
+            while (isOK) {
+                bool isStale = false;
+                std::vector<const WSBrokerRecord*> changes;
+                std::string delta;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    if (!cond_.wait_for(lock, std::chrono::seconds(30), [&] { return version_ != version; }))
+                        continue;
+
+                    isStale = deltas_.empty() || deltas_.front().first > version + 1;
+                    if (!isStale) {
+                        uint32_t changeNum = 0;
+                        for (auto& [deltaVersion, records] : deltas_) {
+                            if (deltaVersion > version)
+                                changeNum += (uint32_t)records.size();
+                        }
+                        PutU64(delta, version_);
+                        PutU32(delta, changeNum);
+                        for (auto& [deltaVersion, records] : deltas_) {
+                            if (deltaVersion <= version)
+                                continue;
+                            for (auto& record : records)
+                                PutRecord(delta, record);
+                        }
+                        version = version_;
+                    }
+                }
+
+                if (isStale)
+                    isOK = WriteFrame(pipe, WSBrokerMessage_Snapshot, EncodeSnapshot(version));
+                else
+                    isOK = WriteFrame(pipe, WSBrokerMessage_Delta, delta);
+            }
+            break;
+        } else {
+            SPDLOG_ERROR("Unknown broker message: {}", (int)type);
+            break;
+        }
+    }
+
+    DisconnectNamedPipe(pipe);
+    CloseHandle(pipe);
+}
+
+std::string WSBroker::Tail(const std::string& name, uint32_t lineNum)
+{
+    if (name.empty() || name.find_first_of("\\/:") != std::string::npos || name.find("..") != std::string::npos)
+        return "";
+
+    std::filesystem::path logPath = std::filesystem::path(GetLogDirectory()) / (name + ".log");
+    std::ifstream logFile(logPath.string(), std::ios::binary | std::ios::ate);
+    if (!logFile)
+        return "";
+
+    // Read back just far enough for the requested lines.
+    std::streamoff fileSize = logFile.tellg();
+    std::streamoff readSize = (std::min)(fileSize, (std::streamoff)(std::max)(lineNum, 1u) * 1024);
+    std::string text((size_t)readSize, '\0');
+    logFile.seekg(fileSize - readSize);
+    logFile.read(text.data(), readSize);
+
+    size_t start = text.size();
+    if (start && text[start - 1] == '\n')
+        start--;
+    for (uint32_t i = 0; i < lineNum && start > 0; i++) {
+        size_t position = text.rfind('\n', start - 1);
+        start = (position == std::string::npos) ? 0 : position;
+    }
+    if (start < text.size() && text[start] == '\n')
+        start++;
+    return text.substr(start);
+}
+
+WSBrokerClient::WSBrokerClient()
+    : pipe_(INVALID_HANDLE_VALUE)
+{
+}
+
+WSBrokerClient::~WSBrokerClient()
+{
+    if (pipe_ != INVALID_HANDLE_VALUE)
+        CloseHandle(pipe_);
+}
+
+static std::vector<BYTE> GetTokenData(HANDLE token, TOKEN_INFORMATION_CLASS infoClass)
+{
+    DWORD size = 0;
+    GetTokenInformation(token, infoClass, NULL, 0, &size);
+    std::vector<BYTE> data(size);
+    if (!size || !GetTokenInformation(token, infoClass, data.data(), size, &size))
+        data.clear();
+    return data;
+}
+
+static bool IsTrustedBroker(HANDLE pipe)
+{
+    // Only a broker running as SYSTEM or an elevated administrator may feed rows to this session.
+    ULONG processId = 0;
+    if (!GetNamedPipeServerProcessId(pipe, &processId)) {
+        SPDLOG_ERROR("GetNamedPipeServerProcessId failed! WinApi@");
+        return false;
+    }
+
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    HANDLE token = NULL;
+    if (!process || !OpenProcessToken(process, TOKEN_QUERY, &token)) {
+        SPDLOG_WARN("Query token of broker {} failed. WinApi@", processId);
+        if (process)
+            CloseHandle(process);
+        return false;
+    }
+
+    bool isTrusted = false;
+    auto user = GetTokenData(token, TokenUser);
+    if (!user.empty())
+        isTrusted = IsWellKnownSid(((TOKEN_USER*)user.data())->User.Sid, WinLocalSystemSid);
+    auto groups = GetTokenData(token, TokenGroups);
+    if (!isTrusted && !groups.empty()) {
+        auto tokenGroups = (TOKEN_GROUPS*)groups.data();
+        for (DWORD i = 0; i < tokenGroups->GroupCount && !isTrusted; i++) {
+            isTrusted = (tokenGroups->Groups[i].Attributes & SE_GROUP_ENABLED)
+                && IsWellKnownSid(tokenGroups->Groups[i].Sid, WinBuiltinAdministratorsSid);
+        }
+    }
+    CloseHandle(token);
+    CloseHandle(process);
+    return isTrusted;
+}
+
+bool WSBrokerClient::Connect()
+{
+    // Fails at once when no broker runs, so callers fall back to the SCM.
+    // The server may only identify this client, never impersonate it.
+    DWORD access = GENERIC_READ | FILE_WRITE_DATA;
+    DWORD flags = SECURITY_SQOS_PRESENT | SECURITY_IDENTIFICATION;
+    pipe_ = CreateFile(WSBROKER_PIPE_NAME, access, 0, NULL, OPEN_EXISTING, flags, NULL);
+    if (pipe_ == INVALID_HANDLE_VALUE && GetLastError() == ERROR_PIPE_BUSY && WaitNamedPipe(WSBROKER_PIPE_NAME, 1000))
+        pipe_ = CreateFile(WSBROKER_PIPE_NAME, access, 0, NULL, OPEN_EXISTING, flags, NULL);
+    if (pipe_ == INVALID_HANDLE_VALUE)
+        return false;
+
+    if (!IsTrustedBroker(pipe_)) {
+        SPDLOG_WARN("Ignore {}, it is not served by SYSTEM or Administrators.", WSBROKER_PIPE_NAME);
+        CloseHandle(pipe_);
+        pipe_ = INVALID_HANDLE_VALUE;
+        return false;
+    }
+    return true;
+}
+
+std::optional<std::vector<WSBrokerRecord>> WSBrokerClient::List()
+{
+    WSBrokerMessage type;
+    std::string payload;
+    if (!Send(WSBrokerMessage_List, "") || !Receive(type, payload) || type != WSBrokerMessage_Snapshot)
+        return std::nullopt;
+    return GetRecords(payload);
+}
+
+bool WSBrokerClient::Subscribe()
+{
+    return Send(WSBrokerMessage_Subscribe, "");
+}
+
+std::optional<std::vector<WSBrokerRecord>> WSBrokerClient::ReadDelta(bool& isSnapshot)
+{
+    WSBrokerMessage type;
+    std::string payload;
+    if (!Receive(type, payload))
+        return std::nullopt;
+
+    isSnapshot = (type == WSBrokerMessage_Snapshot);
+    if (!isSnapshot && type != WSBrokerMessage_Delta)
+        return std::nullopt;
+    return GetRecords(payload);
+}
+
+std::optional<std::string> WSBrokerClient::Tail(const std::string& name, uint32_t lineNum)
+{
+    std::string request;
+    PutString(request, name);
+    PutU32(request, lineNum);
+
+    WSBrokerMessage type;
+    std::string payload;
+    if (!Send(WSBrokerMessage_Tail, request) || !Receive(type, payload) || type != WSBrokerMessage_Text)
+        return std::nullopt;
+    return payload;
+}
+
+bool WSBrokerClient::Send(WSBrokerMessage type, const std::string& payload)
+{
+    return pipe_ != INVALID_HANDLE_VALUE && WriteFrame(pipe_, type, payload);
+}
+
+bool WSBrokerClient::Receive(WSBrokerMessage& type, std::string& payload)
+{
+    return pipe_ != INVALID_HANDLE_VALUE && ReadFrame(pipe_, type, payload, 256u << 20);
+}
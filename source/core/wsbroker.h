@@ -0,0 +1,104 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include "core/wsapp.h"
+
+#define WSBROKER_PIPE_NAME "\\\\.\\pipe\\winsvc-broker"
+// Requests are a name and a count at most, any session beyond the limit waits in the pipe queue.
+#define WSBROKER_REQUEST_MAX (4u << 10)
+#define WSBROKER_SESSION_MAX 16
+
+struct WSBrokerRecord
+{
+    std::string serviceName;
+    std::string displayName;
+    std::string binaryPathName;
+    std::string description;
+    std::string sched;
+    unsigned long statusType = 0;
+    unsigned long currentState = 0;
+    unsigned long controlsAccepted = 0;
+    unsigned long win32ExitCode = 0;
+    unsigned long processId = 0;
+    unsigned long configType = 0;
+    unsigned long startType = 0;
+    unsigned long errorControl = 0;
+    bool isRemoved = false;
+
+    static WSBrokerRecord FromService(const WSvcStatus& status, const WSvcConfig& config, const std::string& sched);
+    bool operator==(const WSBrokerRecord& other) const;
+    WSvcStatus ToStatus() const;
+    WSvcConfig ToConfig() const;
+};
+
+// Frames are a 4 byte little endian size, a 1 byte message type and the payload.
+enum WSBrokerMessage : uint8_t
+{
+    WSBrokerMessage_List = 1,
+    WSBrokerMessage_Snapshot,
+    WSBrokerMessage_Subscribe,
+    WSBrokerMessage_Delta,
+    WSBrokerMessage_Tail,
+    WSBrokerMessage_Text,
+};
+
+struct WSBrokerSession
+{
+    std::thread thread;
+    bool isDone = false;
+};
+
+class WSBroker final
+{
+public:
+    WSBroker(uint32_t statusIntervalMS, uint32_t configIntervalMS);
+    ~WSBroker();
+
+    void Run();
+
+private:
+    static VOID CALLBACK NotifyProc(PVOID parameter);
+    void Refresh();
+    void RefreshRecord(const WSvcStatus& status, WSBrokerRecord& record);
+    void Serve(HANDLE pipe);
+    void WaitSessionSlot();
+    std::string EncodeSnapshot(uint64_t& version);
+    std::string Tail(const std::string& name, uint32_t lineNum);
+
+private:
+    uint32_t statusIntervalMS_;
+    uint32_t configIntervalMS_;
+    std::thread refreshThread_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::map<std::string, WSBrokerRecord> records_;
+    std::deque<std::pair<uint64_t, std::vector<WSBrokerRecord>>> deltas_;
+    uint64_t version_;
+    ULONGLONG lastConfigTick_;
+    std::atomic<bool> isCreatedOrDeleted_;
+    std::mutex sessionMutex_;
+    std::condition_variable sessionCond_;
+    std::list<WSBrokerSession> sessions_;
+};
+
+class WSBrokerClient final
+{
+public:
+    WSBrokerClient();
+    ~WSBrokerClient();
+
+    bool Connect();
+    std::optional<std::vector<WSBrokerRecord>> List();
+    bool Subscribe();
+    std::optional<std::vector<WSBrokerRecord>> ReadDelta(bool& isSnapshot);
+    std::optional<std::string> Tail(const std::string& name, uint32_t lineNum);
+
+private:
+    bool Send(WSBrokerMessage type, const std::string& payload);
+    bool Receive(WSBrokerMessage& type, std::string& payload);
+
+private:
+    HANDLE pipe_;
+};
@@ -0,0 +1,221 @@
+#include "core/wscache.h"
+
+struct WSSnapshotCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t recordNum;
+    uint32_t stringSize;
+    uint64_t savedTime;
+};
+
+struct WSSnapshotCacheString
+{
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct WSSnapshotCacheRecord
+{
+    WSSnapshotCacheString serviceName;
+    WSSnapshotCacheString displayName;
+    WSSnapshotCacheString binaryPathName;
+    WSSnapshotCacheString description;
+    WSSnapshotCacheString sched;
+    uint32_t statusType;
+    uint32_t currentState;
+    uint32_t controlsAccepted;
+    uint32_t win32ExitCode;
+    uint32_t processId;
+    uint32_t configType;
+    uint32_t startType;
+    uint32_t errorControl;
+};
+
+static const char SnapshotCacheMagic[4] = {'W', 'S', 'S', 'N'};
+static const uint32_t SnapshotCacheVersion = 1;
+
+static uint64_t GetFileTimeNow()
+{
+    FILETIME ft;
+    ::GetSystemTimeAsFileTime(&ft);
+    return ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+}
+
+std::string WSSnapshotCache::GetDefaultPath()
+{
+    return GetCacheDirectory() + "\\services.bin";
+}
+
+// Layout: header, recordNum records, string table; string offsets are relative to the table.
+bool WSSnapshotCache::Open()
+{
+    Close();
+    file_ = ::CreateFile(path_.data(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        if (GetLastError() != ERROR_FILE_NOT_FOUND)
+            SPDLOG_ERROR("CreateFile({}) failed. WinApi@", path_);
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!::GetFileSizeEx(file_, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(WSSnapshotCacheHeader)) {
+        Close();
+        return false;
+    }
+
+    mapping_ = ::CreateFileMapping(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping_) {
+        SPDLOG_ERROR("CreateFileMapping({}) failed. WinApi@", path_);
+        Close();
+        return false;
+    }
+
+    view_ = (const uint8_t*)::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    if (!view_) {
+        SPDLOG_ERROR("MapViewOfFile({}) failed. WinApi@", path_);
+        Close();
+        return false;
+    }
+    size_ = (size_t)fileSize.QuadPart;
+
+    auto header = (const WSSnapshotCacheHeader*)view_;
+    uint64_t expectSize = sizeof(WSSnapshotCacheHeader) + (uint64_t)header->recordNum * sizeof(WSSnapshotCacheRecord)
+        + header->stringSize;
+    if (memcmp(header->magic, SnapshotCacheMagic, sizeof(SnapshotCacheMagic))
+        || header->version != SnapshotCacheVersion || expectSize != size_) {
+        SPDLOG_INFO("Snapshot cache {} is outdated.", path_);
+        Close();
+        return false;
+    }
+    return true;
+}
+
+size_t WSSnapshotCache::GetRecordNum() const
+{
+    return view_ ? ((const WSSnapshotCacheHeader*)view_)->recordNum : 0;
+}
+
+uint64_t WSSnapshotCache::GetAgeMS() const
+{
+    if (!view_)
+        return 0;
+    uint64_t savedTime = ((const WSSnapshotCacheHeader*)view_)->savedTime;
+    uint64_t now = GetFileTimeNow();
+    return (now > savedTime) ? (now - savedTime) / 10000 : 0;
+}
+
+bool WSSnapshotCache::Read(size_t index, WSBrokerRecord& record) const
+{
+    if (index >= GetRecordNum())
+        return false;
+
+    auto header = (const WSSnapshotCacheHeader*)view_;
+    auto records = (const WSSnapshotCacheRecord*)(view_ + sizeof(WSSnapshotCacheHeader));
+    auto strings = (const char*)(records + header->recordNum);
+    auto getString = [&](const WSSnapshotCacheString& s, std::string& value) {
+        if ((uint64_t)s.offset + s.size > header->stringSize)
+            return false;
+        value.assign(strings + s.offset, s.size);
+        return true;
+    };
+
+    auto& r = records[index];
+    if (!getString(r.serviceName, record.serviceName) || !getString(r.displayName, record.displayName)
+        || !getString(r.binaryPathName, record.binaryPathName) || !getString(r.description, record.description)
+        || !getString(r.sched, record.sched))
+        return false;
+    record.statusType = r.statusType;
+    record.currentState = r.currentState;
+    record.controlsAccepted = r.controlsAccepted;
+    record.win32ExitCode = r.win32ExitCode;
+    record.processId = r.processId;
+    record.configType = r.configType;
+    record.startType = r.startType;
+    record.errorControl = r.errorControl;
+    record.isRemoved = false;
+    return true;
+}
+
+std::optional<std::vector<WSBrokerRecord>> WSSnapshotCache::ReadAll() const
+{
+    std::vector<WSBrokerRecord> records(GetRecordNum());
+    for (size_t i = 0; i < records.size(); i++) {
+        if (!Read(i, records[i])) {
+            SPDLOG_ERROR("Snapshot cache {} has a broken record: {}", path_, i);
+            return std::nullopt;
+        }
+    }
+    return records;
+}
+
+bool WSSnapshotCache::Save(const std::vector<WSBrokerRecord>& records)
+{
+    // A mapped file can not be replaced, readers only keep the view while copying rows out.
+    Close();
+
+    std::string strings;
+    auto putString = [&strings](const std::string& value) {
+        WSSnapshotCacheString s = {(uint32_t)strings.size(), (uint32_t)value.size()};
+        strings += value;
+        return s;
+    };
+
+    std::vector<WSSnapshotCacheRecord> cacheRecords;
+    cacheRecords.reserve(records.size());
+    for (auto& record : records) {
+        WSSnapshotCacheRecord r = {};
+        r.serviceName = putString(record.serviceName);
+        r.displayName = putString(record.displayName);
+        r.binaryPathName = putString(record.binaryPathName);
+        r.description = putString(record.description);
+        r.sched = putString(record.sched);
+        r.statusType = record.statusType;
+        r.currentState = record.currentState;
+        r.controlsAccepted = record.controlsAccepted;
+        r.win32ExitCode = record.win32ExitCode;
+        r.processId = record.processId;
+        r.configType = record.configType;
+        r.startType = record.startType;
+        r.errorControl = record.errorControl;
+        cacheRecords.push_back(r);
+    }
+
+    WSSnapshotCacheHeader header = {};
+    memcpy(header.magic, SnapshotCacheMagic, sizeof(SnapshotCacheMagic));
+    header.version = SnapshotCacheVersion;
+    header.recordNum = (uint32_t)cacheRecords.size();
+    header.stringSize = (uint32_t)strings.size();
+    header.savedTime = GetFileTimeNow();
+
+    // GUI and list may refresh at once, each writes its own temp file and the last move wins.
+    std::string tempPath = path_ + "." + std::to_string(::GetCurrentProcessId()) + ".tmp";
+    std::ofstream cacheFile(tempPath, std::ios::binary | std::ios::trunc);
+    cacheFile.write((const char*)&header, sizeof(header));
+    cacheFile.write((const char*)cacheRecords.data(), cacheRecords.size() * sizeof(WSSnapshotCacheRecord));
+    cacheFile.write(strings.data(), strings.size());
+    cacheFile.close();
+    if (!cacheFile) {
+        SPDLOG_ERROR("Write snapshot cache {} failed.", tempPath);
+        return false;
+    }
+    if (!::MoveFileEx(tempPath.data(), path_.data(), MOVEFILE_REPLACE_EXISTING)) {
+        SPDLOG_ERROR("MoveFileEx({}) failed. WinApi@", path_);
+        return false;
+    }
+    return true;
+}
+
+void WSSnapshotCache::Close()
+{
+    if (view_)
+        ::UnmapViewOfFile(view_);
+    if (mapping_)
+        ::CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE)
+        ::CloseHandle(file_);
+    view_ = nullptr;
+    mapping_ = NULL;
+    file_ = INVALID_HANDLE_VALUE;
+    size_ = 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "core/wsbroker.h"
+
+// Last known services as fixed width records and a string table, mapped to show rows before the SCM answers.
+class WSSnapshotCache final
+{
+public:
+    static std::string GetDefaultPath();
+
+    WSSnapshotCache(const std::string& path = GetDefaultPath())
+        : path_(path), file_(INVALID_HANDLE_VALUE), mapping_(NULL), view_(nullptr), size_(0) {}
+    ~WSSnapshotCache() { Close(); }
+
+    bool Open();
+    size_t GetRecordNum() const;
+    uint64_t GetAgeMS() const;
+    bool Read(size_t index, WSBrokerRecord& record) const;
+    std::optional<std::vector<WSBrokerRecord>> ReadAll() const;
+    bool Save(const std::vector<WSBrokerRecord>& records);
+    void Close();
+
+private:
+    std::string path_;
+    HANDLE file_;
+    HANDLE mapping_;
+    const uint8_t* view_;
+    size_t size_;
+};
@@ -6,10 +6,11 @@ WSHandle::WSHandle(
     DWORD mngDesiredAccess,
     DWORD svcDesiredAccess,
     const std::string& svcName)
-    : Manager(NULL), Service(NULL)
+    : Manager(NULL), Service(NULL), Error(NO_ERROR)
 {
-    Manager = OpenSCManager(NULL, NULL, mngDesiredAccess);
+    Manager = SharedManager ? SharedManager : OpenSCManager(NULL, NULL, mngDesiredAccess);
     if (!Manager) {
+        Error = GetLastError();
         SPDLOG_ERROR("OpenSCManager failed! WinApi@");
         return;
     }
@@ -17,6 +18,7 @@ WSHandle::WSHandle(
     if (!svcName.empty()) {
         Service = OpenService(Manager, svcName.data(), svcDesiredAccess);
         if (!Service) {
+            Error = GetLastError();
             SPDLOG_ERROR("OpenService({}, 0X{:X}) failed! WinApi@", svcName, svcDesiredAccess);
             return;
         }
@@ -29,10 +31,35 @@ WSHandle::~WSHandle()
 {
     if (Service)
         CloseServiceHandle(Service);
-    if (Manager)
+    if (Manager && Manager != SharedManager)
         CloseServiceHandle(Manager);
 }
 
+SC_HANDLE WSHandle::SharedManager = NULL;
+
+bool WSHandle::OpenShared()
+{
+    // Handles opened afterwards reuse this one connection instead of opening their own.
+    if (SharedManager)
+        return true;
+
+    SharedManager = OpenSCManager(NULL, NULL, SC_MANAGER_ALL_ACCESS);
+    if (!SharedManager) {
+        SPDLOG_ERROR("OpenSCManager failed! WinApi@");
+        return false;
+    }
+    return true;
+}
+
+void WSHandle::CloseShared()
+{
+    if (!SharedManager)
+        return;
+
+    CloseServiceHandle(SharedManager);
+    SharedManager = NULL;
+}
+
 bool WSHandle::Check() const
 {
     if (!Manager)
@@ -45,6 +72,132 @@ bool WSHandle::Check() const
     return true;
 }
 
+WSRegKey::WSRegKey(
+    const std::string& svcName,
+    REGSAM desiredAccess)
+    : Name(svcName), Key(NULL)
+{
+    std::string subKey = "SYSTEM\\CurrentControlSet\\Services\\" + svcName + "\\Parameters";
+    LSTATUS status;
+    if (desiredAccess & KEY_SET_VALUE) {
+        status = RegCreateKeyEx(HKEY_LOCAL_MACHINE, subKey.data(), 0, NULL,
+            REG_OPTION_NON_VOLATILE, desiredAccess, NULL, &Key, NULL);
+    } else {
+        status = RegOpenKeyEx(HKEY_LOCAL_MACHINE, subKey.data(), 0, desiredAccess, &Key);
+    }
+
+    if (status != ERROR_SUCCESS) {
+        Key = NULL;
+        if (status != ERROR_FILE_NOT_FOUND)
+            SPDLOG_ERROR("RegOpenKey({}, 0X{:X}) failed({})", subKey, desiredAccess, status);
+    }
+}
+
+WSRegKey::~WSRegKey()
+{
+    if (Key)
+        RegCloseKey(Key);
+}
+
+bool WSRegKey::Check() const
+{
+    return Key != NULL;
+}
+
+std::optional<DWORD> WSRegKey::GetDWord(const std::string& valueName) const
+{
+    if (!Key)
+        return std::nullopt;
+
+    DWORD type = 0;
+    DWORD value = 0;
+    DWORD size = sizeof(value);
+    if (RegQueryValueEx(Key, valueName.data(), NULL, &type, (LPBYTE)&value, &size) != ERROR_SUCCESS
+        || type != REG_DWORD)
+        return std::nullopt;
+    return value;
+}
+
+std::optional<ULONGLONG> WSRegKey::GetQWord(const std::string& valueName) const
+{
+    if (!Key)
+        return std::nullopt;
+
+    DWORD type = 0;
+    ULONGLONG value = 0;
+    DWORD size = sizeof(value);
+    if (RegQueryValueEx(Key, valueName.data(), NULL, &type, (LPBYTE)&value, &size) != ERROR_SUCCESS
+        || type != REG_QWORD)
+        return std::nullopt;
+    return value;
+}
+
+std::optional<std::string> WSRegKey::GetString(const std::string& valueName) const
+{
+    if (!Key)
+        return std::nullopt;
+
+    DWORD type = 0;
+    DWORD size = 0;
+    if (RegQueryValueEx(Key, valueName.data(), NULL, &type, NULL, &size) != ERROR_SUCCESS
+        || type != REG_SZ)
+        return std::nullopt;
+
+    std::string value(size, '\0');
+    if (RegQueryValueEx(Key, valueName.data(), NULL, &type, (LPBYTE)value.data(), &size) != ERROR_SUCCESS)
+        return std::nullopt;
+    value.resize(strnlen(value.data(), size));
+    return value;
+}
+
+bool WSRegKey::SetDWord(const std::string& valueName, DWORD value)
+{
+    if (!Key)
+        return false;
+
+    LSTATUS status = RegSetValueEx(Key, valueName.data(), 0, REG_DWORD, (const BYTE*)&value, sizeof(value));
+    if (status != ERROR_SUCCESS) {
+        SPDLOG_ERROR("RegSetValueEx({}\\{}) failed({})", Name, valueName, status);
+        return false;
+    }
+    return true;
+}
+
+bool WSRegKey::SetQWord(const std::string& valueName, ULONGLONG value)
+{
+    if (!Key)
+        return false;
+
+    LSTATUS status = RegSetValueEx(Key, valueName.data(), 0, REG_QWORD, (const BYTE*)&value, sizeof(value));
+    if (status != ERROR_SUCCESS) {
+        SPDLOG_ERROR("RegSetValueEx({}\\{}) failed({})", Name, valueName, status);
+        return false;
+    }
+    return true;
+}
+
+bool WSRegKey::SetString(const std::string& valueName, const std::string& value)
+{
+    if (!Key)
+        return false;
+
+    LSTATUS status = RegSetValueEx(Key, valueName.data(), 0, REG_SZ, (const BYTE*)value.c_str(), (DWORD)value.size() + 1);
+    if (status != ERROR_SUCCESS) {
+        SPDLOG_ERROR("RegSetValueEx({}\\{}) failed({})", Name, valueName, status);
+        return false;
+    }
+    return true;
+}
+
+bool WSRegKey::DeleteValue(const std::string& valueName)
+{
+    if (!Key)
+        return false;
+
+    LSTATUS status = RegDeleteValue(Key, valueName.data());
+    return status == ERROR_SUCCESS || status == ERROR_FILE_NOT_FOUND;
+}
+
 std::string stringToHex(const std::string& input)
 {
     std::ostringstream oss;
@@ -11,11 +11,39 @@ struct WSHandle final
     );
     ~WSHandle();
 
+    static bool OpenShared();
+    static void CloseShared();
+
     bool Check() const;
 
     std::string Name;
     SC_HANDLE Manager;
     SC_HANDLE Service;
+    DWORD Error;
+
+private:
+    static SC_HANDLE SharedManager;
+};
+
+struct WSRegKey final
+{
+    WSRegKey(
+        const std::string& svcName,
+        REGSAM desiredAccess = KEY_READ
+    );
+    ~WSRegKey();
+
+    bool Check() const;
+    std::optional<DWORD> GetDWord(const std::string& valueName) const;
+    std::optional<ULONGLONG> GetQWord(const std::string& valueName) const;
+    std::optional<std::string> GetString(const std::string& valueName) const;
+    bool SetDWord(const std::string& valueName, DWORD value);
+    bool SetQWord(const std::string& valueName, ULONGLONG value);
+    bool SetString(const std::string& valueName, const std::string& value);
+    bool DeleteValue(const std::string& valueName);
+
+    std::string Name;
+    HKEY Key;
 };
 
 class WSGeneral final
@@ -0,0 +1,90 @@
+// Checks the ImGuiFrameScheduler policy: when the loop renders, how long it waits and what it counts.
+//
+// Off Windows, from source/:
+//   g++ -std=c++17 -g -fsanitize=address,undefined -I. gui/test/wsframe_test.cpp gui/wsframe.cpp -o wsframe_test
+//   ./wsframe_test
+// On Windows: nmake test
+#include "gui/wsframe.h"
+#include <cmath>
+#include <cstdio>
+#include <initializer_list>
+
+static bool Expect(bool isOK, const char* what, uint64_t tick)
+{
+    if (!isOK)
+        printf("FAIL %s at %llu\n", what, (unsigned long long)tick);
+    return isOK;
+}
+
+static bool CheckIdle()
+{
+    ImGuiFrameScheduler scheduler;
+    bool isOK = Expect(scheduler.GetWaitTimeout(1000) == ImGuiFrameScheduler::Infinite, "idle waits", 1000);
+    return Expect(!scheduler.ShouldRender(1000), "idle renders", 1000) && isOK;
+}
+
+static bool CheckLinger()
+{
+    // Input keeps frames coming for the linger time, then the loop sleeps until the next message.
+    ImGuiFrameScheduler scheduler(500);
+    scheduler.MarkActive(1000);
+    bool isOK = true;
+    for (uint64_t tick : {1000, 1250, 1499})
+        isOK = Expect(scheduler.GetWaitTimeout(tick) == 0, "active renders", tick) && isOK;
+    for (uint64_t tick : {1500, 1501, 90000})
+        isOK = Expect(scheduler.GetWaitTimeout(tick) == ImGuiFrameScheduler::Infinite, "linger ends", tick) && isOK;
+
+    scheduler.MarkActive(1400);
+    isOK = Expect(scheduler.ShouldRender(1899), "input extends linger", 1899) && isOK;
+    return Expect(!scheduler.ShouldRender(1900), "extended linger ends", 1900) && isOK;
+}
+
+static bool CheckAnimating()
+{
+    // An animation asks for the next frame only, BeginFrame clears it unless the frame asks again.
+    ImGuiFrameScheduler scheduler(0);
+    scheduler.MarkAnimating();
+    bool isOK = Expect(scheduler.GetWaitTimeout(5000) == 0, "animating renders", 5000);
+    scheduler.BeginFrame();
+    isOK = Expect(scheduler.GetWaitTimeout(5016) == ImGuiFrameScheduler::Infinite, "animation ends", 5016) && isOK;
+    scheduler.MarkAnimating();
+    scheduler.EndFrame(5016);
+    return Expect(scheduler.ShouldRender(5032), "animation spans frames", 5032) && isOK;
+}
+
+static bool CheckMinimized()
+{
+    ImGuiFrameScheduler scheduler(500);
+    scheduler.MarkActive(1000);
+    scheduler.MarkAnimating();
+    scheduler.SetMinimized(true);
+    bool isOK = Expect(scheduler.GetWaitTimeout(1000) == ImGuiFrameScheduler::Infinite, "minimized waits", 1000);
+    scheduler.SetMinimized(false);
+    return Expect(scheduler.GetWaitTimeout(1000) == 0, "restored renders", 1000) && isOK;
+}
+
+static bool CheckFrameRate()
+{
+    // The rate covers the frames of the last full second, it stays 0 before one has passed.
+    ImGuiFrameScheduler scheduler;
+    bool isOK = true;
+    uint64_t tick = 1000;
+    for (int i = 0; i < 60; i++, tick += 10)
+        scheduler.EndFrame(tick);
+    isOK = Expect(scheduler.GetFrameNum() == 60, "frame count", tick) && isOK;
+    isOK = Expect(scheduler.GetFPS() == 0.0f, "fps before a second", tick) && isOK;
+    for (int i = 0; i < 60; i++, tick += 10)
+        scheduler.EndFrame(tick);
+    return Expect(std::fabs(scheduler.GetFPS() - 100.0f) < 0.5f, "fps after a second", tick) && isOK;
+}
+
+int main()
+{
+    bool isOK = CheckIdle();
+    isOK = CheckLinger() && isOK;
+    isOK = CheckAnimating() && isOK;
+    isOK = CheckMinimized() && isOK;
+    isOK = CheckFrameRate() && isOK;
+    puts(isOK ? "ok" : "FAIL");
+    return isOK ? 0 : 1;
+}
@@ -0,0 +1,29 @@
+#include "gui/wsframe.h"
+
+void ImGuiFrameScheduler::MarkActive(uint64_t tick)
+{
+    // Keep drawing a little after input, so hover delays and nav highlights settle.
+    activeUntil_ = tick + lingerMS_;
+}
+
+uint32_t ImGuiFrameScheduler::GetWaitTimeout(uint64_t tick) const
+{
+    if (isMinimized_)
+        return Infinite;
+    if (isAnimating_ || tick < activeUntil_)
+        return 0;
+    return Infinite;
+}
+
+void ImGuiFrameScheduler::EndFrame(uint64_t tick)
+{
+    frameNum_++;
+    if (!statTick_) {
+        statTick_ = tick;
+        statFrameNum_ = frameNum_;
+    } else if (tick - statTick_ >= 1000) {
+        fps_ = (frameNum_ - statFrameNum_) * 1000.0f / (tick - statTick_);
+        statTick_ = tick;
+        statFrameNum_ = frameNum_;
+    }
+}
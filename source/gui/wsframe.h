@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+class ImGuiFrameScheduler
+{
+public:
+    static constexpr uint32_t Infinite = 0xFFFFFFFF;
+
+    ImGuiFrameScheduler(uint32_t lingerMS = 500)
+        : lingerMS_(lingerMS), activeUntil_(0), isAnimating_(false), isMinimized_(false)
+        , frameNum_(0), statTick_(0), statFrameNum_(0), fps_(0.0f), cpuUsage_(0.0f) {}
+
+    float GetFPS() const { return fps_; }
+    float GetCpuUsage() const { return cpuUsage_; }
+    uint64_t GetFrameNum() const { return frameNum_; }
+    void SetCpuUsage(float cpuUsage) { cpuUsage_ = cpuUsage; }
+    void SetMinimized(bool isMinimized) { isMinimized_ = isMinimized; }
+    void MarkActive(uint64_t tick);
+    void MarkAnimating() { isAnimating_ = true; }
+    uint32_t GetWaitTimeout(uint64_t tick) const;
+    bool ShouldRender(uint64_t tick) const { return GetWaitTimeout(tick) == 0; }
+    void BeginFrame() { isAnimating_ = false; }
+    void EndFrame(uint64_t tick);
+
+private:
+    // Pure policy over caller supplied ticks, so it carries no window or device state.
+    uint32_t lingerMS_;
+    uint64_t activeUntil_;
+    bool isAnimating_;
+    bool isMinimized_;
+    uint64_t frameNum_;
+    uint64_t statTick_;
+    uint64_t statFrameNum_;
+    float fps_;
+    float cpuUsage_;
+};
@@ -2,8 +2,11 @@
 #include "gui/wsgui.h"
 #include "core/wsgeneral.h"
 #include "core/wsagent.h"
+#include "core/wsbroker.h"
+#include "core/wscache.h"
 #include "cmd/wscmd.h"
 #include "imgui/imgui.h"
+#include "imgui/imgui_internal.h"
 #include "imgui/backends/imgui_impl_win32.h"
 #include "imgui/backends/imgui_impl_dx11.h"
 
@@ -98,44 +101,492 @@ void D3D11Device::SwapBuffer(bool hasVsync)
         swapChain->Present(0, 0);
 }
 
-const ImGuiTableSortSpecs* ImGuiServiceItem::sortSpecs_ = nullptr;
+ImGuiServiceItem::ImGuiServiceItem(int id, WSvcStatus status, WSvcConfig config, std::optional<ImGuiServiceDetail> detail)
+    : ImGuiServiceKeys(id), status_(std::move(status)), config_(std::move(config)), hasDetail_(detail.has_value())
+{
+    if (detail) {
+        config_.description = detail->desc;
+        sched_ = detail->sched;
+    }
+    alias_ = AnsiToUtf8(status_.displayName);
+    desc_ = AnsiToUtf8(config_.description);
+    type_ = config_.GetType();
+    startup_ = config_.GetStartType();
+    state_ = status_.GetCurrentState();
+
+    auto& startupIDs = ImGuiBaseWnd::StartupIDs;
+    auto itStartup = std::find(startupIDs.begin(), startupIDs.end(), startup_);
+    startupIndex_ = (itStartup != startupIDs.end()) ? (int)std::distance(startupIDs.begin(), itStartup) : -1;
+    auto& stateIDs = ImGuiBaseWnd::StateIDs;
+    auto itState = std::find(stateIDs.begin(), stateIDs.end(), state_);
+    stateIndex_ = (itState != stateIDs.end()) ? (int)std::distance(stateIDs.begin(), itState) : -1;
+
+    InitKeys();
+}
+
+std::optional<ImGuiServiceDetail> ImGuiServiceItem::GetDetail() const
+{
+    if (!hasDetail_)
+        return std::nullopt;
+    return ImGuiServiceDetail{config_.description, sched_};
+}
+
+void ImGuiServiceItem::SetDetail(const ImGuiServiceDetail& detail)
+{
+    config_.description = detail.desc;
+    desc_ = AnsiToUtf8(config_.description);
+    sched_ = detail.sched;
+    hasDetail_ = true;
+    textKeys_[ImGuiServiceWnd::ColumnID_Desc] = FoldCase(desc_);
+    textKeys_[ImGuiServiceWnd::ColumnID_Sched] = FoldCase(sched_);
+}
+
+void ImGuiServiceItem::InitKeys()
+{
+    // Enum columns sort by their value, so states and startups keep the SCM order.
+    numberKeys_.fill(0);
+    numberKeys_[ImGuiServiceWnd::ColumnID_ID] = id_;
+    numberKeys_[ImGuiServiceWnd::ColumnID_Type] = config_.serviceType;
+    numberKeys_[ImGuiServiceWnd::ColumnID_Startup] = config_.startType;
+    numberKeys_[ImGuiServiceWnd::ColumnID_State] = status_.currentState;
+    numberKeys_[ImGuiServiceWnd::ColumnID_PID] = status_.processId;
+
+    // Text keys hold the folded display text of every column, they serve both sort and filter.
+    textKeys_[ImGuiServiceWnd::ColumnID_ID] = std::to_string(id_);
+    textKeys_[ImGuiServiceWnd::ColumnID_Name] = FoldCase(GetName());
+    textKeys_[ImGuiServiceWnd::ColumnID_Alias] = FoldCase(GetAlias());
+    textKeys_[ImGuiServiceWnd::ColumnID_Type] = FoldCase(GetType());
+    textKeys_[ImGuiServiceWnd::ColumnID_Startup] = FoldCase(GetStartup());
+    textKeys_[ImGuiServiceWnd::ColumnID_State] = FoldCase(GetState());
+    textKeys_[ImGuiServiceWnd::ColumnID_PID] = std::to_string(GetPID());
+    textKeys_[ImGuiServiceWnd::ColumnID_Path] = FoldCase(GetPath());
+    textKeys_[ImGuiServiceWnd::ColumnID_Desc] = FoldCase(GetDesc());
+    textKeys_[ImGuiServiceWnd::ColumnID_Sched] = FoldCase(GetSched());
+}
+
+std::optional<ImGuiServiceItem> ImGuiServiceItem::Load(int id, const WSvcStatus& status)
+{
+    // Description and sched are loaded lazily for rows on screen, see ImGuiServiceDetails.
+    WSApp app(status.serviceName);
+    auto wscOpt = app.GetConfig(false);
+    if (!wscOpt) {
+        SPDLOG_WARN("{} get config failed!", status.serviceName);
+        return std::nullopt;
+    }
+    return ImGuiServiceItem(id, status, wscOpt.value());
+}
+
+static ImGuiServiceDetail LoadServiceDetail(const ImGuiDetailRequest& request)
+{
+    ImGuiServiceDetail detail;
+    WSApp app(request.name);
+    auto desc = app.GetDescription();
+    if (desc)
+        detail.desc = desc.value();
+    if (request.isAgent) {
+        WSAgent agent(request.name);
+        detail.sched = agent.GetCurrentSched(request.isRunning).ToString();
+    }
+    return detail;
+}
+
+static std::string GetErrorText(DWORD error)
+{
+    LPSTR buffer = nullptr;
+    DWORD size = FormatMessage(
+        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+        NULL, error, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), (LPSTR)&buffer, 0, NULL);
+    std::string text = fmt::format("({}) ", error);
+    if (size && buffer)
+        text += ImGuiBaseWnd::ToOneLine(AnsiToUtf8(std::string(buffer, size)));
+    if (buffer)
+        LocalFree(buffer);
+    return text;
+}
+
+ImGuiServiceTasks::ImGuiServiceTasks(size_t workerNum, std::function<void()> onChange)
+    : isStopped_(false), onChange_(std::move(onChange))
+{
+    for (size_t i = 0; i < workerNum; i++)
+        workers_.emplace_back(&ImGuiServiceTasks::Run, this);
+}
+
+ImGuiServiceTasks::~ImGuiServiceTasks()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        isStopped_ = true;
+    }
+    cond_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+void ImGuiServiceTasks::Post(const std::string& name, const std::string& action, std::function<std::pair<bool, DWORD>()> run)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back({name, action, std::move(run)});
+        events_.emplace_back(name, ImGuiTaskState{ImGuiTaskState::State_Pending, action, ""});
+    }
+    cond_.notify_one();
+}
+
+void ImGuiServiceTasks::Poll(std::map<std::string, ImGuiTaskState>& states, std::vector<ImGuiServiceDelta>& deltas)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& event : events_) {
+        if (event.second.state == ImGuiTaskState::State_Done)
+            states.erase(event.first);
+        else
+            states[event.first] = std::move(event.second);
+    }
+    events_.clear();
+    std::move(deltas_.begin(), deltas_.end(), std::back_inserter(deltas));
+    deltas_.clear();
+}
+
+void ImGuiServiceTasks::Notify(const std::string& name, ImGuiTaskState state)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.emplace_back(name, std::move(state));
+    if (onChange_)
+        onChange_();
+}
+
+void ImGuiServiceTasks::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        // Tasks of one service run in order, tasks of different services run concurrently.
+        auto it = tasks_.end();
+        cond_.wait(lock, [this, &it] {
+            it = std::find_if(tasks_.begin(), tasks_.end(), [this](const Task& task) {
+                return busyNames_.count(task.name) == 0;
+            });
+            return isStopped_ || it != tasks_.end();
+        });
+        if (isStopped_)
+            break;
+
+        Task task = std::move(*it);
+        tasks_.erase(it);
+        busyNames_.insert(task.name);
+        events_.emplace_back(task.name, ImGuiTaskState{ImGuiTaskState::State_Running, task.action, ""});
+        lock.unlock();
+        if (onChange_)
+            onChange_();
+
+        SPDLOG_INFO("Task {} @ {}", task.action, task.name);
+        // The task returns the error it captured itself, GetLastError is long overwritten by its logging.
+        ImGuiTaskState result{ImGuiTaskState::State_Done, task.action, ""};
+        auto [isOK, lastError] = task.run();
+        if (!isOK) {
+            result.state = ImGuiTaskState::State_Failed;
+            result.error = GetErrorText(lastError);
+        }
+
+        ImGuiServiceDelta delta{GetTickCount64(), task.name, std::nullopt};
+        WSApp app(task.name);
+        auto status = app.GetStatus();
+        if (status)
+            delta.item = ImGuiServiceItem::Load(0, status.value());
+
+        lock.lock();
+        busyNames_.erase(task.name);
+        events_.emplace_back(task.name, std::move(result));
+        deltas_.push_back(std::move(delta));
+        cond_.notify_all();
+        if (onChange_)
+            onChange_();
+    }
+}
+
+ImGuiServiceDetails::ImGuiServiceDetails(size_t capacity, ImGuiDetailSource source, std::function<void()> onChange)
+    : baseCapacity_(capacity), capacity_(capacity), isStopped_(false), loadNum_(0)
+    , source_(source ? std::move(source) : LoadServiceDetail), onChange_(std::move(onChange))
+{
+    thread_ = std::thread(&ImGuiServiceDetails::Run, this);
+}
+
+ImGuiServiceDetails::~ImGuiServiceDetails()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        isStopped_ = true;
+    }
+    cond_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void ImGuiServiceDetails::SetCapacity(size_t capacity)
+{
+    capacity_ = (std::max)(baseCapacity_, capacity);
+    Evict();
+}
+
+const ImGuiServiceDetail* ImGuiServiceDetails::Find(const std::string& name)
+{
+    auto it = index_.find(name);
+    if (it == index_.end())
+        return nullptr;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return &it->second->second;
+}
+
+void ImGuiServiceDetails::Request(const ImGuiServiceItem& item, bool isUrgent)
+{
+    if (index_.count(item.GetName()) || pendingNames_.count(item.GetName()))
+        return;
+
+    pendingNames_.insert(item.GetName());
+    ImGuiDetailRequest request{item.GetName(), item.GetSvcConfig().serviceType == SERVICE_WIN32_AS_SERVICE,
+        item.GetSvcStatus().currentState == SERVICE_RUNNING};
+    {
+        // The newest on-screen rows go first; once the queue is full the stalest requests are dropped.
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (isUrgent)
+            requests_.push_front(std::move(request));
+        else
+            requests_.push_back(std::move(request));
+        while (requests_.size() > capacity_) {
+            pendingNames_.erase(requests_.back().name);
+            requests_.pop_back();
+        }
+    }
+    cond_.notify_one();
+}
+
+void ImGuiServiceDetails::Invalidate(const std::string& name)
+{
+    auto it = index_.find(name);
+    if (it == index_.end())
+        return;
+    lru_.erase(it->second);
+    index_.erase(it);
+}
+
+void ImGuiServiceDetails::Poll(std::vector<std::pair<std::string, ImGuiServiceDetail>>& results)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        results.swap(results_);
+    }
+    for (auto& result : results) {
+        pendingNames_.erase(result.first);
+        Invalidate(result.first);
+        lru_.emplace_front(result.first, result.second);
+        index_[result.first] = lru_.begin();
+    }
+    Evict();
+}
+
+void ImGuiServiceDetails::Evict()
+{
+    while (lru_.size() > capacity_) {
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+void ImGuiServiceDetails::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cond_.wait(lock, [this] { return isStopped_ || !requests_.empty(); });
+        if (isStopped_)
+            break;
+
+        ImGuiDetailRequest request = std::move(requests_.front());
+        requests_.pop_front();
+        lock.unlock();
+
+        ImGuiServiceDetail detail = source_(request);
+        loadNum_++;
+
+        lock.lock();
+        results_.emplace_back(std::move(request.name), std::move(detail));
+        if (onChange_)
+            onChange_();
+    }
+}
+
+ImGuiServiceRefresher::ImGuiServiceRefresher(uint32_t intervalMS, ImGuiServiceSource source, std::function<void()> onChange)
+    : isStopped_(false), isRequested_(true), isRefreshing_(false), intervalMS_(intervalMS)
+    , source_(std::move(source)), onChange_(std::move(onChange))
+{
+    thread_ = std::thread(&ImGuiServiceRefresher::Run, this);
+}
+
+ImGuiServiceRefresher::~ImGuiServiceRefresher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        isStopped_ = true;
+    }
+    cond_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void ImGuiServiceRefresher::SetInterval(uint32_t intervalMS)
+{
+    intervalMS_ = intervalMS;
+    cond_.notify_all();
+}
+
+void ImGuiServiceRefresher::Request()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        isRequested_ = true;
+    }
+    cond_.notify_all();
+}
+
+std::shared_ptr<const ImGuiServiceSnapshot> ImGuiServiceRefresher::Acquire(uint64_t version) const
+{
+    auto snapshot = std::atomic_load(&snapshot_);
+    if (!snapshot || snapshot->version == version)
+        return nullptr;
+    return snapshot;
+}
+
+void ImGuiServiceRefresher::Run()
+{
+    uint64_t version = 0;
+    if (!source_) {
+        auto snapshot = LoadCache();
+        if (snapshot) {
+            snapshot->version = ++version;
+            std::atomic_store(&snapshot_, std::shared_ptr<const ImGuiServiceSnapshot>(std::move(snapshot)));
+            if (onChange_)
+                onChange_();
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!isStopped_) {
+        // An interval of 0 only refreshes on request.
+        auto isWakeup = [this] { return isStopped_ || isRequested_; };
+        if (intervalMS_)
+            cond_.wait_for(lock, std::chrono::milliseconds(intervalMS_.load()), isWakeup);
+        else
+            cond_.wait(lock, isWakeup);
+        if (isStopped_)
+            break;
+        isRequested_ = false;
+
+        lock.unlock();
+        isRefreshing_ = true;
+        if (onChange_)
+            onChange_();
+        auto snapshot = Build();
+        isRefreshing_ = false;
+        if (snapshot) {
+            if (!source_)
+                SaveCache(*snapshot);
+            snapshot->version = ++version;
+            std::atomic_store(&snapshot_, std::shared_ptr<const ImGuiServiceSnapshot>(std::move(snapshot)));
+        }
+        if (onChange_)
+            onChange_();
+        lock.lock();
+    }
+}
 
-void ImGuiServiceItem::Init(const ImGuiTableSortSpecs* sortSpecs)
+std::shared_ptr<ImGuiServiceSnapshot> ImGuiServiceRefresher::Build()
 {
-    sortSpecs_ = sortSpecs;
+    auto snapshot = std::make_shared<ImGuiServiceSnapshot>();
+    snapshot->startTick = GetTickCount64();
+    if (source_) {
+        snapshot->items = source_();
+        CollectGlyphs(*snapshot);
+        return snapshot;
+    }
+
+    // A running broker hands over configs and details in one message.
+    WSBrokerClient client;
+    if (client.Connect()) {
+        auto records = client.List();
+        if (records) {
+            snapshot->items.reserve(records->size());
+            for (auto& record : records.value()) {
+                snapshot->items.emplace_back((int)snapshot->items.size() + 1, record.ToStatus(), record.ToConfig(),
+                    ImGuiServiceDetail{record.description, record.sched});
+            }
+            SPDLOG_DEBUG("Refresh from broker: {}", snapshot->items.size());
+            CollectGlyphs(*snapshot);
+            return snapshot;
+        }
+    }
+
+    std::vector<WSvcStatus> svcStatuses = WSGeneral::Inst().GetServices();
+    snapshot->items.reserve(svcStatuses.size());
+    for (auto& status : svcStatuses) {
+        if (isStopped_)
+            return nullptr;
+
+        auto item = ImGuiServiceItem::Load(snapshot->items.size() + 1, status);
+        if (item)
+            snapshot->items.push_back(std::move(item.value()));
+    }
+    SPDLOG_DEBUG("Refresh: {}", snapshot->items.size());
+    CollectGlyphs(*snapshot);
+    return snapshot;
 }
 
-int ImGuiServiceItem::Compare(const void* lhs, const void* rhs)
+std::shared_ptr<ImGuiServiceSnapshot> ImGuiServiceRefresher::LoadCache()
 {
-    auto* a = (const ImGuiServiceItem*)lhs;
-    auto* b = (const ImGuiServiceItem*)rhs;
-    for (int n = 0; n < sortSpecs_->SpecsCount; n++) {
-        const ImGuiTableColumnSortSpecs* columeSpec = &sortSpecs_->Specs[n];
+    // Rows of the last run are shown at once and marked stale until the first refresh replaces them.
+    ULONGLONG startTick = GetTickCount64();
+    WSSnapshotCache cache;
+    if (!cache.Open())
+        return nullptr;
+
+    auto records = cache.ReadAll();
+    uint64_t ageMS = cache.GetAgeMS();
+    cache.Close();
+    if (!records)
+        return nullptr;
+
+    auto snapshot = std::make_shared<ImGuiServiceSnapshot>();
+    snapshot->isStale = true;
+    snapshot->items.reserve(records->size());
+    for (auto& record : records.value()) {
+        std::optional<ImGuiServiceDetail> detail;
+        if (!record.description.empty() || !record.sched.empty())
+            detail = ImGuiServiceDetail{record.description, record.sched};
+        snapshot->items.emplace_back((int)snapshot->items.size() + 1, record.ToStatus(), record.ToConfig(), detail);
+    }
+    CollectGlyphs(*snapshot);
+    SPDLOG_INFO("Load cache: {} services, {} s old, in {} ms", snapshot->items.size(), ageMS / 1000,
+        GetTickCount64() - startTick);
+    return snapshot;
+}
 
-        int delta = 0;
-        switch (columeSpec->ColumnUserID) {
-            case ImGuiServiceWnd::ColumnID_ID: delta = a->GetID() - b->GetID(); break;
-            case ImGuiServiceWnd::ColumnID_Name: delta = a->GetName().compare(b->GetName()); break;
-            case ImGuiServiceWnd::ColumnID_Alias: delta = a->GetAlias().compare(b->GetAlias()); break;
-            case ImGuiServiceWnd::ColumnID_Type: delta = a->GetType().compare(b->GetType()); break;
-            case ImGuiServiceWnd::ColumnID_Startup: delta = a->GetStartup().compare(b->GetStartup()); break;
-            case ImGuiServiceWnd::ColumnID_State: delta = a->GetState().compare(b->GetState()); break;
-            case ImGuiServiceWnd::ColumnID_PID: delta = a->GetPID() - b->GetPID(); break;
-            case ImGuiServiceWnd::ColumnID_Path: delta = a->GetPath().compare(b->GetPath()); break;
-            case ImGuiServiceWnd::ColumnID_Desc: delta = a->GetDesc().compare(b->GetDesc()); break;
-            default: IM_ASSERT(0); break;
+void ImGuiServiceRefresher::CollectGlyphs(ImGuiServiceSnapshot& snapshot)
+{
+    // Scanned here on the worker, adopting the snapshot then only merges the ranges.
+    ImFontGlyphRangesBuilder glyphs;
+    for (auto& item : snapshot.items) {
+        for (auto text : {&item.GetName(), &item.GetAlias(), &item.GetPath(), &item.GetDesc(), &item.GetSched()}) {
+            bool isAscii = std::all_of(text->begin(), text->end(), [](char ch) { return (unsigned char)ch < 0x80; });
+            if (!isAscii)
+                glyphs.AddText(text->data(), text->data() + text->size());
         }
-        if (delta > 0)
-            return (columeSpec->SortDirection == ImGuiSortDirection_Ascending) ? +1 : -1;
-        if (delta < 0)
-            return (columeSpec->SortDirection == ImGuiSortDirection_Ascending) ? -1 : +1;
     }
-    return (a->GetID() - b->GetID());
+    glyphs.BuildRanges(&snapshot.glyphRanges);
 }
 
-ImGuiServiceItem::ImGuiServiceItem(int id, WSvcStatus status, WSvcConfig config)
-    : id_(id), status_(std::move(status)), config_(std::move(config))
+void ImGuiServiceRefresher::SaveCache(const ImGuiServiceSnapshot& snapshot)
 {
+    std::vector<WSBrokerRecord> records;
+    records.reserve(snapshot.items.size());
+    for (auto& item : snapshot.items)
+        records.push_back(WSBrokerRecord::FromService(item.GetSvcStatus(), item.GetSvcConfig(), item.GetSched()));
+    WSSnapshotCache().Save(records);
 }
 
 float ImGuiBaseWnd::CharWidth = 0;
@@ -230,6 +681,7 @@ void ImGuiPropertyWnd::Reset()
     sprintf_s(svcAlias_, IM_ARRAYSIZE(svcAlias_), "");
     sprintf_s(svcStartup_, IM_ARRAYSIZE(svcStartup_), "");
     sprintf_s(svcState_, IM_ARRAYSIZE(svcState_), "");
+    sprintf_s(svcSched_, IM_ARRAYSIZE(svcSched_), "");
     sprintf_s(svcPath_, IM_ARRAYSIZE(svcPath_), "");
     sprintf_s(svcDesc_, IM_ARRAYSIZE(svcDesc_), "");
 }
@@ -255,12 +707,14 @@ void ImGuiPropertyWnd::Show(const ImGuiServiceItem* item)
                 sprintf_s(svcAlias_, IM_ARRAYSIZE(svcAlias_), "%s", item->GetAlias().data());
                 sprintf_s(svcStartup_, IM_ARRAYSIZE(svcStartup_), "%s", item->GetStartup().data());
                 sprintf_s(svcState_, IM_ARRAYSIZE(svcState_), "%s (%d)", item->GetState().data(), item->GetPID());
+                sprintf_s(svcSched_, IM_ARRAYSIZE(svcSched_), "%s", item->GetSched().data());
                 if (item->GetSvcConfig().serviceType == SERVICE_WIN32_AS_SERVICE) {
                     sprintf_s(svcPath_, IM_ARRAYSIZE(svcPath_), "%s", WSAgent::GetPath(item->GetPath()).data());
                 } else {
                     sprintf_s(svcPath_, IM_ARRAYSIZE(svcPath_), "%s", item->GetPath().data());
                 }
                 sprintf_s(svcDesc_, IM_ARRAYSIZE(svcDesc_), "%s", item->GetDesc().data());
+                GetEngine().RequireGlyphs(svcPath_);
                 SPDLOG_INFO("Item {}|{}|{}|{}|{}",
                     TypeIDs[typeID_], StartupIDs[startupID_], svcName_, svcAlias_, svcPath_);
             }
@@ -271,8 +725,11 @@ void ImGuiPropertyWnd::Show(const ImGuiServiceItem* item)
         if (item) {
             ImGui::InputTextWithHint("ID*", "service's id", svcID_, IM_ARRAYSIZE(svcID_), ImGuiInputTextFlags_ReadOnly);
         }
-        ImGui::InputTextWithHint(std::string("Name" + readFlag).data(), "service's name", svcName_, IM_ARRAYSIZE(svcName_), itemFlags);
-        ImGui::InputTextWithHint(std::string("Alias" + readFlag).data(), "service's alias", svcAlias_, IM_ARRAYSIZE(svcAlias_), itemFlags);
+        // Typed or pasted text may hold codepoints no row has shown yet.
+        if (ImGui::InputTextWithHint(std::string("Name" + readFlag).data(), "service's name", svcName_, IM_ARRAYSIZE(svcName_), itemFlags))
+            GetEngine().RequireGlyphs(svcName_);
+        if (ImGui::InputTextWithHint(std::string("Alias" + readFlag).data(), "service's alias", svcAlias_, IM_ARRAYSIZE(svcAlias_), itemFlags))
+            GetEngine().RequireGlyphs(svcAlias_);
         if (item) {
             ImGui::InputTextWithHint("Type*", "service's type", svcType_, IM_ARRAYSIZE(svcType_), itemFlags);
         } else {
@@ -298,6 +755,8 @@ void ImGuiPropertyWnd::Show(const ImGuiServiceItem* item)
         if (item) {
             ImGui::InputTextWithHint("Startup*", "service's startup", svcStartup_, IM_ARRAYSIZE(svcStartup_), itemFlags);
             ImGui::InputTextWithHint("State*", "service's state", svcState_, IM_ARRAYSIZE(svcState_), itemFlags);
+            if (item->GetSvcConfig().serviceType == SERVICE_WIN32_AS_SERVICE)
+                ImGui::InputTextWithHint("Sched*", "agent's sched", svcSched_, IM_ARRAYSIZE(svcSched_), itemFlags);
         } else {
             if (ImGui::BeginCombo("Startup", StartupIDs[startupID_].data(), ImGuiComboFlags_None)) {
                 for (int i = 0; i < StartupIDs.size(); i++) {
@@ -318,7 +777,8 @@ void ImGuiPropertyWnd::Show(const ImGuiServiceItem* item)
                 ImGui::EndCombo();
             }
         }
-        ImGui::InputTextWithHint(std::string("Execute" + readFlag).data(), "service's path", svcPath_, IM_ARRAYSIZE(svcPath_), itemFlags);
+        if (ImGui::InputTextWithHint(std::string("Execute" + readFlag).data(), "service's path", svcPath_, IM_ARRAYSIZE(svcPath_), itemFlags))
+            GetEngine().RequireGlyphs(svcPath_);
         if (ImGui::InputTextMultiline("Description", svcDesc_, IM_ARRAYSIZE(svcDesc_),
             ImVec2(0, ImGui::GetContentRegionAvail().y - ImGui::GetTextLineHeight() * 2.2),
             ImGuiInputTextFlags_None)) {
@@ -326,6 +786,7 @@ void ImGuiPropertyWnd::Show(const ImGuiServiceItem* item)
             std::string oneLine = ToOneLine(svcDesc_);
             std::string multiDesc = ToMultiLine(oneLine, charNum);
             sprintf_s(svcDesc_, IM_ARRAYSIZE(svcDesc_), "%s", multiDesc.data());
+            GetEngine().RequireGlyphs(svcDesc_);
         }
         if (ImGui::IsItemClicked()) {
             std::string freshDesc(svcDesc_);
@@ -339,23 +800,23 @@ void ImGuiPropertyWnd::Show(const ImGuiServiceItem* item)
         if (ImGui::Button("OK", ImVec2(120, 0))) {
             SPDLOG_INFO("Ok @ {}|{}|{}|{}|{}",
                 TypeIDs[typeID_], StartupIDs[startupID_], svcName_, svcAlias_, svcPath_);
-            if (TypeIDs[typeID_] == WSvcBase::GetType(SERVICE_WIN32_AS_SERVICE)) {
-                WSAgent app(svcName_, svcAlias_);
-                if (!item) {
-                    app.Install(svcPath_);
-                }
-                app.SetDescription(svcDesc_);
-            } else if (TypeIDs[typeID_] == WSvcBase::GetType(SERVICE_WIN32)) {
-                WSApp app(svcName_, svcAlias_);
-                if (!item) {
-                    app.Install(svcPath_);
-                }
-                app.SetDescription(svcDesc_);
+            bool isAgent = (TypeIDs[typeID_] == WSvcBase::GetType(SERVICE_WIN32_AS_SERVICE));
+            if (isAgent || TypeIDs[typeID_] == WSvcBase::GetType(SERVICE_WIN32)) {
+                bool isNew = (item == nullptr);
+                GetEngine().GetServiceWnd().PostTask(svcName_, isNew ? "install" : "describe",
+                    [isAgent, isNew, name = std::string(svcName_), alias = std::string(svcAlias_),
+                     path = std::string(svcPath_), desc = std::string(svcDesc_)] {
+                        std::unique_ptr<WSApp> app = isAgent
+                            ? std::make_unique<WSAgent>(name, alias)
+                            : std::make_unique<WSApp>(name, alias);
+                        if (isNew && !app->Install(path))
+                            return app->Result(false);
+                        return app->Result(desc.empty() || app->SetDescription(desc));
+                    });
             } else {
                 SPDLOG_ERROR("{} unsupport type: 0X{:X}", svcName_, typeID_);
             }
             Reset();
-            GetEngine().GetServiceWnd().SyncItems();
             ImGui::CloseCurrentPopup();
         }
         ImGui::SameLine();
@@ -369,9 +830,13 @@ void ImGuiPropertyWnd::Show(const ImGuiServiceItem* item)
     }
 }
 
-ImGuiServiceWnd::ImGuiServiceWnd(ImGuiEngine* engine)
-    : ImGuiBaseWnd(engine), startupID_(-1), stateID_(-1)
+ImGuiServiceWnd::ImGuiServiceWnd(ImGuiEngine* engine, ImGuiServiceSource source, ImGuiDetailSource detailSource)
+    : ImGuiBaseWnd(engine), startupID_(-1), stateID_(-1), mode_(ImGuiNavigationWnd::Mode_Self)
+    , isSortDirty_(false), isFilterDirty_(false), isViewDirty_(false)
     , propertyWnd_(engine_, "Edit Service Properties")
+    , refresher_(5000, std::move(source), [engine] { engine->Wake(); })
+    , tasks_(4, [engine] { engine->Wake(); })
+    , details_(1024, std::move(detailSource), [engine] { engine->Wake(); })
 {
     wndFlags_ = ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove
         | ImGuiWindowFlags_NoCollapse;
@@ -383,83 +848,344 @@ ImGuiServiceWnd::ImGuiServiceWnd(ImGuiEngine* engine)
         | ImGuiTableFlags_ScrollX | ImGuiTableFlags_ScrollY;
 
     columnIDs_.swap(std::vector<std::string>(
-        {"ID", "Name", "Alias", "Type", "Startup", "State", "PID", "Path", "Desc"}
+        {"ID", "Name", "Alias", "Type", "Startup", "State", "PID", "Path", "Desc", "Sched", "Any"}
     ));
-
-    SyncItems();
 }
 
 void ImGuiServiceWnd::SyncItems()
 {
-    items_.clear();
+    refresher_.Request();
+}
+
+void ImGuiServiceWnd::RequestSort(ColumnID columnID, bool isAscending)
+{
+    sortRequest_ = ImGuiServiceSorter::Spec{columnID, isAscending};
+}
+
+void ImGuiServiceWnd::PostTask(const std::string& name, const std::string& action, std::function<std::pair<bool, DWORD>()> run)
+{
+    taskStates_[name] = ImGuiTaskState{ImGuiTaskState::State_Pending, action, ""};
+    tasks_.Post(name, action, std::move(run));
+}
+
+void ImGuiServiceWnd::PostBulk(const std::string& action, std::function<std::pair<bool, DWORD>(const std::string&)> run)
+{
+    // The task pool bounds the concurrency, each service still runs its own tasks in order.
+    bulk_.action = action;
+    bulk_.names.assign(selections_.begin(), selections_.end());
+    std::sort(bulk_.names.begin(), bulk_.names.end());
+    SPDLOG_INFO("Bulk {} @ {} services", action, bulk_.names.size());
+    for (auto& name : bulk_.names)
+        PostTask(name, action, [name, run] { return run(name); });
+}
+
+bool ImGuiServiceWnd::GetBulkProgress(size_t& doneNum, size_t& failedNum) const
+{
+    if (bulk_.names.empty())
+        return false;
+
+    doneNum = 0;
+    failedNum = 0;
+    for (auto& name : bulk_.names) {
+        auto it = taskStates_.find(name);
+        if (it == taskStates_.end()) {
+            doneNum++;
+        } else if (it->second.state == ImGuiTaskState::State_Failed) {
+            doneNum++;
+            failedNum++;
+        }
+    }
+    return true;
+}
+
+void ImGuiServiceWnd::Select(int row)
+{
+    auto& io = ImGui::GetIO();
+    const std::string& name = rows_[order_[row]]->GetName();
+    if (io.KeyShift && !selectAnchor_.empty()) {
+        auto anchorIt = std::find_if(order_.begin(), order_.end(), [this](int index) {
+            return rows_[index]->GetName() == selectAnchor_;
+        });
+        int anchorRow = (anchorIt != order_.end()) ? (int)std::distance(order_.begin(), anchorIt) : row;
+        if (!io.KeyCtrl)
+            selections_.clear();
+        for (int i = (std::min)(row, anchorRow); i <= (std::max)(row, anchorRow); i++)
+            selections_.insert(rows_[order_[i]]->GetName());
+        return;
+    }
+
+    if (io.KeyCtrl) {
+        if (!selections_.erase(name))
+            selections_.insert(name);
+    } else {
+        selections_.clear();
+        selections_.insert(name);
+    }
+    selectAnchor_ = name;
+}
+
+// Rows changed after their snapshot bring text the snapshot glyph ranges may not cover.
+static void RequireItemGlyphs(ImGuiEngine& engine, const ImGuiServiceItem& item)
+{
+    engine.RequireGlyphs(item.GetName());
+    engine.RequireGlyphs(item.GetAlias());
+    engine.RequireGlyphs(item.GetPath());
+    engine.RequireGlyphs(item.GetDesc());
+    engine.RequireGlyphs(item.GetSched());
+}
+
+void ImGuiServiceWnd::AdoptSnapshot()
+{
+    uint64_t version = snapshot_ ? snapshot_->version : 0;
+    auto snapshot = refresher_.Acquire(version);
+    if (!snapshot)
+        return;
+
+    // Only rows a cached detail fills in are copied, the rest are read from the snapshot in place.
+    snapshot_ = std::move(snapshot);
+    overlays_.clear();
+    rows_.resize(snapshot_->items.size());
+    GetEngine().RequireGlyphs(snapshot_->glyphRanges);
+    for (size_t i = 0; i < rows_.size(); i++) {
+        rows_[i] = &snapshot_->items[i];
+        if (rows_[i]->HasDetail())
+            continue;
+        auto detail = details_.Find(rows_[i]->GetName());
+        if (!detail)
+            continue;
+        auto& item = Overlay(i);
+        item.SetDetail(*detail);
+        RequireItemGlyphs(GetEngine(), item);
+    }
+    isSortDirty_ = true;
+    isFilterDirty_ = true;
+
+    // Results of tasks finished after the snapshot started are newer than its rows.
+    deltas_.erase(std::remove_if(deltas_.begin(), deltas_.end(), [this](const ImGuiServiceDelta& delta) {
+        return delta.tick < snapshot_->startTick;
+    }), deltas_.end());
+    for (auto& delta : deltas_)
+        ApplyDelta(delta);
+    SPDLOG_INFO("AdoptSnapshot: {} (version {}{})", rows_.size(), snapshot_->version, snapshot_->isStale ? ", stale" : "");
+}
+
+ImGuiServiceItem& ImGuiServiceWnd::Overlay(size_t index)
+{
+    // The first change of a row copies it out of the snapshot, later ones edit that copy.
+    const ImGuiServiceItem* row = rows_[index];
+    auto it = overlays_.try_emplace(row->GetName(), *row).first;
+    rows_[index] = &it->second;
+    return it->second;
+}
+
+void ImGuiServiceWnd::ApplyTasks()
+{
+    size_t deltaNum = deltas_.size();
+    tasks_.Poll(taskStates_, deltas_);
+    for (size_t i = deltaNum; i < deltas_.size(); i++)
+        ApplyDelta(deltas_[i]);
+}
+
+void ImGuiServiceWnd::ApplyDelta(const ImGuiServiceDelta& delta)
+{
+    auto it = std::find_if(rows_.begin(), rows_.end(), [&delta](const ImGuiServiceItem* row) {
+        return row->GetName() == delta.name;
+    });
+
+    // Keep the sorted order and matches in step with rows_, so one changed row is not a full pass.
+    if (!delta.item) {
+        if (it == rows_.end())
+            return;
+
+        int index = (int)std::distance(rows_.begin(), it);
+        selections_.erase(delta.name);
+        rows_.erase(it);
+        overlays_.erase(delta.name);
+        if (!isFilterDirty_)
+            matches_.erase(matches_.begin() + index);
+        fullOrder_.erase(std::remove(fullOrder_.begin(), fullOrder_.end(), index), fullOrder_.end());
+        for (auto& i : fullOrder_) {
+            if (i > index)
+                i--;
+        }
+        isViewDirty_ = true;
+        return;
+    }
+
+    int index = (int)std::distance(rows_.begin(), it);
+    int id = (it != rows_.end()) ? (*it)->GetID() : 1;
+    if (it == rows_.end()) {
+        for (auto row : rows_)
+            id = (std::max)(id, row->GetID() + 1);
+    }
+
+    const auto& src = delta.item.value();
+    ImGuiServiceItem item(id, src.GetSvcStatus(), src.GetSvcConfig(), src.GetDetail());
+    details_.Invalidate(delta.name);
+    RequireItemGlyphs(GetEngine(), item);
+    bool isMatched = PassMode(item) && query_.Match(item);
+    auto& overlay = overlays_.insert_or_assign(delta.name, std::move(item)).first->second;
+    if (it != rows_.end()) {
+        *it = &overlay;
+        if (!isFilterDirty_)
+            matches_[index] = isMatched;
+        fullOrder_.erase(std::remove(fullOrder_.begin(), fullOrder_.end(), index), fullOrder_.end());
+    } else {
+        rows_.push_back(&overlay);
+        if (!isFilterDirty_)
+            matches_.push_back(isMatched);
+    }
+    if (!isSortDirty_)
+        sorter_.Insert(rows_, fullOrder_, index);
+    isViewDirty_ = true;
+}
+
+void ImGuiServiceWnd::RefreshFilter()
+{
     auto& navWnd = GetEngine().GetNavigationWnd();
-    auto& filter = navWnd.GetFilter();
-    auto mode = navWnd.GetMode();
-    auto columnID = navWnd.GetColumnID();
-    std::vector<WSvcStatus> svcStatuses = WSGeneral::Inst().GetServices();
-    for (int i = 0; i < svcStatuses.size(); i++) {
-        auto& status = svcStatuses[i];
-        WSApp app(status.serviceName);
-        auto wscOpt = app.GetConfig(true);
-        if (!wscOpt) {
-            SPDLOG_WARN("{} get config failed!", status.serviceName);
+    ImGuiServiceQuery query;
+    query.Parse(navWnd.GetFilter().InputBuf, navWnd.GetColumnID(), columnIDs_);
+
+    // A narrower query can only drop rows, so only rows matching now need a look.
+    bool isNarrower = !isFilterDirty_ && mode_ == navWnd.GetMode() && query.IsNarrowerThan(query_);
+    query_ = std::move(query);
+    mode_ = navWnd.GetMode();
+    if (!isNarrower) {
+        isFilterDirty_ = true;
+        return;
+    }
+
+    for (size_t i = 0; i < rows_.size(); i++) {
+        if (matches_[i])
+            matches_[i] = query_.Match(*rows_[i]);
+    }
+    isViewDirty_ = true;
+}
+
+void ImGuiServiceWnd::ApplyDetails()
+{
+    detailResults_.clear();
+    details_.Poll(detailResults_);
+    if (detailResults_.empty())
+        return;
+
+    bool isSortAffected = sorter_.HasColumn(ColumnID_Desc) || sorter_.HasColumn(ColumnID_Sched);
+    for (auto& result : detailResults_) {
+        auto it = std::find_if(rows_.begin(), rows_.end(), [&result](const ImGuiServiceItem* row) {
+            return row->GetName() == result.first;
+        });
+        if (it == rows_.end())
             continue;
+
+        size_t index = std::distance(rows_.begin(), it);
+        auto& item = Overlay(index);
+        item.SetDetail(result.second);
+        RequireItemGlyphs(GetEngine(), item);
+        if (!isFilterDirty_)
+            matches_[index] = PassMode(item) && query_.Match(item);
+    }
+    isSortDirty_ |= isSortAffected;
+    isViewDirty_ = true;
+}
+
+bool ImGuiServiceWnd::NeedsAllDetails() const
+{
+    return query_.HasColumn(ColumnID_Desc) || query_.HasColumn(ColumnID_Sched)
+        || sorter_.HasColumn(ColumnID_Desc) || sorter_.HasColumn(ColumnID_Sched);
+}
+
+void ImGuiServiceWnd::RequestDetails(int displayStart, int displayEnd)
+{
+    // Prefetch a page on either side; rows queued last are loaded first, so the visible ones go last.
+    int page = displayEnd - displayStart;
+    int prefetchStart = (std::max)(0, displayStart - page);
+    int prefetchEnd = (std::min)((int)order_.size(), displayEnd + page);
+    auto request = [this](int row) {
+        auto& item = *rows_[order_[row]];
+        if (!item.HasDetail())
+            details_.Request(item, true);
+    };
+    for (int row = prefetchEnd - 1; row >= displayEnd; row--)
+        request(row);
+    for (int row = displayStart - 1; row >= prefetchStart; row--)
+        request(row);
+    for (int row = displayEnd - 1; row >= displayStart; row--)
+        request(row);
+}
+
+void ImGuiServiceWnd::UpdateView()
+{
+    // Sorting or filtering by a lazy column needs it for every row, not just the visible ones.
+    if ((isSortDirty_ || isFilterDirty_) && NeedsAllDetails()) {
+        details_.SetCapacity(rows_.size());
+        for (auto row : rows_) {
+            if (!row->HasDetail())
+                details_.Request(*row, false);
         }
+    } else if (isSortDirty_ || isFilterDirty_) {
+        details_.SetCapacity(0);
+    }
 
-        auto& config = wscOpt.value();
-        ImGuiServiceItem item(items_.size() + 1, status, config);
-        if (filter.IsActive()) {
-            std::string filterText;
-            switch (columnID) {
-            case ColumnID_ID:
-                filterText = std::to_string(item.GetID());
-                break;
-            case ColumnID_Name:
-                filterText = item.GetName();
-                break;
-            case ColumnID_Alias:
-                filterText = item.GetAlias();
-                break;
-            case ColumnID_Type:
-                filterText = item.GetType();
-                break;
-            case ColumnID_Startup:
-                filterText = item.GetStartup();
-                break;
-            case ColumnID_State:
-                filterText = item.GetState();
-                break;
-            case ColumnID_PID:
-                filterText = std::to_string(item.GetPID());
-                break;
-            case ColumnID_Path:
-                filterText = item.GetPath();
-                break;
-            case ColumnID_Desc:
-                filterText = item.GetDesc();
-                break;
-            default:
-                SPDLOG_ERROR("columnID:{} is invalid!", columnID);
-                break;
-            }
+    if (isSortDirty_) {
+        sorter_.Sort(rows_, fullOrder_);
+        isSortDirty_ = false;
+        isViewDirty_ = true;
+        SPDLOG_DEBUG("Sort: {}", rows_.size());
+    }
 
-            if (!filter.PassFilter(filterText.data())) {
-                continue;
-            }
+    if (isFilterDirty_) {
+        matches_.resize(rows_.size());
+        for (size_t i = 0; i < rows_.size(); i++)
+            matches_[i] = PassMode(*rows_[i]) && query_.Match(*rows_[i]);
+        isFilterDirty_ = false;
+        isViewDirty_ = true;
+    }
+
+    if (isViewDirty_) {
+        order_.clear();
+        for (int index : fullOrder_) {
+            if (matches_[index])
+                order_.push_back(index);
         }
+        isViewDirty_ = false;
+    }
+}
 
-        if (mode == ImGuiNavigationWnd::Mode_Self) {
-            if (config.binaryPathName.find("winsvc") != std::string::npos
-                || config.binaryPathName.find("srvman") != std::string::npos) {
-                if (config.binaryPathName.find("RunAsService") != std::string::npos) {
-                    items_.push_back(std::move(item));
-                }
-            }
-        } else if (mode == ImGuiNavigationWnd::Mode_All) {
-            items_.push_back(std::move(item));
+bool ImGuiServiceWnd::PassMode(const ImGuiServiceItem& item) const
+{
+    auto& config = item.GetSvcConfig();
+    if (mode_ == ImGuiNavigationWnd::Mode_Self) {
+        return (config.binaryPathName.find("winsvc") != std::string::npos
+            || config.binaryPathName.find("srvman") != std::string::npos)
+            && config.binaryPathName.find("RunAsService") != std::string::npos;
+    }
+    return mode_ == ImGuiNavigationWnd::Mode_All;
+}
+
+void ImGuiServiceWnd::ShowTaskState(const ImGuiServiceItem& item)
+{
+    auto it = taskStates_.find(item.GetName());
+    if (it == taskStates_.end())
+        return;
+
+    auto& state = it->second;
+    ImGui::SameLine();
+    if (state.state == ImGuiTaskState::State_Failed) {
+        ImGui::TextColored(ImVec4(0.9f, 0.1f, 0.1f, 1.0f), "!");
+        if (ImGui::BeginItemTooltip()) {
+            ImGui::Text("%s failed: %s", state.action.data(), state.error.data());
+            ImGui::EndTooltip();
+        }
+    } else {
+        const char spinner[] = "|/-\\";
+        GetEngine().GetScheduler().MarkAnimating();
+        ImGui::TextDisabled("%c", spinner[(int)(ImGui::GetTime() / 0.15) & 3]);
+        if (ImGui::BeginItemTooltip()) {
+            ImGui::Text("%s %s", state.action.data(),
+                state.state == ImGuiTaskState::State_Pending ? "pending" : "running");
+            ImGui::EndTooltip();
         }
     }
-    SPDLOG_INFO("SyncItems: {}", items_.size());
 }
 
 void ImGuiServiceWnd::Show()
@@ -471,11 +1197,15 @@ void ImGuiServiceWnd::Show()
     wndSize_.x = viewport->WorkSize.x;
     wndSize_.y = viewport->WorkSize.y - wndPos_.y;
 
+    AdoptSnapshot();
+    ApplyTasks();
+    ApplyDetails();
+
     ImGui::SetNextWindowPos(wndPos_, ImGuiCond_Always);
     ImGui::SetNextWindowSize(wndSize_, ImGuiCond_Always);
     ImGui::Begin("TableWindow", nullptr, wndFlags_);
 
-    if (ImGui::BeginTable("table_services", 9, servTableFlags_)) {
+    if (ImGui::BeginTable("table_services", 10, servTableFlags_)) {
         ImGui::TableSetupColumn("ID", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_NoHide, 66.0f, ImGuiServiceWnd::ColumnID_ID);
         ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthFixed, 100.0f, ImGuiServiceWnd::ColumnID_Name);
         ImGui::TableSetupColumn("Alias", ImGuiTableColumnFlags_WidthFixed, 150.0f, ImGuiServiceWnd::ColumnID_Alias);
@@ -485,28 +1215,36 @@ void ImGuiServiceWnd::Show()
         ImGui::TableSetupColumn("PID",  ImGuiTableColumnFlags_WidthFixed, 60.0f, ImGuiServiceWnd::ColumnID_PID);
         ImGui::TableSetupColumn("Path", ImGuiTableColumnFlags_WidthFixed, 1600.0f, ImGuiServiceWnd::ColumnID_Path);
         ImGui::TableSetupColumn("Desc", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_DefaultHide, 0.0f, ImGuiServiceWnd::ColumnID_Desc);
+        ImGui::TableSetupColumn("Sched", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_DefaultHide, 0.0f, ImGuiServiceWnd::ColumnID_Sched);
         ImGui::TableSetupScrollFreeze(1, 1);
         ImGui::TableHeadersRow();
 
+        if (sortRequest_) {
+            ImGui::TableSetColumnSortDirection(sortRequest_->columnID,
+                sortRequest_->isAscending ? ImGuiSortDirection_Ascending : ImGuiSortDirection_Descending, false);
+            sortRequest_.reset();
+        }
+
         ImGuiTableSortSpecs* sortSpecs = ImGui::TableGetSortSpecs();
-        if (sortSpecs) {
-            if (sortSpecs->SpecsDirty) {
-                if (items_.size() > 1) {
-                    ImGuiServiceItem::Init(sortSpecs);
-                    qsort(&items_[0], (size_t)items_.size(), sizeof(items_[0]), ImGuiServiceItem::Compare);
-                    sortSpecs->SpecsDirty = false;
-                    SPDLOG_INFO("qsort: {}", items_.size());
-                }
-            }
+        if (sortSpecs && sortSpecs->SpecsDirty) {
+            sorter_.Init(sortSpecs);
+            sortSpecs->SpecsDirty = false;
+            isSortDirty_ = true;
         }
+        UpdateView();
 
         ImGui::PushButtonRepeat(true);
 
         ImGuiListClipper clipper;
-        clipper.Begin(items_.size());
+        clipper.Begin(order_.size());
+        int displayStart = 0, displayEnd = 0;
         while (clipper.Step()) {
+            if (clipper.DisplayEnd - clipper.DisplayStart > displayEnd - displayStart) {
+                displayStart = clipper.DisplayStart;
+                displayEnd = clipper.DisplayEnd;
+            }
             for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
-                ImGuiServiceItem& item = items_[row];
+                const ImGuiServiceItem& item = *rows_[order_[row]];
                 ImGui::TableNextRow();
                 ImGui::PushID(item.GetID());
 
@@ -517,20 +1255,10 @@ void ImGuiServiceWnd::Show()
                     propertyWnd_.Show(&item);
                     ImGui::SameLine();
 
-                    bool isSelected = selections_.contains(item.GetID());
+                    bool isSelected = selections_.count(item.GetName()) != 0;
                     ImGuiSelectableFlags selectFlags = ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap;
-                    if (ImGui::Selectable(std::to_string(item.GetID()).data(), isSelected, selectFlags)) {
-                        if (ImGui::GetIO().KeyCtrl) {
-                            if (isSelected) {
-                                selections_.find_erase_unsorted(item.GetID());
-                            } else {
-                                selections_.push_back(item.GetID());
-                            }
-                        } else {
-                            selections_.clear();
-                            selections_.push_back(item.GetID());
-                        }
-                    }
+                    if (ImGui::Selectable(item.GetIDText().data(), isSelected, selectFlags))
+                        Select(row);
                 }
 
                 if (ImGui::TableSetColumnIndex(ImGuiServiceWnd::ColumnID_Name))
@@ -544,11 +1272,14 @@ void ImGuiServiceWnd::Show()
                     ImGui::TextUnformatted(item.GetType().data());
                 }
 
+                auto taskIt = taskStates_.find(item.GetName());
+                bool isBusy = (taskIt != taskStates_.end() && taskIt->second.state != ImGuiTaskState::State_Failed);
+
                 if (ImGui::TableSetColumnIndex(ImGuiServiceWnd::ColumnID_Startup)) {
-                    auto it = std::find(StartupIDs.begin(), StartupIDs.end(), item.GetStartup());
-                    startupID_ = std::distance(StartupIDs.begin(), it);
+                    startupID_ = item.GetStartupIndex();
                     ImGui::SetNextItemWidth(CharWidth * 15);
-                    if (ImGui::BeginCombo("##Startup", StartupIDs[startupID_].data(), ImGuiComboFlags_None)) {
+                    ImGui::BeginDisabled(isBusy);
+                    if (ImGui::BeginCombo("##Startup", item.GetStartup().data(), ImGuiComboFlags_None)) {
                         for (int i = 0; i < StartupIDs.size(); i++) {
                             if (StartupIDs[i] == WSvcConfig::GetStartType(SERVICE_BOOT_START)
                                 || StartupIDs[i] == WSvcConfig::GetStartType(SERVICE_SYSTEM_START)) {
@@ -557,10 +1288,12 @@ void ImGuiServiceWnd::Show()
                             bool isSelected = (startupID_ == i);
                             if (ImGui::Selectable(StartupIDs[i].data(), isSelected)) {
                                 if (startupID_ != i) {
-                                    SPDLOG_INFO("{} startup: {} -> {}", item.GetName(), StartupIDs[startupID_], StartupIDs[i]);
-                                    WSApp app(item.GetName());
-                                    app.SetStartup(WSvcConfig::GetStartType(StartupIDs[i]));
-                                    SyncItems();
+                                    SPDLOG_INFO("{} startup: {} -> {}", item.GetName(), item.GetStartup(), StartupIDs[i]);
+                                    DWORD startType = WSvcConfig::GetStartType(StartupIDs[i]);
+                                    PostTask(item.GetName(), "startup", [name = item.GetName(), startType] {
+                                        WSApp app(name);
+                                        return app.Result(app.SetStartup(startType));
+                                    });
                                     startupID_ = i;
                                 }
                             }
@@ -569,12 +1302,13 @@ void ImGuiServiceWnd::Show()
                         }
                         ImGui::EndCombo();
                     }
+                    ImGui::EndDisabled();
                 }
                 if (ImGui::TableSetColumnIndex(ImGuiServiceWnd::ColumnID_State)) {
-                    auto it = std::find(StateIDs.begin(), StateIDs.end(), item.GetState());
-                    stateID_ = std::distance(StateIDs.begin(), it);
+                    stateID_ = item.GetStateIndex();
                     ImGui::SetNextItemWidth(CharWidth * 15);
-                    if (ImGui::BeginCombo("##State", StateIDs[stateID_].data(), ImGuiComboFlags_None)) {
+                    ImGui::BeginDisabled(isBusy);
+                    if (ImGui::BeginCombo("##State", item.GetState().data(), ImGuiComboFlags_None)) {
                         for (int i = 0; i < StateIDs.size(); i++) {
                             if (StateIDs[i] == WSvcStatus::GetState(SERVICE_CONTINUE_PENDING)
                                 || StateIDs[i] == WSvcStatus::GetState(SERVICE_PAUSE_PENDING)
@@ -586,13 +1320,18 @@ void ImGuiServiceWnd::Show()
                             bool isSelected = (stateID_ == i);
                             if (ImGui::Selectable(StateIDs[i].data(), isSelected)) {
                                 if (stateID_ != i) {
-                                    SPDLOG_INFO("{} state: {} -> {}", item.GetName(), StateIDs[stateID_], StateIDs[i]);
-                                    WSApp app(item.GetName());
-                                    if (StateIDs[i] == WSvcStatus::GetState(SERVICE_RUNNING))
-                                        app.Start();
-                                    else if (StateIDs[i] == WSvcStatus::GetState(SERVICE_STOPPED))
-                                        app.Stop(3000);
-                                    SyncItems();
+                                    SPDLOG_INFO("{} state: {} -> {}", item.GetName(), item.GetState(), StateIDs[i]);
+                                    if (StateIDs[i] == WSvcStatus::GetState(SERVICE_RUNNING)) {
+                                        PostTask(item.GetName(), "start", [name = item.GetName()] {
+                                            WSApp app(name);
+                                            return app.Result(app.Start());
+                                        });
+                                    } else if (StateIDs[i] == WSvcStatus::GetState(SERVICE_STOPPED)) {
+                                        PostTask(item.GetName(), "stop", [name = item.GetName()] {
+                                            WSApp app(name);
+                                            return app.Result(app.Stop(3000));
+                                        });
+                                    }
                                     stateID_ = i;
                                 }
                             }
@@ -601,26 +1340,39 @@ void ImGuiServiceWnd::Show()
                         }
                         ImGui::EndCombo();
                     }
+                    ImGui::EndDisabled();
+                    ShowTaskState(item);
                 }
                 if (ImGui::TableSetColumnIndex(ImGuiServiceWnd::ColumnID_PID)) {
                     ImGui::Text("%d", item.GetPID());
                 }
                 if (ImGui::TableSetColumnIndex(ImGuiServiceWnd::ColumnID_Path)) {
-                    char* inputBuf = strdup(item.GetPath().data());
-                    if (inputBuf) {
-                        ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x);
-                        ImGui::InputText("##Path", inputBuf, item.GetPath().length() + 1, ImGuiInputTextFlags_ReadOnly);
-                        ImGui::PopItemWidth();
-                        free(inputBuf);
-                    }
+                    // A read-only InputText never writes to its buffer, so the row's own string is shown in place.
+                    auto& path = item.GetPath();
+                    ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x);
+                    ImGui::InputText("##Path", const_cast<char*>(path.data()), path.length() + 1, ImGuiInputTextFlags_ReadOnly);
+                    ImGui::PopItemWidth();
                 }
                 if (ImGui::TableSetColumnIndex(ImGuiServiceWnd::ColumnID_Desc)) {
-                    ImGui::TextUnformatted(item.GetDesc().data());
+                    if (item.HasDetail())
+                        ImGui::TextUnformatted(item.GetDesc().data());
+                    else
+                        ImGui::TextDisabled("...");
+                }
+                if (ImGui::TableSetColumnIndex(ImGuiServiceWnd::ColumnID_Sched)) {
+                    if (item.HasDetail())
+                        ImGui::TextUnformatted(item.GetSched().data());
+                    else
+                        ImGui::TextDisabled("...");
                 }
 
                 ImGui::PopID();
             }
         }
+        // Hidden Desc and Sched columns (the default) cost no SCM calls at all.
+        if ((ImGui::TableGetColumnFlags(ColumnID_Desc) | ImGui::TableGetColumnFlags(ColumnID_Sched))
+            & ImGuiTableColumnFlags_IsEnabled)
+            RequestDetails(displayStart, displayEnd);
         ImGui::PopButtonRepeat();
 
         ImGui::EndTable();
@@ -643,6 +1395,19 @@ ImGuiNavigationWnd::ImGuiNavigationWnd(ImGuiEngine* engine)
     filterComboFlags_ = ImGuiComboFlags_None;
 }
 
+void ImGuiNavigationWnd::SetFilter(const std::string& text)
+{
+    ImStrncpy(filter_.InputBuf, text.data(), IM_ARRAYSIZE(filter_.InputBuf));
+    filter_.Build();
+    GetEngine().GetServiceWnd().RefreshFilter();
+}
+
+void ImGuiNavigationWnd::SetMode(Mode mode)
+{
+    mode_ = mode;
+    GetEngine().GetServiceWnd().RefreshFilter();
+}
+
 void ImGuiNavigationWnd::Show()
 {
     const ImGuiViewport* viewport = ImGui::GetMainViewport();
@@ -679,7 +1444,7 @@ void ImGuiNavigationWnd::Show()
             if (ImGui::IsItemClicked()) {
                 if (mode_ != Mode_Self) {
                     mode_ = Mode_Self;
-                    GetEngine().GetServiceWnd().SyncItems();
+                    GetEngine().GetServiceWnd().RefreshFilter();
                 }
             }
             ImGui::SameLine();
@@ -687,9 +1452,32 @@ void ImGuiNavigationWnd::Show()
             if (ImGui::IsItemClicked()) {
                 if (mode_ != Mode_All) {
                     mode_ = Mode_All;
-                    GetEngine().GetServiceWnd().SyncItems();
+                    GetEngine().GetServiceWnd().RefreshFilter();
                 }
             }
+            ImGui::SameLine();
+
+            static const uint32_t intervals[] = {0, 1000, 2000, 5000, 10000, 30000};
+            static const char* intervalNames[] = {"off", "1s", "2s", "5s", "10s", "30s"};
+            auto& refresher = GetEngine().GetServiceWnd().GetRefresher();
+            int intervalID = 0;
+            while (intervalID < IM_ARRAYSIZE(intervals) - 1 && intervals[intervalID] != refresher.GetInterval())
+                intervalID++;
+            if (ImGui::SmallButton(refresher.IsRefreshing() ? "Refresh*" : "Refresh:"))
+                GetEngine().GetServiceWnd().SyncItems();
+            if (GetEngine().GetServiceWnd().IsStale()) {
+                ImGui::SameLine();
+                ImGui::TextDisabled("(cached)");
+            }
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(CharWidth * 6);
+            if (ImGui::Combo("##Refresh", &intervalID, intervalNames, IM_ARRAYSIZE(intervalNames))) {
+                SPDLOG_INFO("Refresh interval: {}", intervalNames[intervalID]);
+                refresher.SetInterval(intervals[intervalID]);
+            }
+            ImGui::SameLine();
+            auto& scheduler = GetEngine().GetScheduler();
+            ImGui::TextDisabled("%.0f fps %.1f%% cpu", scheduler.GetFPS(), scheduler.GetCpuUsage());
         }
 
         if (ImGui::TableSetColumnIndex(ImGuiNavigationWnd::ColumnID_Control)) {
@@ -704,45 +1492,99 @@ void ImGuiNavigationWnd::Show()
 
             if (ImGui::Button("Delete", ImVec2(60, 0)))
                 ImGui::OpenPopup("Delete?");
+            ImGui::SameLine();
+
+            auto& serviceWnd = GetEngine().GetServiceWnd();
+            bool hasSelection = !serviceWnd.GetSelections().empty();
+            if (ImGui::Button("Bulk", ImVec2(60, 0)))
+                ImGui::OpenPopup("BulkMenu");
+            if (ImGui::BeginPopup("BulkMenu")) {
+                if (ImGui::MenuItem("Start", nullptr, false, hasSelection)) {
+                    serviceWnd.PostBulk("start", [](const std::string& name) {
+                        WSApp app(name);
+                        return app.Result(app.Start());
+                    });
+                }
+                if (ImGui::MenuItem("Stop", nullptr, false, hasSelection)) {
+                    serviceWnd.PostBulk("stop", [](const std::string& name) {
+                        WSApp app(name);
+                        return app.Result(app.Stop(3000));
+                    });
+                }
+                if (ImGui::MenuItem("Restart", nullptr, false, hasSelection)) {
+                    serviceWnd.PostBulk("restart", [](const std::string& name) {
+                        WSApp app(name);
+                        return app.Result(app.Stop(3000) && app.Start());
+                    });
+                }
+                if (ImGui::BeginMenu("Startup", hasSelection)) {
+                    for (int i = 0; i < StartupIDs.size(); i++) {
+                        if (StartupIDs[i] == WSvcConfig::GetStartType(SERVICE_BOOT_START)
+                            || StartupIDs[i] == WSvcConfig::GetStartType(SERVICE_SYSTEM_START)) {
+                            continue;
+                        }
+                        if (ImGui::MenuItem(StartupIDs[i].data())) {
+                            DWORD startType = WSvcConfig::GetStartType(StartupIDs[i]);
+                            serviceWnd.PostBulk("startup", [startType](const std::string& name) {
+                                WSApp app(name);
+                                return app.Result(app.SetStartup(startType));
+                            });
+                        }
+                    }
+                    ImGui::EndMenu();
+                }
+                ImGui::EndPopup();
+            }
+
+            size_t doneNum = 0, failedNum = 0;
+            if (serviceWnd.GetBulkProgress(doneNum, failedNum)) {
+                auto& bulk = serviceWnd.GetBulk();
+                ImGui::SameLine();
+                char overlay[64];
+                sprintf_s(overlay, IM_ARRAYSIZE(overlay), "%s %zu/%zu%s", bulk.action.data(), doneNum,
+                    bulk.names.size(), failedNum ? " !" : "");
+                ImGui::ProgressBar((float)doneNum / bulk.names.size(), ImVec2(CharWidth * 18, 0), overlay);
+                if (ImGui::BeginItemTooltip()) {
+                    ImGui::Text("%zu done, %zu failed, %zu pending. Click to dismiss.",
+                        doneNum - failedNum, failedNum, bulk.names.size() - doneNum);
+                    ImGui::EndTooltip();
+                }
+                if (ImGui::IsItemClicked() && doneNum == bulk.names.size())
+                    serviceWnd.ClearBulk();
+            }
 
             ImVec2 center = ImGui::GetMainViewport()->GetCenter();
             ImGui::SetNextWindowPos(center, ImGuiCond_Appearing, ImVec2(0.5f, 0.5f));
             if (ImGui::BeginPopupModal("Delete?", NULL, ImGuiWindowFlags_AlwaysAutoResize)) {
-                auto& serviceWnd = GetEngine().GetServiceWnd();
                 auto& selections = serviceWnd.GetSelections();
-                if (selections.Size != 1) {
-                    SPDLOG_WARN("Incorrect mumber of selections: {}", selections.Size);
+                if (selections.empty()) {
+                    SPDLOG_WARN("No service selected.");
                     ImGui::CloseCurrentPopup();
                 } else {
-                    auto& items = serviceWnd.GetItems();
-                    int selectID = selections[0];
-                    auto selectIt = std::find_if(items.begin(), items.end(), [&selectID](const ImGuiServiceItem& item) {
-                        return item.GetID() == selectID;
-                    });
-                    if (selectIt == items.end()) {
-                        SPDLOG_ERROR("selectID:{} not exist!", selectID);
+                    std::vector<std::string> selectNames(selections.begin(), selections.end());
+                    std::sort(selectNames.begin(), selectNames.end());
+                    ImGui::Text("%zu service(s) will be deleted.\nThis operation cannot be undone!", selectNames.size());
+                    const size_t listNum = 10;
+                    for (size_t i = 0; i < selectNames.size() && i < listNum; i++)
+                        ImGui::BulletText("%s", selectNames[i].data());
+                    if (selectNames.size() > listNum)
+                        ImGui::TextDisabled("... and %zu more", selectNames.size() - listNum);
+                    ImGui::Separator();
+
+                    if (ImGui::Button("OK", ImVec2(120, 0))) {
+                        serviceWnd.PostBulk("delete", [](const std::string& name) {
+                            WSApp app(name);
+                            return app.Result(app.Uninstall());
+                        });
                         ImGui::CloseCurrentPopup();
-                    } else {
-                        auto& selectItem = *selectIt;
-                        auto& selectName = selectItem.GetName() + ", " + selectItem.GetAlias();
-                        ImGui::Text("\"%s\" service will be deleted.\nThis operation cannot be undone!", selectName.data());
-                        ImGui::Separator();
-
-                        if (ImGui::Button("OK", ImVec2(120, 0))) {
-                            SPDLOG_INFO("Delete @ {}", selectName);
-                            WSApp app(selectItem.GetName());
-                            app.Uninstall();
-                            GetEngine().GetServiceWnd().SyncItems();
-                            ImGui::CloseCurrentPopup();
-                        }
+                    }
 
-                        ImGui::SetItemDefaultFocus();
-                        ImGui::SameLine();
+                    ImGui::SetItemDefaultFocus();
+                    ImGui::SameLine();
 
-                        if (ImGui::Button("Cancel", ImVec2(120, 0))) {
-                            SPDLOG_INFO("Cancel @ {}", selectName);
-                            ImGui::CloseCurrentPopup();
-                        }
+                    if (ImGui::Button("Cancel", ImVec2(120, 0))) {
+                        SPDLOG_INFO("Cancel delete @ {} services", selectNames.size());
+                        ImGui::CloseCurrentPopup();
                     }
                 }
 
@@ -754,10 +1596,12 @@ void ImGuiNavigationWnd::Show()
             ImGui::Text("Filter:");
             ImGui::SameLine();
 
-            filter_.Draw("##Filter:", wndSize_.x - CharWidth * 89);
-            if (ImGui::IsItemFocused() && ImGui::IsKeyPressed(ImGuiKey_Enter)) {
-                GetEngine().GetServiceWnd().SyncItems();
+            if (filter_.Draw("##Filter:", wndSize_.x - CharWidth * 120)) {
+                GetEngine().RequireGlyphs(filter_.InputBuf);
+                GetEngine().GetServiceWnd().RefreshFilter();
             }
+            HelpTip("Words must all match, -word must not match.\n"
+                "column:word matches one column, e.g. state:running -name:sql");
             ImGui::SameLine();
 
             ImGui::Text("@");
@@ -770,7 +1614,7 @@ void ImGuiNavigationWnd::Show()
                     bool isSelected = (columnID_ == i);
                     if (ImGui::Selectable(items[i].data(), isSelected)) {
                         columnID_ = i;
-                        GetEngine().GetServiceWnd().SyncItems();
+                        GetEngine().GetServiceWnd().RefreshFilter();
                     }
 
                     if (isSelected) {
@@ -787,37 +1631,422 @@ void ImGuiNavigationWnd::Show()
     ImGui::End();
 }
 
-ImGuiEngine::ImGuiEngine(HWND hwnd)
-    : servWnd_(this), navWnd_(this), dx11_(hwnd)
+std::atomic<uint64_t> ImGuiEngine::allocNum_(0);
+
+void* ImGuiEngine::AllocProc(size_t size, void* userData)
+{
+    allocNum_++;
+    return malloc(size);
+}
+
+void ImGuiEngine::FreeProc(void* ptr, void* userData)
+{
+    free(ptr);
+}
+
+void ImGuiWin32Backend::Init()
+{
+    ImGui_ImplWin32_Init(hwnd_);
+    ImGui_ImplDX11_Init(dx11_.device, dx11_.deviceContext);
+}
+
+void ImGuiWin32Backend::Shutdown()
+{
+    ImGui_ImplDX11_Shutdown();
+    ImGui_ImplWin32_Shutdown();
+}
+
+void ImGuiWin32Backend::NewFrame()
+{
+    ImGui_ImplDX11_NewFrame();
+    ImGui_ImplWin32_NewFrame();
+}
+
+void ImGuiWin32Backend::RenderFrame(bool hasVsync)
+{
+    ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+    dx11_.SwapBuffer(hasVsync);
+}
+
+void ImGuiWin32Backend::SetViewSize(int width, int height)
+{
+    dx11_.ResizeBuffer(width, height);
+}
+
+void ImGuiWin32Backend::SetViewColor(float r, float g, float b, float alpha)
+{
+    dx11_.SetViewColor(r, g, b, alpha);
+}
+
+void ImGuiWin32Backend::InvalidateFonts()
+{
+    // The next NewFrame recreates the device objects, uploading the rebuilt atlas.
+    ImGui_ImplDX11_InvalidateDeviceObjects();
+}
+
+void ImGuiNullBackend::Init()
+{
+    // Same as imgui/examples/example_null: a built atlas is all NewFrame needs.
+    unsigned char* pixels = nullptr;
+    int width, height;
+    ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+}
+
+void ImGuiNullBackend::NewFrame()
+{
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2((float)width_, (float)height_);
+    io.DeltaTime = 1.0f / 60.0f;
+}
+
+struct ImGuiFontCacheHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t key;
+    uint32_t rangeNum;
+    uint32_t fontNum;
+    uint32_t customRectNum;
+    int32_t texWidth;
+    int32_t texHeight;
+    int32_t packIdMouseCursors;
+    int32_t packIdLines;
+    ImVec2 texUvScale;
+    ImVec2 texUvWhitePixel;
+    ImVec4 texUvLines[IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1];
+};
+
+struct ImGuiFontCacheFont
+{
+    float fontSize;
+    float ascent;
+    float descent;
+    uint32_t glyphNum;
+};
+
+static const char FontCacheMagic[4] = {'W', 'S', 'F', 'A'};
+static const uint32_t FontCacheVersion = 1;
+
+// Layout: header, glyph ranges, per font a record and its glyphs, custom rects, alpha8 pixels.
+static size_t AlignFontCache(size_t offset)
+{
+    return (offset + 3) & ~(size_t)3;
+}
+
+std::optional<ImVector<ImWchar>> ImGuiFontCache::Open(uint32_t key)
+{
+    Close();
+    file_ = ::CreateFile(path_.data(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        if (GetLastError() != ERROR_FILE_NOT_FOUND)
+            SPDLOG_ERROR("CreateFile({}) failed. WinApi@", path_);
+        return std::nullopt;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!::GetFileSizeEx(file_, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(ImGuiFontCacheHeader)) {
+        Close();
+        return std::nullopt;
+    }
+
+    mapping_ = ::CreateFileMapping(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping_) {
+        SPDLOG_ERROR("CreateFileMapping({}) failed. WinApi@", path_);
+        Close();
+        return std::nullopt;
+    }
+
+    view_ = (const uint8_t*)::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    if (!view_) {
+        SPDLOG_ERROR("MapViewOfFile({}) failed. WinApi@", path_);
+        Close();
+        return std::nullopt;
+    }
+    size_ = (size_t)fileSize.QuadPart;
+
+    auto header = (const ImGuiFontCacheHeader*)view_;
+    size_t rangeSize = header->rangeNum * sizeof(ImWchar);
+    if (memcmp(header->magic, FontCacheMagic, sizeof(FontCacheMagic)) || header->version != FontCacheVersion
+        || header->key != key || sizeof(ImGuiFontCacheHeader) + rangeSize > size_) {
+        SPDLOG_INFO("Font cache {} is stale.", path_);
+        Close();
+        return std::nullopt;
+    }
+
+    ImVector<ImWchar> ranges;
+    ranges.resize(header->rangeNum);
+    memcpy(ranges.Data, view_ + sizeof(ImGuiFontCacheHeader), rangeSize);
+    return ranges;
+}
+
+bool ImGuiFontCache::Restore(ImFontAtlas& atlas) const
+{
+    if (!view_)
+        return false;
+
+    auto header = (const ImGuiFontCacheHeader*)view_;
+    if (header->fontNum != (uint32_t)atlas.Fonts.Size || atlas.ConfigData.Size != atlas.Fonts.Size)
+        return false;
+
+    size_t offset = AlignFontCache(sizeof(ImGuiFontCacheHeader) + header->rangeNum * sizeof(ImWchar));
+    auto take = [this, &offset](size_t size) -> const uint8_t* {
+        if (offset + size > size_)
+            return nullptr;
+        const uint8_t* data = view_ + offset;
+        offset = AlignFontCache(offset + size);
+        return data;
+    };
+
+    for (int i = 0; i < atlas.Fonts.Size; i++) {
+        ImFont* font = atlas.Fonts[i];
+        ImFontConfig& fontCfg = atlas.ConfigData[i];
+        auto record = (const ImGuiFontCacheFont*)take(sizeof(ImGuiFontCacheFont));
+        if (!record || fontCfg.DstFont != font || fontCfg.SizePixels != record->fontSize)
+            return false;
+        const uint8_t* glyphs = take(record->glyphNum * sizeof(ImFontGlyph));
+        if (!glyphs)
+            return false;
+
+        ImFontAtlasBuildSetupFont(&atlas, font, &fontCfg, record->ascent, record->descent);
+        font->Glyphs.resize(record->glyphNum);
+        memcpy(font->Glyphs.Data, glyphs, record->glyphNum * sizeof(ImFontGlyph));
+    }
+
+    const uint8_t* customRects = take(header->customRectNum * sizeof(ImFontAtlasCustomRect));
+    const uint8_t* pixels = take((size_t)header->texWidth * header->texHeight);
+    if (!customRects || !pixels)
+        return false;
+
+    atlas.CustomRects.resize(header->customRectNum);
+    memcpy(atlas.CustomRects.Data, customRects, header->customRectNum * sizeof(ImFontAtlasCustomRect));
+    for (auto& rect : atlas.CustomRects)
+        rect.Font = nullptr;
+    atlas.PackIdMouseCursors = header->packIdMouseCursors;
+    atlas.PackIdLines = header->packIdLines;
+    atlas.TexWidth = header->texWidth;
+    atlas.TexHeight = header->texHeight;
+    atlas.TexUvScale = header->texUvScale;
+    atlas.TexUvWhitePixel = header->texUvWhitePixel;
+    memcpy(atlas.TexUvLines, header->texUvLines, sizeof(atlas.TexUvLines));
+
+    // The atlas reads pixels straight from the view; Detach before the atlas would free them.
+    atlas.TexPixelsAlpha8 = const_cast<unsigned char*>(pixels);
+    atlas.TexPixelsUseColors = false;
+    for (ImFont* font : atlas.Fonts)
+        font->BuildLookupTable();
+    atlas.TexReady = true;
+    return true;
+}
+
+bool ImGuiFontCache::Save(const ImFontAtlas& atlas, uint32_t key, const ImVector<ImWchar>& ranges)
+{
+    if (!atlas.TexPixelsAlpha8)
+        return false;
+    Close();
+
+    ImGuiFontCacheHeader header = {};
+    memcpy(header.magic, FontCacheMagic, sizeof(FontCacheMagic));
+    header.version = FontCacheVersion;
+    header.key = key;
+    header.rangeNum = (uint32_t)ranges.Size;
+    header.fontNum = (uint32_t)atlas.Fonts.Size;
+    header.customRectNum = (uint32_t)atlas.CustomRects.Size;
+    header.texWidth = atlas.TexWidth;
+    header.texHeight = atlas.TexHeight;
+    header.packIdMouseCursors = atlas.PackIdMouseCursors;
+    header.packIdLines = atlas.PackIdLines;
+    header.texUvScale = atlas.TexUvScale;
+    header.texUvWhitePixel = atlas.TexUvWhitePixel;
+    memcpy(header.texUvLines, atlas.TexUvLines, sizeof(header.texUvLines));
+
+    std::string data;
+    auto put = [&data](const void* ptr, size_t size) {
+        data.append((const char*)ptr, size);
+        data.resize(AlignFontCache(data.size()));
+    };
+    put(&header, sizeof(header));
+    put(ranges.Data, ranges.Size * sizeof(ImWchar));
+    for (ImFont* font : atlas.Fonts) {
+        ImGuiFontCacheFont record = {font->FontSize, font->Ascent, font->Descent, (uint32_t)font->Glyphs.Size};
+        put(&record, sizeof(record));
+        put(font->Glyphs.Data, font->Glyphs.Size * sizeof(ImFontGlyph));
+    }
+    put(atlas.CustomRects.Data, atlas.CustomRects.Size * sizeof(ImFontAtlasCustomRect));
+    put(atlas.TexPixelsAlpha8, (size_t)atlas.TexWidth * atlas.TexHeight);
+
+    std::string tempPath = path_ + ".tmp";
+    std::ofstream cacheFile(tempPath, std::ios::binary | std::ios::trunc);
+    cacheFile.write(data.data(), data.size());
+    cacheFile.close();
+    if (!cacheFile) {
+        SPDLOG_ERROR("Write font cache {} failed.", tempPath);
+        return false;
+    }
+    if (!::MoveFileEx(tempPath.data(), path_.data(), MOVEFILE_REPLACE_EXISTING)) {
+        SPDLOG_ERROR("MoveFileEx({}) failed. WinApi@", path_);
+        return false;
+    }
+    return true;
+}
+
+void ImGuiFontCache::Detach(ImFontAtlas& atlas) const
+{
+    const uint8_t* pixels = atlas.TexPixelsAlpha8;
+    if (view_ && pixels >= view_ && pixels < view_ + size_)
+        atlas.TexPixelsAlpha8 = nullptr;
+}
+
+void ImGuiFontCache::Close()
+{
+    if (view_)
+        ::UnmapViewOfFile(view_);
+    if (mapping_)
+        ::CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE)
+        ::CloseHandle(file_);
+    view_ = nullptr;
+    mapping_ = NULL;
+    file_ = INVALID_HANDLE_VALUE;
+    size_ = 0;
+}
+
+struct ImGuiFontSpec
+{
+    ImGuiEngine::Font id;
+    uint32_t resourceId;
+    float pixelSize;
+};
+
+static const ImGuiFontSpec FontSpecs[] = {
+    {ImGuiEngine::Font_MSYaHei, IDF_FONT_MSYAHEI, 16.0f},
+#ifdef IMGUI_ENABLE_FREETYPE
+    {ImGuiEngine::Font_MSYaHeiLight, IDF_FONT_MSYAHEI_LIGHT, 16.0f},
+    {ImGuiEngine::Font_MSYaheiBold, IDF_FONT_MSYAHEI_BOLD, 18.0f},
+#endif
+};
+
+ImGuiEngine::ImGuiEngine(std::unique_ptr<ImGuiBackend> backend, ImGuiServiceSource source,
+    ImGuiDetailSource detailSource)
+    : wakeEvent_(::CreateEvent(NULL, FALSE, FALSE, NULL), &::CloseHandle), backend_(std::move(backend))
+    , fontCache_(GetCacheDirectory() + "\\fontatlas.bin")
+    , navWnd_(this), servWnd_(this, std::move(source), std::move(detailSource))
 {
     IMGUI_CHECKVERSION();
+    // Count ImGui heap traffic so a steady frame can be checked for allocations.
+    ImGui::SetAllocatorFunctions(AllocProc, FreeProc);
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
     io.IniFilename = NULL;
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;
 
-    auto* fontAtlas = io.Fonts;
-    const ImWchar *chineseGlyphRanges = fontAtlas->GetGlyphRangesChineseSimplifiedCommon();
-    fonts_[Font_Default] = fontAtlas->AddFontDefault();
-    fonts_[Font_MSYaHei] = AddFont(io, IDF_FONT_MSYAHEI, 16.0f);
+    BuildFonts();
+    ImGui::StyleColorsLight();
+
+    backend_->Init();
+}
+
+ImGuiEngine::~ImGuiEngine()
+{
+    backend_->Shutdown();
+    fontCache_.Detach(*ImGui::GetIO().Fonts);
+    ImGui::DestroyContext();
+}
+
+uint32_t ImGuiEngine::GetFontKey()
+{
+    // The table directory at the head of a font file carries every table checksum.
+    uint32_t key = ImHashData(&FontCacheVersion, sizeof(FontCacheVersion));
+    uint32_t layout[] = {(uint32_t)sizeof(ImFontGlyph), (uint32_t)sizeof(ImFontAtlasCustomRect), IMGUI_VERSION_NUM};
+    key = ImHashData(layout, sizeof(layout), key);
 #ifdef IMGUI_ENABLE_FREETYPE
-    fonts_[Font_MSYaHeiLight] = AddFont(io, IDF_FONT_MSYAHEI_LIGHT, 16.0f);
-    fonts_[Font_MSYaheiBold] = AddFont(io, IDF_FONT_MSYAHEI_BOLD, 18.0f);
+    key = ImHashStr("freetype", 0, key);
 #endif
+    for (auto& spec : FontSpecs) {
+        HRSRC resHandle = ::FindResource(nullptr, MAKEINTRESOURCE(spec.resourceId), RT_FONT);
+        const void* data = ::LockResource(::LoadResource(nullptr, resHandle));
+        DWORD dataSize = ::SizeofResource(nullptr, resHandle);
+        key = ImHashData(&spec.pixelSize, sizeof(spec.pixelSize), key);
+        key = ImHashData(&dataSize, sizeof(dataSize), key);
+        if (data)
+            key = ImHashData(data, (std::min)(dataSize, (DWORD)65536), key);
+    }
+    return key;
+}
+
+void ImGuiEngine::BuildFonts()
+{
+    auto startTime = std::chrono::steady_clock::now();
+    ImGuiIO& io = ImGui::GetIO();
+    auto* fontAtlas = io.Fonts;
+    fontCache_.Detach(*fontAtlas);
+    fontAtlas->Clear();
+    fonts_.clear();
+
+    // Glyphs beyond Latin are only rasterized once some text needs them; the cache remembers them.
+    uint32_t key = GetFontKey();
+    bool isCached = false;
+    if (glyphRanges_.empty()) {
+        auto ranges = fontCache_.Open(key);
+        if (ranges) {
+            glyphs_.AddRanges(ranges->Data);
+            isCached = true;
+        }
+        glyphs_.AddRanges(fontAtlas->GetGlyphRangesDefault());
+    }
+    glyphRanges_.clear();
+    glyphs_.BuildRanges(&glyphRanges_);
+
+    fonts_[Font_Default] = fontAtlas->AddFontDefault();
+    for (auto& spec : FontSpecs)
+        fonts_[spec.id] = AddFont(io, spec.resourceId, spec.pixelSize);
     io.FontDefault = fonts_[Font_MSYaHei];
 
-    ImGui::StyleColorsLight();
+    isCached = isCached && fontCache_.Restore(*fontAtlas);
+    if (!isCached) {
+        fontCache_.Close();
+        fontAtlas->Build();
+        fontCache_.Save(*fontAtlas, key, glyphRanges_);
+    }
 
-    ImGui_ImplWin32_Init(hwnd);
-    ImGui_ImplDX11_Init(dx11_.device, dx11_.deviceContext);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+    size_t glyphNum = 0;
+    for (ImFont* font : fontAtlas->Fonts)
+        glyphNum += font->Glyphs.Size;
+    SPDLOG_INFO("Font atlas {} in {} ms: {}x{} ({} KB alpha8), {} glyphs", isCached ? "mapped" : "built",
+        elapsed.count(), fontAtlas->TexWidth, fontAtlas->TexHeight,
+        fontAtlas->TexWidth * fontAtlas->TexHeight / 1024, glyphNum);
 }
 
-ImGuiEngine::~ImGuiEngine()
+void ImGuiEngine::RequireGlyphs(const ImVector<ImWchar>& ranges)
 {
-    ImGui_ImplDX11_Shutdown();
-    ImGui_ImplWin32_Shutdown();
-    ImGui::DestroyContext();
+    // Ranges are inclusive pairs closed by a zero, ASCII is always baked.
+    for (int i = 0; i + 1 < ranges.Size && ranges[i]; i += 2) {
+        for (unsigned int c = (std::max)((unsigned int)ranges[i], 0x80u); c <= ranges[i + 1]; c++) {
+            if (!glyphs_.GetBit(c)) {
+                glyphs_.AddChar((ImWchar)c);
+                isFontDirty_ = true;
+            }
+        }
+    }
+}
+
+void ImGuiEngine::RequireGlyphs(const std::string& text)
+{
+    const char* cursor = text.data();
+    const char* end = cursor + text.size();
+    while (cursor < end) {
+        if ((unsigned char)*cursor < 0x80) {
+            cursor++;
+            continue;
+        }
+        unsigned int c = 0;
+        cursor += ImTextCharFromUtf8(&c, cursor, end);
+        if (c <= IM_UNICODE_CODEPOINT_MAX && !glyphs_.GetBit(c)) {
+            glyphs_.AddChar((ImWchar)c);
+            isFontDirty_ = true;
+        }
+    }
 }
 
 ImFont* ImGuiEngine::AddFont(ImGuiIO& io, uint32_t resourceId, float pixelSize)
@@ -826,24 +2055,28 @@ ImFont* ImGuiEngine::AddFont(ImGuiIO& io, uint32_t resourceId, float pixelSize)
     fontCfg.FontDataOwnedByAtlas = false;
 
     ImFontAtlas& fontAtlas = *io.Fonts;
-    auto chineseGlyphRanges = fontAtlas.GetGlyphRangesChineseSimplifiedCommon();
     HRSRC resHandle = ::FindResource(nullptr, MAKEINTRESOURCE(resourceId), RT_FONT);
     HGLOBAL globHandle = ::LoadResource(nullptr, resHandle);
     void* data = ::LockResource(globHandle);
     DWORD dataSize = ::SizeofResource(nullptr, resHandle);
-    return fontAtlas.AddFontFromMemoryTTF(data, dataSize, pixelSize, &fontCfg, chineseGlyphRanges);
+    return fontAtlas.AddFontFromMemoryTTF(data, dataSize, pixelSize, &fontCfg, glyphRanges_.Data);
 }
 
 void ImGuiEngine::ResetMainWnd()
 {
-    ImGui_ImplDX11_NewFrame();
-    ImGui_ImplWin32_NewFrame();
+    frameAllocBase_ = allocNum_;
+    if (isFontDirty_) {
+        isFontDirty_ = false;
+        BuildFonts();
+        backend_->InvalidateFonts();
+    }
+    backend_->NewFrame();
     ImGui::NewFrame();
 }
 
 void ImGuiEngine::SetMainSize(int width, int height)
 {
-    dx11_.ResizeBuffer(width, height);
+    backend_->SetViewSize(width, height);
 
     ImGuiViewport* viewport = ImGui::GetMainViewport();
     viewport->Size.x = static_cast<float>(width);
@@ -852,14 +2085,14 @@ void ImGuiEngine::SetMainSize(int width, int height)
 
 void ImGuiEngine::SetMainColor(float x, float y, float z, float w)
 {
-    dx11_.SetViewColor(x*w, y*w, z*w, w);
+    backend_->SetViewColor(x*w, y*w, z*w, w);
 }
 
 void ImGuiEngine::ShowMainWnd(bool hasVsync)
 {
     ImGui::Render();
-    ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
-    dx11_.SwapBuffer(hasVsync);
+    backend_->RenderFrame(hasVsync);
+    frameAllocNum_ = allocNum_ - frameAllocBase_;
 }
 
 void ImGuiEngine::ShowWidgetWnd()
@@ -900,6 +2133,7 @@ LRESULT WINAPI GuiWindow::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lPa
 }
 
 GuiWindow::GuiWindow(const std::string& name, int x, int y, int width, int height)
+    : usageTick_(0), usageCpuTime_(0)
 {
     wcx_ = std::make_unique<WNDCLASSEX>();
     wcx_->cbSize = sizeof(WNDCLASSEX);
@@ -922,7 +2156,7 @@ GuiWindow::GuiWindow(const std::string& name, int x, int y, int width, int heigh
 
     InitIcon(hwnd_);
 
-    imgui_ = std::make_unique<ImGuiEngine>(hwnd_);
+    imgui_ = std::make_unique<ImGuiEngine>(std::make_unique<ImGuiWin32Backend>(hwnd_));
 
     ::ShowWindow(hwnd_, SW_SHOWDEFAULT);
     ::UpdateWindow(hwnd_);
@@ -951,24 +2185,63 @@ void GuiWindow::UpdateSize(UINT width, UINT height)
     imgui_->SetMainSize(width, height);
 }
 
+void GuiWindow::UpdateUsage(uint64_t tick)
+{
+    if (tick - usageTick_ < 1000)
+        return;
+
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!::GetProcessTimes(::GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+        return;
+
+    uint64_t cpuTime = (((uint64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime)
+        + (((uint64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime);
+    if (usageTick_) {
+        // FILETIME counts 100ns units, the tick counts milliseconds.
+        float usage = (cpuTime - usageCpuTime_) / 100.0f / (tick - usageTick_);
+        imgui_->GetScheduler().SetCpuUsage(usage);
+    }
+    usageTick_ = tick;
+    usageCpuTime_ = cpuTime;
+}
+
 void GuiWindow::PollMessage()
 {
+    // Block until input, a wake from the refresher or task pool, or a pending animation needs a frame.
+    auto& scheduler = imgui_->GetScheduler();
+    HANDLE wakeEvent = imgui_->GetWakeEvent();
+    scheduler.MarkActive(::GetTickCount64());
+
     bool done = false;
     while (!done) {
+        DWORD timeout = scheduler.GetWaitTimeout(::GetTickCount64());
+        DWORD result = ::MsgWaitForMultipleObjects(1, &wakeEvent, FALSE, timeout, QS_ALLINPUT);
+        uint64_t tick = ::GetTickCount64();
+        if (result == WAIT_OBJECT_0)
+            scheduler.MarkActive(tick);
+
         MSG msg;
         while (::PeekMessage(&msg, nullptr, 0U, 0U, PM_REMOVE)) {
             ::TranslateMessage(&msg);
             ::DispatchMessage(&msg);
             if (msg.message == WM_QUIT)
                 done = true;
+            scheduler.MarkActive(tick);
         }
         if (done)
             break;
 
+        UpdateUsage(tick);
+        scheduler.SetMinimized(::IsIconic(hwnd_));
+        if (!scheduler.ShouldRender(tick))
+            continue;
+
+        scheduler.BeginFrame();
         imgui_->ResetMainWnd();
         imgui_->ShowWidgetWnd();
         imgui_->SetMainColor(0.45f, 0.55f, 0.60f, 1.00f);
         imgui_->ShowMainWnd(true);
+        scheduler.EndFrame(::GetTickCount64());
     }
 }
 
@@ -979,6 +2252,327 @@ int GuiMain(int argc, char *argv[])
     return 0;
 }
 
+#ifdef WSGUI_BENCH
+static std::atomic<uint64_t> BenchAllocNum(0);
+
+void* operator new(size_t size)
+{
+    BenchAllocNum++;
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+struct GuiBenchResult
+{
+    std::string name;
+    std::vector<double> frameMS;
+    std::vector<uint64_t> allocNums;
+    std::vector<uint64_t> imguiAllocNums;
+    double cpuMS = 0.0;
+    uint64_t detailLoadNum = 0;
+    uint64_t snapshotNum = 0;
+
+    std::vector<size_t> GetAllocFrames() const {
+        std::vector<size_t> frames;
+        for (size_t i = 0; i < allocNums.size(); i++) {
+            if (allocNums[i] || imguiAllocNums[i])
+                frames.push_back(i);
+        }
+        return frames;
+    }
+
+    std::string ToString() const {
+        std::vector<double> sorted(frameMS);
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&sorted](double p) {
+            return sorted.empty() ? 0.0 : sorted[(std::min)(sorted.size() - 1, (size_t)(p * sorted.size()))];
+        };
+        uint64_t allocNum = 0, allocMax = 0, imguiAllocNum = 0;
+        for (size_t i = 0; i < allocNums.size(); i++) {
+            allocNum += allocNums[i];
+            allocMax = (std::max)(allocMax, allocNums[i]);
+            imguiAllocNum += imguiAllocNums[i];
+        }
+        size_t frameNum = (std::max)(frameMS.size(), (size_t)1);
+        return fmt::format("{:<24} frames={:<5} p50={:.3f}ms p95={:.3f}ms max={:.3f}ms cpu={:.3f}ms/frame "
+            "allocs={:.1f}/frame (max {}) imgui={:.1f}/frame details={} snapshots={}",
+            name, frameMS.size(), percentile(0.50), percentile(0.95), percentile(1.0),
+            cpuMS / frameNum, (double)allocNum / frameNum, allocMax, (double)imguiAllocNum / frameNum, detailLoadNum,
+            snapshotNum);
+    }
+};
+
+static std::vector<ImGuiServiceItem> MakeBenchItems(size_t itemNum)
+{
+    static const DWORD states[] = {SERVICE_STOPPED, SERVICE_RUNNING, SERVICE_PAUSED, SERVICE_START_PENDING};
+    static const DWORD startTypes[] = {SERVICE_AUTO_START, SERVICE_DEMAND_START, SERVICE_DISABLED};
+
+    std::vector<ImGuiServiceItem> items;
+    items.reserve(itemNum);
+    for (size_t i = 0; i < itemNum; i++) {
+        std::string name = fmt::format("bench-svc-{:06}", (i * 7919) % itemNum);
+        std::string path = fmt::format("C:\\bench\\winsvc.exe RunAsService -n {} -p C:\\bench\\app{}.exe", name, i % 97);
+
+        SERVICE_STATUS_PROCESS ssp = {};
+        ssp.dwServiceType = SERVICE_WIN32_OWN_PROCESS;
+        ssp.dwCurrentState = states[i % 4];
+        ssp.dwProcessId = (ssp.dwCurrentState == SERVICE_RUNNING) ? (DWORD)(1000 + i) : 0;
+        WSvcStatus status(name, "Bench " + name, ssp);
+
+        QUERY_SERVICE_CONFIG qsc = {};
+        qsc.dwServiceType = SERVICE_WIN32_OWN_PROCESS;
+        qsc.dwStartType = startTypes[i % 3];
+        qsc.lpBinaryPathName = path.data();
+        SERVICE_DESCRIPTION sd = {};
+        items.emplace_back((int)i + 1, std::move(status), WSvcConfig(name, qsc, sd));
+    }
+    return items;
+}
+
+static void RunBenchFrame(ImGuiEngine& engine, GuiBenchResult* result)
+{
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    uint64_t allocBase = BenchAllocNum;
+    QueryPerformanceCounter(&start);
+
+    engine.ResetMainWnd();
+    engine.ShowWidgetWnd();
+    engine.ShowMainWnd(false);
+
+    QueryPerformanceCounter(&end);
+    if (result) {
+        result->allocNums.push_back(BenchAllocNum - allocBase);
+        result->imguiAllocNums.push_back(engine.GetFrameAllocNum());
+        result->frameMS.push_back((end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart);
+    }
+}
+
+static double GetThreadCpuMS()
+{
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+        return 0.0;
+    uint64_t cpuTime = (((uint64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime)
+        + (((uint64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime);
+    return cpuTime / 10000.0;
+}
+
+static GuiBenchResult RunBenchScript(ImGuiEngine& engine, const std::string& name, int frameNum,
+    std::function<void(int frame)> step)
+{
+    GuiBenchResult result;
+    result.name = name;
+    double cpuBase = GetThreadCpuMS();
+    uint64_t detailBase = engine.GetServiceWnd().GetDetails().GetLoadNum();
+    uint64_t versionBase = engine.GetServiceWnd().GetSnapshotVersion();
+    for (int frame = 0; frame < frameNum; frame++) {
+        step(frame);
+        RunBenchFrame(engine, &result);
+    }
+    result.cpuMS = GetThreadCpuMS() - cpuBase;
+    result.detailLoadNum = engine.GetServiceWnd().GetDetails().GetLoadNum() - detailBase;
+    result.snapshotNum = engine.GetServiceWnd().GetSnapshotVersion() - versionBase;
+    return result;
+}
+
+static std::vector<double> TimeBenchRuns(int runNum, const std::function<void()>& op)
+{
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    std::vector<double> runMS;
+    for (int i = 0; i < runNum; i++) {
+        QueryPerformanceCounter(&start);
+        op();
+        QueryPerformanceCounter(&end);
+        runMS.push_back((end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart);
+    }
+    std::sort(runMS.begin(), runMS.end());
+    return runMS;
+}
+
+static std::string FormatBenchRuns(const std::string& name, const std::vector<double>& runMS)
+{
+    return fmt::format("{:<24} runs={:<5} p50={:.3f}ms p95={:.3f}ms max={:.3f}ms", name, runMS.size(),
+        runMS[runMS.size() / 2], runMS[(std::min)(runMS.size() - 1, runMS.size() * 95 / 100)], runMS.back());
+}
+
+static int RunBenchKernels(size_t itemNum)
+{
+    // The sort and filter passes alone, without the frames around them.
+    auto items = MakeBenchItems(itemNum);
+    std::vector<const ImGuiServiceItem*> rows;
+    for (auto& item : items)
+        rows.push_back(&item);
+
+    SPDLOG_COUT("{} rows:", itemNum);
+    struct SortCase {
+        const char* name;
+        std::vector<ImGuiTableColumnSortSpecs> specs;
+    };
+    auto makeSpec = [](ImGuiServiceWnd::ColumnID columnID, ImGuiSortDirection direction) {
+        ImGuiTableColumnSortSpecs spec;
+        spec.ColumnUserID = columnID;
+        spec.SortDirection = direction;
+        return spec;
+    };
+    const SortCase sortCases[] = {
+        {"sort name", {makeSpec(ImGuiServiceWnd::ColumnID_Name, ImGuiSortDirection_Ascending)}},
+        {"sort pid desc", {makeSpec(ImGuiServiceWnd::ColumnID_PID, ImGuiSortDirection_Descending)}},
+        {"sort path", {makeSpec(ImGuiServiceWnd::ColumnID_Path, ImGuiSortDirection_Ascending)}},
+        {"sort state,name", {makeSpec(ImGuiServiceWnd::ColumnID_State, ImGuiSortDirection_Ascending),
+            makeSpec(ImGuiServiceWnd::ColumnID_Name, ImGuiSortDirection_Ascending)}},
+    };
+
+    std::vector<int> order;
+    for (auto& sortCase : sortCases) {
+        ImGuiTableSortSpecs sortSpecs;
+        sortSpecs.Specs = sortCase.specs.data();
+        sortSpecs.SpecsCount = (int)sortCase.specs.size();
+        ImGuiServiceSorter sorter;
+        sorter.Init(&sortSpecs);
+        SPDLOG_COUT("  {}", FormatBenchRuns(sortCase.name, TimeBenchRuns(20, [&] { sorter.Sort(rows, order); })));
+
+        // A task result moves one row in the sorted order as ApplyDelta does, instead of sorting again.
+        int index = (int)(rows.size() / 2);
+        SPDLOG_COUT("  {}", FormatBenchRuns(std::string(sortCase.name) + " insert", TimeBenchRuns(200, [&] {
+            order.erase(std::remove(order.begin(), order.end(), index), order.end());
+            sorter.Insert(rows, order, index);
+        })));
+    }
+
+    // Every keystroke matches every row, the median pass must stay within 1 ms for 50k rows.
+    int ret = 0;
+    const std::vector<std::string> columnIDs({
+        "ID", "Name", "Alias", "Type", "Startup", "State", "PID", "Path", "Desc", "Sched", "Any"
+    });
+    struct MatchCase {
+        const char* name;
+        std::string text;
+        ImGuiServiceWnd::ColumnID columnID;
+    };
+    const MatchCase matchCases[] = {
+        {"match name", "bench-svc-0012", ImGuiServiceWnd::ColumnID_Name},
+        {"match any", "app42", ImGuiServiceWnd::ColumnID_Any},
+        {"match any miss", "zzz", ImGuiServiceWnd::ColumnID_Any},
+        {"match terms", "path:app1 -state:running", ImGuiServiceWnd::ColumnID_Any},
+    };
+
+    std::vector<uint8_t> matches(rows.size());
+    for (auto& matchCase : matchCases) {
+        ImGuiServiceQuery query;
+        query.Parse(matchCase.text, matchCase.columnID, columnIDs);
+        auto runMS = TimeBenchRuns(50, [&] {
+            for (size_t i = 0; i < rows.size(); i++)
+                matches[i] = query.Match(*rows[i]);
+        });
+        SPDLOG_COUT("  {}", FormatBenchRuns(matchCase.name, runMS));
+        if (runMS[runMS.size() / 2] > 1.0) {
+            SPDLOG_COUT("  FAIL {} over the 1 ms filter budget", matchCase.name);
+            ret = 1;
+        }
+    }
+
+    // A longer query only looks at the rows the shorter one kept.
+    ImGuiServiceQuery query;
+    query.Parse("bench-svc-00", ImGuiServiceWnd::ColumnID_Name, columnIDs);
+    for (size_t i = 0; i < rows.size(); i++)
+        matches[i] = query.Match(*rows[i]);
+    ImGuiServiceQuery narrower;
+    narrower.Parse("bench-svc-001", ImGuiServiceWnd::ColumnID_Name, columnIDs);
+    std::vector<uint8_t> narrowed(matches.size());
+    SPDLOG_COUT("  {}", FormatBenchRuns("match narrower", TimeBenchRuns(50, [&] {
+        for (size_t i = 0; i < rows.size(); i++)
+            narrowed[i] = matches[i] && narrower.Match(*rows[i]);
+    })));
+    return ret;
+}
+
+int GuiBenchMain(int argc, char *argv[])
+{
+    // Drives the real navigation and service windows on the null backend with synthetic models.
+    std::vector<size_t> itemNums;
+    for (int i = 2; i < argc; i++)
+        itemNums.push_back(std::stoul(argv[i]));
+    if (itemNums.empty())
+        itemNums = {1000, 10000, 100000};
+
+    int ret = RunBenchKernels(50000);
+    for (size_t itemNum : itemNums) {
+        auto items = std::make_shared<std::vector<ImGuiServiceItem>>(MakeBenchItems(itemNum));
+        // Detail loads stand in for the per-row QueryServiceConfig2 calls, compare them with the row count.
+        ImGuiEngine engine(std::make_unique<ImGuiNullBackend>(1280, 800), [items] { return *items; },
+            [](const ImGuiDetailRequest& request) {
+                return ImGuiServiceDetail{"Synthetic service " + request.name + " for frame benchmarks", ""};
+            });
+        engine.SetMainSize(1280, 800);
+        engine.GetServiceWnd().GetRefresher().SetInterval(0);
+        engine.GetNavigationWnd().SetMode(ImGuiNavigationWnd::Mode_All);
+
+        for (int wait = 0; wait < 6000 && engine.GetServiceWnd().GetViewNum() != itemNum; wait++) {
+            RunBenchFrame(engine, nullptr);
+            Sleep(1);
+        }
+        if (engine.GetServiceWnd().GetViewNum() != itemNum) {
+            SPDLOG_COUT("{} services: snapshot not adopted", itemNum);
+            continue;
+        }
+
+        ImGuiIO& io = ImGui::GetIO();
+        std::vector<GuiBenchResult> results;
+        results.push_back(RunBenchScript(engine, "idle", 120, [](int frame) {}));
+        results.push_back(RunBenchScript(engine, "scroll", 240, [&io](int frame) {
+            io.AddMousePosEvent(640.0f, 400.0f);
+            io.AddMouseWheelEvent(0.0f, (frame < 120) ? -5.0f : 5.0f);
+        }));
+        results.push_back(RunBenchScript(engine, "sort", 40, [&engine](int frame) {
+            static const ImGuiServiceWnd::ColumnID columnIDs[] = {
+                ImGuiServiceWnd::ColumnID_Name, ImGuiServiceWnd::ColumnID_State,
+                ImGuiServiceWnd::ColumnID_PID, ImGuiServiceWnd::ColumnID_Path
+            };
+            engine.GetServiceWnd().RequestSort(columnIDs[frame % 4], frame % 2 == 0);
+        }));
+        const std::string query = "bench-svc-0012";
+        results.push_back(RunBenchScript(engine, "filter", (int)query.size() * 2, [&engine, &query](int frame) {
+            int length = (frame < (int)query.size()) ? frame + 1 : (int)query.size() * 2 - frame - 1;
+            engine.GetNavigationWnd().SetFilter(query.substr(0, length));
+        }));
+
+        // The worker publishes snapshots while frames run, p95 shows what adopting one costs a frame.
+        auto& refresher = engine.GetServiceWnd().GetRefresher();
+        results.push_back(RunBenchScript(engine, "refresh", 300, [&refresher](int frame) {
+            if (frame % 30 == 0)
+                refresher.Request();
+            Sleep(4);
+        }));
+        for (int wait = 0; wait < 6000 && refresher.IsRefreshing(); wait++)
+            Sleep(1);
+        RunBenchFrame(engine, nullptr);
+        RunBenchFrame(engine, nullptr);
+        results.push_back(RunBenchScript(engine, "steady", 120, [](int frame) {}));
+
+        SPDLOG_COUT("{} services:", itemNum);
+        for (auto& result : results)
+            SPDLOG_COUT("  {}", result.ToString());
+
+        // Steady frames must not touch the heap, neither through new nor through ImGui.
+        auto allocFrames = results.back().GetAllocFrames();
+        if (!allocFrames.empty()) {
+            SPDLOG_COUT("  FAIL steady frames allocate: {}", fmt::join(allocFrames, ","));
+            ret = 1;
+        }
+    }
+    return ret;
+}
+#endif
+
 bool ResetConsolePosition(HANDLE stdOut)
 {
     CONSOLE_SCREEN_BUFFER_INFO csbi;
@@ -1020,7 +2614,11 @@ int ConsoleMainProxy(int argc, char *argv[])
     SetConsoleOutputCP(CP_UTF8);
     SetConsoleMode(stdIn, ENABLE_INSERT_MODE);
 
+#ifdef WSGUI_BENCH
+    int ret = (std::string(argv[1]) == "guibench") ? GuiBenchMain(argc, argv) : ConsoleMain(argc, argv, hasConsole);
+#else
     int ret = ConsoleMain(argc, argv, hasConsole);
+#endif
     FreeConsole();
     return ret;
 }
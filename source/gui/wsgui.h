@@ -1,7 +1,18 @@
 #pragma once
 
 #include <d3d11.h>
+#include <condition_variable>
+#include <array>
+#include <deque>
+#include <functional>
+#include <list>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include "util/wsutil.h"
+#include "gui/wsframe.h"
+#include "gui/wsmodel.h"
 #include "imgui/imgui.h"
 
 class D3D11Device
@@ -25,32 +36,238 @@ public:
     IDXGISwapChain* swapChain;
 };
 
+class ImGuiBackend
+{
+public:
+    virtual ~ImGuiBackend() {}
+
+    virtual void Init() = 0;
+    virtual void Shutdown() = 0;
+    virtual void NewFrame() = 0;
+    virtual void RenderFrame(bool hasVsync) = 0;
+    virtual void SetViewSize(int width, int height) = 0;
+    virtual void SetViewColor(float r, float g, float b, float alpha) = 0;
+    virtual void InvalidateFonts() = 0;
+};
+
+class ImGuiWin32Backend : public ImGuiBackend
+{
+public:
+    ImGuiWin32Backend(HWND hwnd) : hwnd_(hwnd), dx11_(hwnd) {}
+
+    void Init() override;
+    void Shutdown() override;
+    void NewFrame() override;
+    void RenderFrame(bool hasVsync) override;
+    void SetViewSize(int width, int height) override;
+    void SetViewColor(float r, float g, float b, float alpha) override;
+    void InvalidateFonts() override;
+
+private:
+    HWND hwnd_;
+    D3D11Device dx11_;
+};
+
+class ImGuiNullBackend : public ImGuiBackend
+{
+public:
+    ImGuiNullBackend(int width, int height) : width_(width), height_(height) {}
+
+    void Init() override;
+    void Shutdown() override {}
+    void NewFrame() override;
+    void RenderFrame(bool hasVsync) override {}
+    void SetViewSize(int width, int height) override { width_ = width; height_ = height; }
+    void SetViewColor(float r, float g, float b, float alpha) override {}
+    void InvalidateFonts() override {}
+
+private:
+    int width_;
+    int height_;
+};
+
 class ImGuiEngine;
 
-class ImGuiServiceItem
+class ImGuiServiceItem : public ImGuiServiceKeys
 {
 public:
-    static void Init(const ImGuiTableSortSpecs* sortSpecs);
-    static int Compare(const void* lhs, const void* rhs);
+    static std::optional<ImGuiServiceItem> Load(int id, const WSvcStatus& status);
 
-    ImGuiServiceItem(int id, WSvcStatus status, WSvcConfig config);
-    int GetID() const { return id_; }
+    ImGuiServiceItem(int id, WSvcStatus status, WSvcConfig config, std::optional<ImGuiServiceDetail> detail = std::nullopt);
     const WSvcStatus& GetSvcStatus() const { return status_; }
     const WSvcConfig& GetSvcConfig() const { return config_; }
-    std::string GetName() const { return status_.serviceName; }
-    std::string GetAlias() const { return AnsiToUtf8(status_.displayName); }
-    std::string GetType() const { return config_.GetType(); }
-    std::string GetStartup() const { return config_.GetStartType(); }
-    std::string GetState() const { return status_.GetCurrentState(); }
+    const std::string& GetName() const { return status_.serviceName; }
+    const std::string& GetAlias() const { return alias_; }
+    const std::string& GetType() const { return type_; }
+    const std::string& GetStartup() const { return startup_; }
+    const std::string& GetState() const { return state_; }
+    int GetStartupIndex() const { return startupIndex_; }
+    int GetStateIndex() const { return stateIndex_; }
     uint32_t GetPID() const { return (uint32_t) status_.processId; }
-    std::string GetPath() const { return config_.binaryPathName; }
-    std::string GetDesc() const { return AnsiToUtf8(config_.description); }
+    const std::string& GetPath() const { return config_.binaryPathName; }
+    const std::string& GetDesc() const { return desc_; }
+    const std::string& GetSched() const { return sched_; }
+    bool HasDetail() const { return hasDetail_; }
+    std::optional<ImGuiServiceDetail> GetDetail() const;
+    void SetDetail(const ImGuiServiceDetail& detail);
+
+private:
+    void InitKeys();
 
 private:
-    int id_;
+    // Everything drawn per frame is prepared once here, so rows are shown without allocation.
     WSvcStatus status_;
     WSvcConfig config_;
-    static const ImGuiTableSortSpecs* sortSpecs_;
+    std::string sched_;
+    std::string alias_;
+    std::string desc_;
+    std::string type_;
+    std::string startup_;
+    std::string state_;
+    int startupIndex_;
+    int stateIndex_;
+    bool hasDetail_;
+};
+
+using ImGuiServiceSource = std::function<std::vector<ImGuiServiceItem>()>;
+
+// Shared by the refresher and the window once published, nothing changes it afterwards.
+struct ImGuiServiceSnapshot
+{
+    uint64_t version;
+    ULONGLONG startTick;
+    bool isStale;
+    std::vector<ImGuiServiceItem> items;
+    ImVector<ImWchar> glyphRanges;
+};
+
+struct ImGuiServiceDelta
+{
+    ULONGLONG tick;
+    std::string name;
+    std::optional<ImGuiServiceItem> item;
+};
+
+struct ImGuiTaskState
+{
+    enum State { State_Pending, State_Running, State_Failed, State_Done };
+
+    State state;
+    std::string action;
+    std::string error;
+};
+
+class ImGuiServiceTasks
+{
+public:
+    ImGuiServiceTasks(size_t workerNum, std::function<void()> onChange = nullptr);
+    ~ImGuiServiceTasks();
+
+    void Post(const std::string& name, const std::string& action, std::function<std::pair<bool, DWORD>()> run);
+    void Poll(std::map<std::string, ImGuiTaskState>& states, std::vector<ImGuiServiceDelta>& deltas);
+
+private:
+    struct Task {
+        std::string name;
+        std::string action;
+        std::function<std::pair<bool, DWORD>()> run;
+    };
+
+    void Run();
+    void Notify(const std::string& name, ImGuiTaskState state);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool isStopped_;
+    std::deque<Task> tasks_;
+    std::set<std::string> busyNames_;
+    std::vector<std::pair<std::string, ImGuiTaskState>> events_;
+    std::vector<ImGuiServiceDelta> deltas_;
+    std::function<void()> onChange_;
+    std::vector<std::thread> workers_;
+};
+
+class ImGuiServiceRefresher
+{
+public:
+    ImGuiServiceRefresher(uint32_t intervalMS, ImGuiServiceSource source = nullptr, std::function<void()> onChange = nullptr);
+    ~ImGuiServiceRefresher();
+
+    uint32_t GetInterval() const { return intervalMS_; }
+    bool IsRefreshing() const { return isRefreshing_; }
+    void SetInterval(uint32_t intervalMS);
+    void Request();
+    std::shared_ptr<const ImGuiServiceSnapshot> Acquire(uint64_t version) const;
+
+private:
+    void Run();
+    std::shared_ptr<ImGuiServiceSnapshot> Build();
+    std::shared_ptr<ImGuiServiceSnapshot> LoadCache();
+    static void CollectGlyphs(ImGuiServiceSnapshot& snapshot);
+    void SaveCache(const ImGuiServiceSnapshot& snapshot);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::atomic<bool> isStopped_;
+    bool isRequested_;
+    std::atomic<bool> isRefreshing_;
+    std::atomic<uint32_t> intervalMS_;
+    std::shared_ptr<const ImGuiServiceSnapshot> snapshot_;
+    ImGuiServiceSource source_;
+    std::function<void()> onChange_;
+    std::thread thread_;
+};
+
+struct ImGuiDetailRequest
+{
+    std::string name;
+    bool isAgent;
+    bool isRunning;
+};
+
+using ImGuiDetailSource = std::function<ImGuiServiceDetail(const ImGuiDetailRequest&)>;
+
+class ImGuiServiceDetails
+{
+public:
+    ImGuiServiceDetails(size_t capacity, ImGuiDetailSource source = nullptr, std::function<void()> onChange = nullptr);
+    ~ImGuiServiceDetails();
+
+    uint64_t GetLoadNum() const { return loadNum_; }
+    void SetCapacity(size_t capacity);
+    const ImGuiServiceDetail* Find(const std::string& name);
+    void Request(const ImGuiServiceItem& item, bool isUrgent);
+    void Invalidate(const std::string& name);
+    void Poll(std::vector<std::pair<std::string, ImGuiServiceDetail>>& results);
+
+private:
+    void Run();
+    void Evict();
+
+private:
+    // The LRU and pending names belong to the UI thread, the worker only sees requests_ and results_.
+    size_t baseCapacity_;
+    size_t capacity_;
+    std::list<std::pair<std::string, ImGuiServiceDetail>> lru_;
+    std::unordered_map<std::string, std::list<std::pair<std::string, ImGuiServiceDetail>>::iterator> index_;
+    std::set<std::string> pendingNames_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool isStopped_;
+    std::deque<ImGuiDetailRequest> requests_;
+    std::vector<std::pair<std::string, ImGuiServiceDetail>> results_;
+    std::atomic<uint64_t> loadNum_;
+    ImGuiDetailSource source_;
+    std::function<void()> onChange_;
+    std::thread thread_;
+};
+
+struct ImGuiServiceBulk
+{
+    std::string action;
+    std::vector<std::string> names;
 };
 
 class ImGuiBaseWnd
@@ -97,42 +314,77 @@ private:
     char svcAlias_[256];
     char svcStartup_[256];
     char svcState_[256];
+    char svcSched_[256];
     char svcPath_[1024];
     char svcDesc_[2048];
 };
 
-class ImGuiServiceWnd : public ImGuiBaseWnd
+class ImGuiServiceWnd : public ImGuiBaseWnd, public ImGuiServiceColumns
 {
 public:
-    enum ColumnID {
-        ColumnID_ID,
-        ColumnID_Name,
-        ColumnID_Alias,
-        ColumnID_Type,
-        ColumnID_Startup,
-        ColumnID_State,
-        ColumnID_PID,
-        ColumnID_Path,
-        ColumnID_Desc
-    };
-
-    ImGuiServiceWnd(ImGuiEngine* engine);
+    ImGuiServiceWnd(ImGuiEngine* engine, ImGuiServiceSource source = nullptr, ImGuiDetailSource detailSource = nullptr);
 
     const std::vector<std::string>& GetColumnIDs() const { return columnIDs_; }
-    const std::vector<ImGuiServiceItem> GetItems() const { return items_; }
-    const ImVector<int> GetSelections() const { return selections_; }
+    const std::vector<const ImGuiServiceItem*>& GetRows() const { return rows_; }
+    const std::unordered_set<std::string>& GetSelections() const { return selections_; }
+    const ImGuiServiceBulk& GetBulk() const { return bulk_; }
+    bool GetBulkProgress(size_t& doneNum, size_t& failedNum) const;
+    void ClearBulk() { bulk_ = ImGuiServiceBulk(); }
+    size_t GetViewNum() const { return order_.size(); }
+    ImGuiServiceRefresher& GetRefresher() { return refresher_; }
+    uint64_t GetSnapshotVersion() const { return snapshot_ ? snapshot_->version : 0; }
+    bool IsStale() const { return snapshot_ && snapshot_->isStale; }
+    ImGuiServiceDetails& GetDetails() { return details_; }
+    void RequestSort(ColumnID columnID, bool isAscending);
     void SyncItems();
+    void RefreshFilter();
+    void PostTask(const std::string& name, const std::string& action, std::function<std::pair<bool, DWORD>()> run);
+    void PostBulk(const std::string& action, std::function<std::pair<bool, DWORD>(const std::string&)> run);
 
     void Show();
 
+private:
+    void AdoptSnapshot();
+    void ApplyTasks();
+    void ApplyDelta(const ImGuiServiceDelta& delta);
+    void ApplyDetails();
+    ImGuiServiceItem& Overlay(size_t index);
+    bool NeedsAllDetails() const;
+    void RequestDetails(int displayStart, int displayEnd);
+    void UpdateView();
+    bool PassMode(const ImGuiServiceItem& item) const;
+    void ShowTaskState(const ImGuiServiceItem& item);
+    void Select(int row);
+
 private:
     int startupID_;
     int stateID_;
+    int mode_;
+    bool isSortDirty_;
+    bool isFilterDirty_;
+    bool isViewDirty_;
+    std::optional<ImGuiServiceSorter::Spec> sortRequest_;
     std::vector<std::string> columnIDs_;
-    std::vector<ImGuiServiceItem> items_;
-    ImVector<int> selections_;
+    // Rows point into the shared snapshot, rows changed since by details or tasks into overlays_.
+    std::shared_ptr<const ImGuiServiceSnapshot> snapshot_;
+    std::vector<const ImGuiServiceItem*> rows_;
+    std::unordered_map<std::string, ImGuiServiceItem> overlays_;
+    std::vector<int> fullOrder_;
+    std::vector<uint8_t> matches_;
+    std::vector<int> order_;
+    ImGuiServiceSorter sorter_;
+    ImGuiServiceQuery query_;
+    std::vector<ImGuiServiceDelta> deltas_;
+    std::map<std::string, ImGuiTaskState> taskStates_;
+    std::vector<std::pair<std::string, ImGuiServiceDetail>> detailResults_;
+    std::unordered_set<std::string> selections_;
+    std::string selectAnchor_;
+    ImGuiServiceBulk bulk_;
     ImGuiTableFlags servTableFlags_;
     ImGuiPropertyWnd propertyWnd_;
+    ImGuiServiceRefresher refresher_;
+    ImGuiServiceTasks tasks_;
+    ImGuiServiceDetails details_;
 };
 
 class ImGuiNavigationWnd : public ImGuiBaseWnd
@@ -149,6 +401,8 @@ public:
     ImGuiNavigationWnd(ImGuiEngine* engine);
 
     ImGuiTextFilter& GetFilter() { return filter_; }
+    void SetFilter(const std::string& text);
+    void SetMode(Mode mode);
     Mode GetMode() const { return static_cast<Mode>(mode_); }
     ImGuiServiceWnd::ColumnID GetColumnID() const {
         return static_cast<ImGuiServiceWnd::ColumnID>(columnID_);
@@ -165,15 +419,43 @@ private:
     ImGuiPropertyWnd propertyWnd_;
 };
 
+class ImGuiFontCache
+{
+public:
+    ImGuiFontCache(const std::string& path)
+        : path_(path), file_(INVALID_HANDLE_VALUE), mapping_(NULL), view_(nullptr), size_(0) {}
+    ~ImGuiFontCache() { Close(); }
+
+    std::optional<ImVector<ImWchar>> Open(uint32_t key);
+    bool Restore(ImFontAtlas& atlas) const;
+    bool Save(const ImFontAtlas& atlas, uint32_t key, const ImVector<ImWchar>& ranges);
+    void Detach(ImFontAtlas& atlas) const;
+    void Close();
+
+private:
+    std::string path_;
+    HANDLE file_;
+    HANDLE mapping_;
+    const uint8_t* view_;
+    size_t size_;
+};
+
 class ImGuiEngine
 {
 public:
     enum Font { Font_Default, Font_STZhongsong, Font_STXihei, Font_MSYaHei, Font_MSYaHeiLight, Font_MSYaheiBold };
 
-    ImGuiEngine(HWND hwnd);
+    ImGuiEngine(std::unique_ptr<ImGuiBackend> backend, ImGuiServiceSource source = nullptr,
+        ImGuiDetailSource detailSource = nullptr);
     ~ImGuiEngine();
 
     ImFont* GetFont(Font id) { return fonts_[id]; }
+    uint64_t GetFrameAllocNum() const { return frameAllocNum_; }
+    HANDLE GetWakeEvent() const { return wakeEvent_.get(); }
+    ImGuiFrameScheduler& GetScheduler() { return scheduler_; }
+    void RequireGlyphs(const std::string& text);
+    void RequireGlyphs(const ImVector<ImWchar>& ranges);
+    void Wake() { ::SetEvent(wakeEvent_.get()); }
     ImGuiNavigationWnd& GetNavigationWnd() { return navWnd_; }
     ImGuiServiceWnd& GetServiceWnd() { return servWnd_; }
 
@@ -184,11 +466,25 @@ public:
     void ShowWidgetWnd();
 
 private:
+    static void* AllocProc(size_t size, void* userData);
+    static void FreeProc(void* ptr, void* userData);
+    static uint32_t GetFontKey();
+    void BuildFonts();
     ImFont* AddFont(ImGuiIO& io, uint32_t resourceId, float pixelSize);
 
 private:
+    static std::atomic<uint64_t> allocNum_;
+    // Declared first so it is closed last, after the service window has joined the workers that wake the engine.
+    std::unique_ptr<std::remove_pointer_t<HANDLE>, decltype(&::CloseHandle)> wakeEvent_;
+    std::unique_ptr<ImGuiBackend> backend_;
+    ImGuiFrameScheduler scheduler_;
+    uint64_t frameAllocBase_ = 0;
+    uint64_t frameAllocNum_ = 0;
     std::map<int, ImFont*> fonts_;
-    D3D11Device dx11_;
+    ImGuiFontCache fontCache_;
+    ImFontGlyphRangesBuilder glyphs_;
+    ImVector<ImWchar> glyphRanges_;
+    bool isFontDirty_ = false;
     ImGuiNavigationWnd navWnd_;
     ImGuiServiceWnd servWnd_;
 };
@@ -205,11 +501,17 @@ private:
     static LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
     void InitIcon(HWND hwnd);
     void UpdateSize(UINT width, UINT height);
+    void UpdateUsage(uint64_t tick);
 
 private:
     HWND hwnd_;
+    uint64_t usageTick_;
+    uint64_t usageCpuTime_;
     static std::unique_ptr<WNDCLASSEX> wcx_;
     static std::unique_ptr<ImGuiEngine> imgui_;
 };
 
 int GuiMain(int argc, char *argv[]);
+#ifdef WSGUI_BENCH
+int GuiBenchMain(int argc, char *argv[]);
+#endif
@@ -0,0 +1,135 @@
+#include "gui/wsmodel.h"
+#include <cstring>
+#include <sstream>
+
+std::string ImGuiServiceKeys::FoldCase(const std::string& text)
+{
+    std::string folded(text);
+    for (auto& ch : folded) {
+        if (ch >= 'A' && ch <= 'Z')
+            ch += 'a' - 'A';
+    }
+    return folded;
+}
+
+static bool ContainsFolded(const std::string& text, const std::string& pattern)
+{
+    // memchr finds candidates for the first byte with the CRT's vectorized scan.
+    if (pattern.empty())
+        return true;
+    if (text.size() < pattern.size())
+        return false;
+
+    const char* begin = text.data();
+    const char* last = begin + text.size() - pattern.size();
+    const char first = pattern[0];
+    for (const char* p = begin; p <= last; p++) {
+        p = (const char*)memchr(p, first, last - p + 1);
+        if (!p)
+            return false;
+        if (memcmp(p + 1, pattern.data() + 1, pattern.size() - 1) == 0)
+            return true;
+    }
+    return false;
+}
+
+void ImGuiServiceQuery::Parse(const std::string& text, int columnID, const std::vector<std::string>& columnIDs)
+{
+    terms_.clear();
+    std::stringstream ss(text);
+    std::string word;
+    while (ss >> word) {
+        Term term{columnID, false, ""};
+        if (word[0] == '-') {
+            term.isExclude = true;
+            word.erase(0, 1);
+        }
+
+        size_t colon = word.find(':');
+        if (colon != std::string::npos) {
+            std::string prefix = ImGuiServiceKeys::FoldCase(word.substr(0, colon));
+            for (int i = 0; i < (int)columnIDs.size(); i++) {
+                if (ImGuiServiceKeys::FoldCase(columnIDs[i]) == prefix) {
+                    term.columnID = i;
+                    word.erase(0, colon + 1);
+                    break;
+                }
+            }
+        }
+
+        term.text = ImGuiServiceKeys::FoldCase(word);
+        if (!term.text.empty())
+            terms_.push_back(std::move(term));
+    }
+}
+
+bool ImGuiServiceQuery::IsNarrowerThan(const ImGuiServiceQuery& other) const
+{
+    for (auto& old : other.terms_) {
+        auto it = std::find_if(terms_.begin(), terms_.end(), [&old](const Term& term) {
+            if (term.columnID != old.columnID || term.isExclude != old.isExclude)
+                return false;
+            return term.isExclude ? (term.text == old.text) : (term.text.find(old.text) != std::string::npos);
+        });
+        if (it == terms_.end())
+            return false;
+    }
+    return true;
+}
+
+bool ImGuiServiceQuery::HasColumn(int columnID) const
+{
+    return std::any_of(terms_.begin(), terms_.end(), [columnID](const Term& term) {
+        return term.columnID == columnID || term.columnID == ImGuiServiceColumns::ColumnID_Any;
+    });
+}
+
+bool ImGuiServiceQuery::Match(const ImGuiServiceKeys& keys) const
+{
+    for (auto& term : terms_) {
+        bool isFound = false;
+        if (term.columnID == ImGuiServiceColumns::ColumnID_Any) {
+            for (int i = 0; i < ImGuiServiceKeys::KeyNum && !isFound; i++)
+                isFound = ContainsFolded(keys.GetTextKey(i), term.text);
+        } else {
+            isFound = ContainsFolded(keys.GetTextKey(term.columnID), term.text);
+        }
+        if (isFound == term.isExclude)
+            return false;
+    }
+    return true;
+}
+
+void ImGuiServiceSorter::Init(const ImGuiTableSortSpecs* sortSpecs)
+{
+    specs_.clear();
+    for (int n = 0; n < sortSpecs->SpecsCount; n++) {
+        const ImGuiTableColumnSortSpecs& columnSpec = sortSpecs->Specs[n];
+        if (columnSpec.SortDirection == ImGuiSortDirection_None)
+            continue;
+        specs_.push_back({(int)columnSpec.ColumnUserID, columnSpec.SortDirection == ImGuiSortDirection_Ascending});
+    }
+}
+
+bool ImGuiServiceSorter::HasColumn(int columnID) const
+{
+    return std::any_of(specs_.begin(), specs_.end(), [columnID](const Spec& spec) {
+        return spec.columnID == columnID;
+    });
+}
+
+bool ImGuiServiceSorter::Less(const ImGuiServiceKeys& a, const ImGuiServiceKeys& b) const
+{
+    for (auto& spec : specs_) {
+        int delta = 0;
+        int64_t lhs = a.GetNumberKey(spec.columnID);
+        int64_t rhs = b.GetNumberKey(spec.columnID);
+        if (lhs != rhs)
+            delta = (lhs < rhs) ? -1 : 1;
+        else
+            delta = a.GetTextKey(spec.columnID).compare(b.GetTextKey(spec.columnID));
+        if (delta != 0)
+            return spec.isAscending ? (delta < 0) : (delta > 0);
+    }
+    return a.GetID() < b.GetID();
+}
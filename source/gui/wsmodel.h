@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "imgui/imgui.h"
+
+// Sorting and filtering only see these keys, so they build and run without the SCM headers.
+struct ImGuiServiceColumns
+{
+    enum ColumnID {
+        ColumnID_ID,
+        ColumnID_Name,
+        ColumnID_Alias,
+        ColumnID_Type,
+        ColumnID_Startup,
+        ColumnID_State,
+        ColumnID_PID,
+        ColumnID_Path,
+        ColumnID_Desc,
+        ColumnID_Sched,
+        ColumnID_Any
+    };
+};
+
+struct ImGuiServiceDetail
+{
+    std::string desc;
+    std::string sched;
+};
+
+class ImGuiServiceKeys
+{
+public:
+    static constexpr int KeyNum = 10;
+    static std::string FoldCase(const std::string& text);
+
+    ImGuiServiceKeys(int id) : id_(id) { numberKeys_.fill(0); }
+    int GetID() const { return id_; }
+    const std::string& GetIDText() const { return textKeys_[0]; }
+    int64_t GetNumberKey(int columnID) const { return numberKeys_[columnID]; }
+    const std::string& GetTextKey(int columnID) const { return textKeys_[columnID]; }
+
+protected:
+    // Filled once by the row type, so sorting and filtering never allocate.
+    int id_;
+    std::array<int64_t, KeyNum> numberKeys_;
+    std::array<std::string, KeyNum> textKeys_;
+};
+
+class ImGuiServiceQuery
+{
+public:
+    struct Term {
+        int columnID;
+        bool isExclude;
+        std::string text;
+    };
+
+    void Parse(const std::string& text, int columnID, const std::vector<std::string>& columnIDs);
+    bool IsNarrowerThan(const ImGuiServiceQuery& other) const;
+    bool Match(const ImGuiServiceKeys& keys) const;
+    bool HasColumn(int columnID) const;
+
+private:
+    std::vector<Term> terms_;
+};
+
+class ImGuiServiceSorter
+{
+public:
+    struct Spec {
+        int columnID;
+        bool isAscending;
+    };
+
+    void Init(const ImGuiTableSortSpecs* sortSpecs);
+    bool IsEmpty() const { return specs_.empty(); }
+    bool HasColumn(int columnID) const;
+    bool Less(const ImGuiServiceKeys& a, const ImGuiServiceKeys& b) const;
+
+    template<typename Row>
+    void Sort(const std::vector<const Row*>& rows, std::vector<int>& order) const {
+        order.resize(rows.size());
+        for (int i = 0; i < (int)order.size(); i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [this, &rows](int a, int b) {
+            return Less(*rows[a], *rows[b]);
+        });
+    }
+
+    template<typename Row>
+    void Insert(const std::vector<const Row*>& rows, std::vector<int>& order, int index) const {
+        auto it = std::upper_bound(order.begin(), order.end(), index, [this, &rows](int a, int b) {
+            return Less(*rows[a], *rows[b]);
+        });
+        order.insert(it, index);
+    }
+
+private:
+    std::vector<Spec> specs_;
+};
@@ -0,0 +1,5 @@
+#pragma once
+
+// Stands in for util/wsutil.h so WSCommandLine builds off Windows, it only needs the standard strings.
+#include <string>
+#include <string_view>
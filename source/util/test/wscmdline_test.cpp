@@ -0,0 +1,202 @@
+// Checks WSCommandLine against known cases, a port of the Wine CommandLineToArgvW and its own invariants.
+//
+// Off Windows, from source/, with the stub wsutil.h:
+//   g++ -std=c++17 -g -fsanitize=address,undefined -Iutil/test/stub -I. util/test/wscmdline_test.cpp util/wscmdline.cpp -o wscmdline_test
+//   ./wscmdline_test [iterations]
+// On Windows: nmake test
+#include "util/wscmdline.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+static std::vector<std::string> Split(std::string_view cmdline, bool hasProgram = true)
+{
+    std::vector<std::string> args;
+    WSCommandLine parser(cmdline, hasProgram);
+    std::string_view arg;
+    while (parser.Next(arg)) {
+        args.push_back(hasProgram ? std::string(WSCommandLine::GetProgram(arg)) : WSCommandLine::Unquote(arg));
+        hasProgram = false;
+    }
+    return args;
+}
+
+// The copying pass of the Wine CommandLineToArgvW, kept close to the original to serve as the reference.
+static std::vector<std::string> SplitByWine(const std::string& cmdline)
+{
+    std::vector<std::string> args;
+    const char* s = cmdline.c_str();
+    std::string arg;
+    if (*s == '"') {
+        s++;
+        while (*s && *s != '"')
+            arg += *s++;
+        if (*s)
+            s++;
+    } else {
+        while (*s && *s != ' ' && *s != '\t')
+            arg += *s++;
+    }
+    args.push_back(arg);
+    while (*s == ' ' || *s == '\t')
+        s++;
+    if (!*s)
+        return args;
+
+    arg.clear();
+    int qcount = 0;
+    size_t bcount = 0;
+    while (*s) {
+        if ((*s == ' ' || *s == '\t') && qcount == 0) {
+            args.push_back(arg);
+            arg.clear();
+            while (*s == ' ' || *s == '\t')
+                s++;
+            bcount = 0;
+            if (!*s)
+                return args;
+        } else if (*s == '\\') {
+            arg += *s++;
+            bcount++;
+        } else if (*s == '"') {
+            if ((bcount & 1) == 0) {
+                arg.resize(arg.size() - bcount / 2);
+                qcount++;
+            } else {
+                arg.resize(arg.size() - bcount / 2 - 1);
+                arg += '"';
+            }
+            s++;
+            bcount = 0;
+            while (*s == '"') {
+                if (++qcount == 3) {
+                    arg += '"';
+                    qcount = 0;
+                }
+                s++;
+            }
+            if (qcount == 2)
+                qcount = 0;
+        } else {
+            arg += *s++;
+            bcount = 0;
+        }
+    }
+    args.push_back(arg);
+    return args;
+}
+
+static std::string Join(const std::vector<std::string>& args)
+{
+    std::string text;
+    for (auto& arg : args)
+        text += "<" + arg + ">";
+    return text;
+}
+
+static bool CheckCases()
+{
+    struct Case {
+        const char* cmdline;
+        std::vector<std::string> args;
+    };
+    const Case cases[] = {
+        {"\"C:\\Program Files\\winsvc.exe\" /RunAsService:web python -m http.server",
+            {"C:\\Program Files\\winsvc.exe", "/RunAsService:web", "python", "-m", "http.server"}},
+        {"a.exe \"a b\" c\\\\\"d e\" f\\\"g h\\\\i", {"a.exe", "a b", "c\\d e", "f\"g", "h\\\\i"}},
+        {"a.exe \"a\"\"b\" \"\"\"x\"\"\" ", {"a.exe", "a\"b \"x\" "}},
+        {"x.exe a\\\\\\\"b \"c\\\\\" d", {"x.exe", "a\\\"b", "c\\", "d"}},
+        {"\"C:\\p q\\x.exe\"/RunAsService:n cmd", {"C:\\p q\\x.exe", "/RunAsService:n", "cmd"}},
+        {"", {""}},
+    };
+
+    bool isOK = true;
+    for (auto& c : cases) {
+        auto args = Split(c.cmdline);
+        if (args != c.args) {
+            printf("FAIL case [%s]: %s, expect %s\n", c.cmdline, Join(args).c_str(), Join(c.args).c_str());
+            isOK = false;
+        }
+    }
+
+    WSCommandLine parser("\"C:\\Program Files\\winsvc.exe\"  /RunAsService:web  \"C:\\app dir\\a.exe\" --x 1  ");
+    std::string_view arg;
+    parser.Next(arg);
+    parser.Next(arg);
+    if (parser.GetRemainder() != "\"C:\\app dir\\a.exe\" --x 1  ") {
+        printf("FAIL remainder [%.*s]\n", (int)parser.GetRemainder().size(), parser.GetRemainder().data());
+        isOK = false;
+    }
+    return isOK;
+}
+
+static std::string RandomLine(std::mt19937& rng, const char* alphabet, size_t maxLength)
+{
+    std::string alphabetText(alphabet);
+    std::string line(rng() % maxLength, ' ');
+    for (auto& c : line)
+        c = alphabetText[rng() % alphabetText.size()];
+    return line;
+}
+
+static bool CheckWine(size_t iterationNum)
+{
+    std::mt19937 rng(7);
+    for (size_t i = 0; i < iterationNum; i++) {
+        std::string line = RandomLine(rng, "ab \t\"\\", 20);
+        auto args = Split(line);
+        auto expect = SplitByWine(line);
+        if (args != expect) {
+            printf("FAIL wine [%s]: %s, expect %s\n", line.c_str(), Join(args).c_str(), Join(expect).c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool CheckSlices(size_t iterationNum)
+{
+    // Every argument is an in-order slice of the input, plain ones unquote to themselves and parsing ends.
+    std::mt19937 rng(1);
+    for (size_t i = 0; i < iterationNum; i++) {
+        std::string line = RandomLine(rng, "ab \t\"\\/:", 24);
+        const char* begin = line.data();
+        const char* end = begin + line.size();
+        WSCommandLine parser(line, rng() % 2);
+        std::string_view arg;
+        const char* last = begin;
+        size_t argNum = 0;
+        while (parser.Next(arg)) {
+            if (arg.data() < last || arg.data() + arg.size() > end) {
+                printf("FAIL slice [%s]\n", line.c_str());
+                return false;
+            }
+            if (WSCommandLine::IsPlain(arg) && WSCommandLine::Unquote(arg) != arg) {
+                printf("FAIL plain [%s]\n", line.c_str());
+                return false;
+            }
+            if (++argNum > line.size() + 1) {
+                printf("FAIL loop [%s]\n", line.c_str());
+                return false;
+            }
+            last = arg.data() + arg.size();
+        }
+
+        auto remainder = WSCommandLine(line).GetRemainder();
+        if (remainder.data() + remainder.size() != end) {
+            printf("FAIL remainder [%s]\n", line.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t iterationNum = (argc > 1) ? std::stoul(argv[1]) : 1000000;
+    bool isOK = CheckCases();
+    isOK = CheckWine(iterationNum) && isOK;
+    isOK = CheckSlices(iterationNum) && isOK;
+    puts(isOK ? "ok" : "FAIL");
+    return isOK ? 0 : 1;
+}
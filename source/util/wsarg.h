@@ -11,22 +11,6 @@ public:
         return inst;
     }
 
-    ArgManager(const std::string& cmd) {
-        std::stringstream ss(cmd);
-        std::vector<std::string> args;
-        std::string arg;
-        while (ss >> arg) {
-            args.push_back(arg);
-        }
-
-        try {
-            version_ = "1.0";
-            InitMain(args, "main");
-        } catch (const std::runtime_error &err) {
-            SPDLOG_ERROR(err.what());
-        }
-    }
-
     auto Get(const std::string& name) const -> const argparse::ArgumentParser& {
         auto it = cmds_.find(name);
         if (it == cmds_.end())
@@ -64,6 +48,16 @@ private:
         c->add_subparser(InitSubcommand(AddStartArgument, "start"));
         c->add_subparser(InitSubcommand(AddStopArgument, "stop"));
         c->add_subparser(InitSubcommand(AddListArgument, "list"));
+        c->add_subparser(InitSubcommand(AddTopArgument, "top"));
+        c->add_subparser(InitSubcommand(AddBatchArgument, "batch"));
+        c->add_subparser(InitSubcommand(AddApplyArgument, "apply"));
+        c->add_subparser(InitSubcommand(AddBenchArgument, "bench"));
+        c->add_subparser(InitSubcommand(AddTailArgument, "tail"));
+        c->add_subparser(InitSubcommand(AddBrokerArgument, "broker"));
+        c->add_subparser(InitSubcommand(AddSchedArgument, "sched"));
+        c->add_subparser(InitSubcommand(AddLimitArgument, "limit"));
+        c->add_subparser(InitSubcommand(AddOnDemandArgument, "ondemand"));
+        c->add_subparser(InitSubcommand(AddStandbyArgument, "standby"));
         c->add_subparser(InitSubcommand(AddAgentArgument, "/RunAsService"));
 
         c->parse_args(AmendArgument(args));
@@ -113,6 +107,106 @@ private:
         c.add_argument("-p", "--path")
             .help("Command path.")
             .metavar("PATH");
+        c.add_argument("--shutdown-timeout")
+            .help("Time agent command gets to close on system shutdown in ms.")
+            .metavar("MS");
+        AddSchedOptions(c);
+        AddLimitOptions(c);
+        AddOnDemandOptions(c);
+        AddStandbyOptions(c);
+    }
+
+    static void AddSchedArgument(argparse::ArgumentParser& c) {
+        c.add_description("Show or change scheduling of agent command.");
+        c.add_argument("name")
+            .help("Service name.")
+            .metavar("NAME")
+            .required();
+        AddSchedOptions(c);
+    }
+
+    static void AddLimitArgument(argparse::ArgumentParser& c) {
+        c.add_description("Show or change resource limits of agent command.");
+        c.add_argument("name")
+            .help("Service name.")
+            .metavar("NAME")
+            .required();
+        AddLimitOptions(c);
+    }
+
+    static void AddOnDemandArgument(argparse::ArgumentParser& c) {
+        c.add_description("Show or change on-demand activation of agent command.");
+        c.add_argument("name")
+            .help("Service name.")
+            .metavar("NAME")
+            .required();
+        AddOnDemandOptions(c);
+    }
+
+    static void AddOnDemandOptions(argparse::ArgumentParser& c) {
+        c.add_argument("--listen-port")
+            .help("Local port where agent waits for connections, 0 keeps command always running.")
+            .metavar("PORT");
+        c.add_argument("--target-port")
+            .help("Local port where agent command listens.")
+            .metavar("PORT");
+        c.add_argument("--idle-timeout")
+            .help("Stop agent command after idle seconds, 0 is never.")
+            .metavar("SECONDS");
+    }
+
+    static void AddStandbyArgument(argparse::ArgumentParser& c) {
+        c.add_description("Show or change hot standby of agent command.");
+        c.add_argument("name")
+            .help("Service name.")
+            .metavar("NAME")
+            .required();
+        AddStandbyOptions(c);
+    }
+
+    static void AddStandbyOptions(argparse::ArgumentParser& c) {
+        c.add_argument("--standby")
+            .help("Keep a warmed second instance of agent command: on or off.")
+            .metavar("SWITCH");
+        c.add_argument("--ready-file")
+            .help("Standby is ready once this file exists.")
+            .metavar("PATH");
+        c.add_argument("--ready-marker")
+            .help("Standby is ready once it prints this text.")
+            .metavar("TEXT");
+        c.add_argument("--ready-timeout")
+            .help("Respawn standby not ready after these seconds.")
+            .metavar("SECONDS");
+    }
+
+    static void AddLimitOptions(argparse::ArgumentParser& c) {
+        c.add_argument("--mem-limit")
+            .help("Memory limit of agent command and its children in MB, 0 is unlimited.")
+            .metavar("MB");
+        c.add_argument("--cpu-rate")
+            .help("CPU rate limit of agent command in percent, 0 is unlimited.")
+            .metavar("PERCENT");
+        c.add_argument("--proc-limit")
+            .help("Active process limit of agent command, 0 is unlimited.")
+            .metavar("COUNT");
+    }
+
+    static void AddSchedOptions(argparse::ArgumentParser& c) {
+        c.add_argument("--affinity")
+            .help("CPU affinity mask of agent command, 0 to inherit.")
+            .metavar("MASK");
+        c.add_argument("--numa")
+            .help("NUMA node of agent command, -1 to inherit.")
+            .metavar("NODE");
+        c.add_argument("--priority")
+            .help("Priority class: Idle|BelowNormal|Normal|AboveNormal|High|Realtime|Inherit.")
+            .metavar("CLASS");
+        c.add_argument("--mem-priority")
+            .help("Memory priority: VeryLow|Low|Medium|BelowNormal|Normal|Inherit.")
+            .metavar("LEVEL");
+        c.add_argument("--io-priority")
+            .help("I/O priority: VeryLow|Low|Normal|High|Inherit.")
+            .metavar("LEVEL");
     }
 
     static void AddUninstallArgument(argparse::ArgumentParser& c) {
@@ -144,6 +238,127 @@ private:
         c.add_argument("-fp", "--filter-path")
             .help("Filter commands by path.")
             .metavar("VALUE");
+        c.add_argument("-f", "--format")
+            .help("Output format: table|ndjson|csv|tsv.")
+            .default_value(std::string("table"))
+            .metavar("FORMAT");
+        c.add_argument("-c", "--columns")
+            .help("Comma separated columns: name,alias,type,state,pid,path,startup,sched,desc.")
+            .metavar("LIST");
+        c.add_argument("--no-broker")
+            .help("Query the SCM even when a broker is running.")
+            .default_value(false)
+            .implicit_value(true);
+        c.add_argument("--cached")
+            .help("Print the last snapshot at once, a detached copy refreshes it for the next run.")
+            .default_value(false)
+            .implicit_value(true);
+        c.add_argument("--refresh-cache")
+            .help("Walk the SCM into the snapshot cache and print nothing.")
+            .default_value(false)
+            .implicit_value(true);
+        c.add_argument("-w", "--watch")
+            .help("Keep the table on screen and redraw rows whose state changes.")
+            .default_value(false)
+            .implicit_value(true);
+        c.add_argument("-i", "--interval")
+            .help("Seconds between watch updates.")
+            .default_value(std::string("2"))
+            .metavar("SECONDS");
+    }
+
+    static void AddTopArgument(argparse::ArgumentParser& c) {
+        c.add_description("Show cpu, memory and I/O of running services.");
+        c.add_argument("-s", "--sort")
+            .help("Sort column: name|pid|cpu|mem|io|cpid|ccpu|cmem|cio.")
+            .default_value(std::string("cpu"))
+            .metavar("COLUMN");
+        c.add_argument("-i", "--interval")
+            .help("Seconds between samples.")
+            .default_value(std::string("1"))
+            .metavar("SECONDS");
+    }
+
+    static void AddBatchArgument(argparse::ArgumentParser& c) {
+        c.add_description("Run install/uninstall/start/stop/set-startup lines over one SCM connection.");
+        c.add_argument("-f", "--file")
+            .help("Batch file, - reads standard input.")
+            .default_value(std::string("-"))
+            .metavar("PATH");
+        c.add_argument("-j", "--jobs")
+            .help("Services processed in parallel.")
+            .default_value(std::string("4"))
+            .metavar("COUNT");
+    }
+
+    static void AddApplyArgument(argparse::ArgumentParser& c) {
+        c.add_description("Install or change services to match a JSON manifest.");
+        c.add_argument("manifest")
+            .help("Manifest file.")
+            .metavar("PATH")
+            .required();
+        c.add_argument("--dry-run")
+            .help("Print the plan without changing anything.")
+            .default_value(false)
+            .implicit_value(true);
+        c.add_argument("-j", "--jobs")
+            .help("Services changed in parallel.")
+            .default_value(std::string("4"))
+            .metavar("COUNT");
+    }
+
+    static void AddBenchArgument(argparse::ArgumentParser& c) {
+        c.add_description("Measure latency percentiles of SCM and tool operations.");
+        c.add_argument("-s", "--scenarios")
+            .help("Comma separated: enumerate,config,list-cold,list-cached,list-cached-cold,open,log,utf8-to-ansi,ansi-to-utf8,agent-path,agent-path-cached,"
+                "apply,list-stream,list-stream-first,table-render,table-render-tabulate,watch-status,watch-full, startstop, list-broker "
+                "and ondemand-activate,ondemand-relay,ondemand-direct are opt-in.")
+            .default_value(std::string("enumerate,config,list-cold,list-cached,list-cached-cold,open,log,utf8-to-ansi,ansi-to-utf8,agent-path,agent-path-cached,"
+                "apply,list-stream,list-stream-first,table-render,table-render-tabulate,watch-status,watch-full"))
+            .metavar("LIST");
+        c.add_argument("-n", "--iterations")
+            .help("Operations per scenario.")
+            .default_value(std::string("50"))
+            .metavar("COUNT");
+        c.add_argument("--simulate")
+            .help("Run against an in-memory service table instead of the SCM.")
+            .default_value(false)
+            .implicit_value(true);
+        c.add_argument("--services")
+            .help("Services in the simulated table.")
+            .default_value(std::string("300"))
+            .metavar("COUNT");
+        c.add_argument("--echo")
+            .help("Echo connections on this loopback port, the command of the ondemand scenarios.")
+            .metavar("PORT");
+        c.add_argument("-f", "--format")
+            .help("Output format: table|ndjson|csv|tsv.")
+            .default_value(std::string("table"))
+            .metavar("FORMAT");
+    }
+
+    static void AddTailArgument(argparse::ArgumentParser& c) {
+        c.add_description("Show the last lines of agent command log.");
+        c.add_argument("name")
+            .help("Service name.")
+            .metavar("NAME")
+            .required();
+        c.add_argument("-n", "--lines")
+            .help("Number of lines.")
+            .default_value(std::string("20"))
+            .metavar("COUNT");
+    }
+
+    static void AddBrokerArgument(argparse::ArgumentParser& c) {
+        c.add_description("Serve a live service snapshot to list, tail and GUI over a local pipe.");
+        c.add_argument("-i", "--interval")
+            .help("Status refresh interval in ms.")
+            .default_value(std::string("1000"))
+            .metavar("MS");
+        c.add_argument("--config-interval")
+            .help("Config refresh interval in ms, creation and deletion are notified at once.")
+            .default_value(std::string("30000"))
+            .metavar("MS");
     }
 
     static void AddAgentArgument(argparse::ArgumentParser& c) {
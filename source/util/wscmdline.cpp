@@ -0,0 +1,123 @@
+#include "util/wscmdline.h"
+
+static bool IsSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+void WSCommandLine::SkipSpace()
+{
+    while (position_ < cmdline_.size() && IsSpace(cmdline_[position_]))
+        position_++;
+}
+
+bool WSCommandLine::Next(std::string_view& arg)
+{
+    // The program name ends at the next quote when quoted, otherwise at the next space, escapes do not apply.
+    size_t start = position_;
+    if (hasProgram_) {
+        hasProgram_ = false;
+        if (position_ < cmdline_.size() && cmdline_[position_] == '"') {
+            size_t end = cmdline_.find('"', position_ + 1);
+            position_ = (end == std::string_view::npos) ? cmdline_.size() : end + 1;
+        } else {
+            while (position_ < cmdline_.size() && !IsSpace(cmdline_[position_]))
+                position_++;
+        }
+        arg = cmdline_.substr(start, position_ - start);
+        SkipSpace();
+        return true;
+    }
+
+    SkipSpace();
+    start = position_;
+    if (position_ >= cmdline_.size())
+        return false;
+
+    // qcount follows the Wine CommandLineToArgvW: odd means quoted, three quotes in a row emit one.
+    size_t bcount = 0;
+    int qcount = 0;
+    while (position_ < cmdline_.size()) {
+        char c = cmdline_[position_];
+        if (IsSpace(c) && qcount == 0)
+            break;
+
+        position_++;
+        if (c == '\\') {
+            bcount++;
+        } else if (c == '"') {
+            if ((bcount & 1) == 0)
+                qcount++;
+            bcount = 0;
+            while (position_ < cmdline_.size() && cmdline_[position_] == '"') {
+                qcount++;
+                position_++;
+            }
+            qcount %= 3;
+            if (qcount == 2)
+                qcount = 0;
+        } else {
+            bcount = 0;
+        }
+    }
+    arg = cmdline_.substr(start, position_ - start);
+    return true;
+}
+
+std::string_view WSCommandLine::GetRemainder()
+{
+    if (hasProgram_) {
+        std::string_view program;
+        Next(program);
+    }
+    SkipSpace();
+    return cmdline_.substr(position_);
+}
+
+std::string_view WSCommandLine::GetProgram(std::string_view arg)
+{
+    if (arg.empty() || arg[0] != '"')
+        return arg;
+    arg.remove_prefix(1);
+    if (!arg.empty() && arg.back() == '"')
+        arg.remove_suffix(1);
+    return arg;
+}
+
+std::string WSCommandLine::Unquote(std::string_view arg)
+{
+    // 2n backslashes and a quote give n backslashes, 2n+1 give n and a literal quote.
+    std::string value;
+    value.reserve(arg.size());
+    size_t bcount = 0;
+    int qcount = 0;
+    for (size_t i = 0; i < arg.size();) {
+        char c = arg[i++];
+        if (c == '\\') {
+            value += c;
+            bcount++;
+        } else if (c == '"') {
+            if ((bcount & 1) == 0) {
+                value.resize(value.size() - bcount / 2);
+                qcount++;
+            } else {
+                value.resize(value.size() - bcount / 2 - 1);
+                value += '"';
+            }
+            bcount = 0;
+            while (i < arg.size() && arg[i] == '"') {
+                if (++qcount == 3) {
+                    value += '"';
+                    qcount = 0;
+                }
+                i++;
+            }
+            if (qcount == 2)
+                qcount = 0;
+        } else {
+            value += c;
+            bcount = 0;
+        }
+    }
+    return value;
+}
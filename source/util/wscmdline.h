@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string_view>
+#include "util/wsutil.h"
+
+// Splits a command line by the CommandLineToArgvW rules, every argument is a slice of the input.
+class WSCommandLine final
+{
+public:
+    WSCommandLine(std::string_view cmdline, bool hasProgram = true)
+        : cmdline_(cmdline), position_(0), hasProgram_(hasProgram) {}
+
+    bool Next(std::string_view& arg);
+    std::string_view GetRemainder();
+
+    static std::string_view GetProgram(std::string_view arg);
+    static bool IsPlain(std::string_view arg) { return arg.find('"') == std::string_view::npos; }
+    static std::string Unquote(std::string_view arg);
+
+private:
+    void SkipSpace();
+
+private:
+    std::string_view cmdline_;
+    size_t position_;
+    bool hasProgram_;
+};
@@ -0,0 +1,60 @@
+#include <cmath>
+#include "util/wshist.h"
+
+static const int SubBucketBits = 8;
+static const size_t SubBucketNum = (size_t)1 << SubBucketBits;
+static const size_t HalfBucketNum = SubBucketNum / 2;
+
+WSHistogram::WSHistogram()
+    : counts_(SubBucketNum + (64 - SubBucketBits) * HalfBucketNum, 0)
+    , count_(0), min_(UINT64_MAX), max_(0), sum_(0)
+{
+}
+
+// Values below SubBucketNum are exact, above each power of two is split into HalfBucketNum buckets.
+size_t WSHistogram::GetIndex(uint64_t value)
+{
+    if (value < SubBucketNum)
+        return (size_t)value;
+
+    int msb = 0;
+    for (uint64_t v = value; v >>= 1;)
+        msb++;
+    int shift = msb - (SubBucketBits - 1);
+    return SubBucketNum + (shift - 1) * HalfBucketNum + (size_t)((value >> shift) - HalfBucketNum);
+}
+
+uint64_t WSHistogram::GetHighest(size_t index)
+{
+    if (index < SubBucketNum)
+        return index;
+
+    int shift = (int)((index - SubBucketNum) / HalfBucketNum) + 1;
+    uint64_t sub = (index - SubBucketNum) % HalfBucketNum + HalfBucketNum;
+    return ((sub + 1) << shift) - 1;
+}
+
+void WSHistogram::Record(uint64_t value)
+{
+    counts_[GetIndex(value)]++;
+    count_++;
+    sum_ += value;
+    min_ = (std::min)(min_, value);
+    max_ = (std::max)(max_, value);
+}
+
+uint64_t WSHistogram::GetPercentile(double percentile) const
+{
+    if (!count_)
+        return 0;
+
+    uint64_t target = (uint64_t)std::ceil(percentile / 100.0 * count_);
+    target = (std::min)((std::max)(target, (uint64_t)1), count_);
+    uint64_t total = 0;
+    for (size_t i = 0; i < counts_.size(); i++) {
+        total += counts_[i];
+        if (total >= target)
+            return (std::min)(GetHighest(i), max_);
+    }
+    return max_;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "util/wsutil.h"
+
+// Log-linear buckets in the HDR histogram style, a value keeps its top 8 bits so the error stays under 1%.
+class WSHistogram final
+{
+public:
+    WSHistogram();
+
+    void Record(uint64_t value);
+    uint64_t GetCount() const { return count_; }
+    uint64_t GetMin() const { return count_ ? min_ : 0; }
+    uint64_t GetMax() const { return max_; }
+    double GetMean() const { return count_ ? (double)sum_ / count_ : 0.0; }
+    uint64_t GetPercentile(double percentile) const;
+
+private:
+    static size_t GetIndex(uint64_t value);
+    static uint64_t GetHighest(size_t index);
+
+private:
+    std::vector<uint64_t> counts_;
+    uint64_t count_;
+    uint64_t min_;
+    uint64_t max_;
+    uint64_t sum_;
+};
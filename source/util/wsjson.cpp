@@ -0,0 +1,244 @@
+#include "util/wsjson.h"
+
+class WSJsonParser
+{
+public:
+    WSJsonParser(std::string_view text) : text_(text), offset_(0), depth_(0) {}
+
+    bool ParseValue(WSJson& value) {
+        SkipSpace();
+        if (offset_ >= text_.size())
+            return Fail("unexpected end");
+        if (++depth_ > 128)
+            return Fail("nested too deep");
+
+        bool isOK = false;
+        char c = text_[offset_];
+        if (c == '{') {
+            isOK = ParseObject(value);
+        } else if (c == '[') {
+            isOK = ParseArray(value);
+        } else if (c == '"') {
+            value.type_ = WSJson::Type_String;
+            isOK = ParseString(value.string_);
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
+            isOK = ParseNumber(value);
+        } else if (Match("true")) {
+            value.type_ = WSJson::Type_Bool;
+            value.bool_ = true;
+            isOK = true;
+        } else if (Match("false")) {
+            value.type_ = WSJson::Type_Bool;
+            isOK = true;
+        } else if (Match("null")) {
+            isOK = true;
+        } else {
+            isOK = Fail("unexpected character");
+        }
+        depth_--;
+        return isOK;
+    }
+
+    bool ParseEnd() {
+        SkipSpace();
+        return offset_ == text_.size() || Fail("trailing characters");
+    }
+
+    const std::string& GetError() const { return error_; }
+
+private:
+    bool ParseObject(WSJson& value) {
+        value.type_ = WSJson::Type_Object;
+        offset_++;
+        SkipSpace();
+        if (Peek('}'))
+            return true;
+
+        for (;;) {
+            std::string key;
+            SkipSpace();
+            if (!Peek('"', false) || !ParseString(key))
+                return Fail("expected key");
+            SkipSpace();
+            if (!Peek(':'))
+                return Fail("expected ':'");
+
+            WSJson item;
+            if (!ParseValue(item))
+                return false;
+            value.object_.emplace_back(std::move(key), std::move(item));
+
+            SkipSpace();
+            if (Peek('}'))
+                return true;
+            if (!Peek(','))
+                return Fail("expected ',' or '}'");
+        }
+    }
+
+    bool ParseArray(WSJson& value) {
+        value.type_ = WSJson::Type_Array;
+        offset_++;
+        SkipSpace();
+        if (Peek(']'))
+            return true;
+
+        for (;;) {
+            WSJson item;
+            if (!ParseValue(item))
+                return false;
+            value.array_.push_back(std::move(item));
+
+            SkipSpace();
+            if (Peek(']'))
+                return true;
+            if (!Peek(','))
+                return Fail("expected ',' or ']'");
+        }
+    }
+
+    bool ParseString(std::string& value) {
+        offset_++;
+        while (offset_ < text_.size()) {
+            char c = text_[offset_++];
+            if (c == '"')
+                return true;
+            if (c != '\\') {
+                value += c;
+                continue;
+            }
+
+            if (offset_ >= text_.size())
+                break;
+            c = text_[offset_++];
+            switch (c) {
+                case '"': value += '"'; break;
+                case '\\': value += '\\'; break;
+                case '/': value += '/'; break;
+                case 'b': value += '\b'; break;
+                case 'f': value += '\f'; break;
+                case 'n': value += '\n'; break;
+                case 'r': value += '\r'; break;
+                case 't': value += '\t'; break;
+                case 'u': {
+                    uint32_t codepoint;
+                    if (!ParseHex(codepoint))
+                        return false;
+                    if (codepoint >= 0xD800 && codepoint < 0xDC00) {
+                        uint32_t low;
+                        if (!Match("\\u") || !ParseHex(low) || low < 0xDC00 || low >= 0xE000)
+                            return Fail("bad surrogate pair");
+                        codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    AppendUtf8(value, codepoint);
+                    break;
+                }
+                default:
+                    return Fail("bad escape");
+            }
+        }
+        return Fail("unterminated string");
+    }
+
+    bool ParseNumber(WSJson& value) {
+        size_t start = offset_;
+        while (offset_ < text_.size() && strchr("+-0123456789.eE", text_[offset_]))
+            offset_++;
+
+        std::string number(text_.substr(start, offset_ - start));
+        char* end = nullptr;
+        value.type_ = WSJson::Type_Number;
+        value.number_ = strtod(number.c_str(), &end);
+        return (end && *end == '\0') || Fail("bad number");
+    }
+
+    bool ParseHex(uint32_t& codepoint) {
+        if (offset_ + 4 > text_.size())
+            return Fail("bad unicode escape");
+        codepoint = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = text_[offset_++];
+            codepoint <<= 4;
+            if (c >= '0' && c <= '9')
+                codepoint |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                codepoint |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                codepoint |= c - 'A' + 10;
+            else
+                return Fail("bad unicode escape");
+        }
+        return true;
+    }
+
+    static void AppendUtf8(std::string& value, uint32_t codepoint) {
+        if (codepoint < 0x80) {
+            value += (char)codepoint;
+        } else if (codepoint < 0x800) {
+            value += (char)(0xC0 | (codepoint >> 6));
+            value += (char)(0x80 | (codepoint & 0x3F));
+        } else if (codepoint < 0x10000) {
+            value += (char)(0xE0 | (codepoint >> 12));
+            value += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+            value += (char)(0x80 | (codepoint & 0x3F));
+        } else {
+            value += (char)(0xF0 | (codepoint >> 18));
+            value += (char)(0x80 | ((codepoint >> 12) & 0x3F));
+            value += (char)(0x80 | ((codepoint >> 6) & 0x3F));
+            value += (char)(0x80 | (codepoint & 0x3F));
+        }
+    }
+
+    void SkipSpace() {
+        while (offset_ < text_.size() && strchr(" \t\r\n", text_[offset_]))
+            offset_++;
+    }
+
+    bool Peek(char c, bool isConsumed = true) {
+        if (offset_ >= text_.size() || text_[offset_] != c)
+            return false;
+        if (isConsumed)
+            offset_++;
+        return true;
+    }
+
+    bool Match(const char* word) {
+        size_t size = strlen(word);
+        if (text_.substr(offset_, size) != word)
+            return false;
+        offset_ += size;
+        return true;
+    }
+
+    bool Fail(const char* reason) {
+        if (error_.empty())
+            error_ = std::string(reason) + " at offset " + std::to_string(offset_);
+        return false;
+    }
+
+private:
+    std::string_view text_;
+    size_t offset_;
+    int depth_;
+    std::string error_;
+};
+
+std::optional<WSJson> WSJson::Parse(std::string_view text, std::string& error)
+{
+    WSJson value;
+    WSJsonParser parser(text);
+    if (!parser.ParseValue(value) || !parser.ParseEnd()) {
+        error = parser.GetError();
+        return std::nullopt;
+    }
+    return value;
+}
+
+const WSJson* WSJson::Find(const std::string& key) const
+{
+    for (auto& [name, value] : object_) {
+        if (name == key)
+            return &value;
+    }
+    return nullptr;
+}
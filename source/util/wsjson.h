@@ -0,0 +1,38 @@
+#pragma once
+
+#include "util/wsutil.h"
+
+class WSJson final
+{
+public:
+    enum Type {
+        Type_Null,
+        Type_Bool,
+        Type_Number,
+        Type_String,
+        Type_Array,
+        Type_Object,
+    };
+
+    static std::optional<WSJson> Parse(std::string_view text, std::string& error);
+
+    WSJson() : type_(Type_Null), bool_(false), number_(0) {}
+
+    Type GetType() const { return type_; }
+    bool GetBool(bool defaultValue = false) const { return type_ == Type_Bool ? bool_ : defaultValue; }
+    double GetNumber(double defaultValue = 0) const { return type_ == Type_Number ? number_ : defaultValue; }
+    std::string GetString(const std::string& defaultValue = "") const { return type_ == Type_String ? string_ : defaultValue; }
+    const std::vector<WSJson>& GetArray() const { return array_; }
+    const std::vector<std::pair<std::string, WSJson>>& GetObject() const { return object_; }
+    const WSJson* Find(const std::string& key) const;
+
+private:
+    friend class WSJsonParser;
+
+    Type type_;
+    bool bool_;
+    double number_;
+    std::string string_;
+    std::vector<WSJson> array_;
+    std::vector<std::pair<std::string, WSJson>> object_;
+};
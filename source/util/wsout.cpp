@@ -0,0 +1,378 @@
+#include "util/wsout.h"
+
+WSRowWriter::WSRowWriter(Format format, const std::vector<std::string>& columns, FILE* out)
+    : format_(format)
+    , columns_(columns)
+    , out_(out)
+    , fieldIndex_(0)
+{
+    buffer_.reserve(4096);
+    field_.reserve(1024);
+}
+
+WSRowWriter::~WSRowWriter()
+{
+    Flush();
+}
+
+std::optional<WSRowWriter::Format> WSRowWriter::GetFormat(const std::string& format)
+{
+    if (format == "table")
+        return Format_Table;
+    else if (format == "ndjson")
+        return Format_NDJson;
+    else if (format == "csv")
+        return Format_Csv;
+    else if (format == "tsv")
+        return Format_Tsv;
+    else
+        return std::nullopt;
+}
+
+void WSRowWriter::WriteHeader()
+{
+    if (format_ != Format_Csv && format_ != Format_Tsv)
+        return;
+
+    BeginRow();
+    for (auto& column : columns_)
+        AddField(column);
+    EndRow();
+}
+
+void WSRowWriter::BeginRow()
+{
+    fieldIndex_ = 0;
+    if (format_ == Format_NDJson)
+        buffer_ += '{';
+}
+
+void WSRowWriter::AddField(std::string_view value, bool isAnsi)
+{
+    if (isAnsi) {
+        AppendAnsiToUtf8(field_, value);
+        value = field_;
+    }
+
+    BeginField();
+    if (format_ == Format_NDJson)
+        buffer_ += '"';
+    AppendEscaped(value);
+    if (format_ == Format_NDJson)
+        buffer_ += '"';
+    field_.clear();
+    fieldIndex_++;
+}
+
+void WSRowWriter::AddField(unsigned long value)
+{
+    char digits[16];
+    int size = snprintf(digits, sizeof(digits), "%lu", value);
+    BeginField();
+    buffer_.append(digits, size);
+    fieldIndex_++;
+}
+
+void WSRowWriter::AddField(double value, int precision)
+{
+    char digits[48];
+    int size = snprintf(digits, sizeof(digits), "%.*f", precision, value);
+    BeginField();
+    buffer_.append(digits, (std::min)(size, (int)sizeof(digits) - 1));
+    fieldIndex_++;
+}
+
+void WSRowWriter::AddFlag(bool value)
+{
+    BeginField();
+    if (format_ == Format_NDJson)
+        buffer_ += value ? "true" : "false";
+    else
+        buffer_ += value ? '1' : '0';
+    fieldIndex_++;
+}
+
+void WSRowWriter::EndRow()
+{
+    if (format_ == Format_NDJson)
+        buffer_ += '}';
+    buffer_ += '\n';
+    Flush();
+}
+
+void WSRowWriter::Flush()
+{
+    // One write per row so a pipe reader sees each service as soon as it is queried.
+    if (buffer_.empty())
+        return;
+
+    fwrite(buffer_.data(), 1, buffer_.size(), out_);
+    fflush(out_);
+    buffer_.clear();
+}
+
+void WSRowWriter::BeginField()
+{
+    if (format_ == Format_NDJson) {
+        if (fieldIndex_)
+            buffer_ += ',';
+        buffer_ += '"';
+        buffer_ += columns_[fieldIndex_];
+        buffer_ += "\":";
+    } else if (fieldIndex_) {
+        buffer_ += (format_ == Format_Tsv) ? '\t' : ',';
+    }
+}
+
+void WSRowWriter::AppendEscaped(std::string_view value)
+{
+    switch (format_) {
+        case Format_NDJson:
+            for (char c : value) {
+                switch (c) {
+                    case '"': buffer_ += "\\\""; break;
+                    case '\\': buffer_ += "\\\\"; break;
+                    case '\n': buffer_ += "\\n"; break;
+                    case '\r': buffer_ += "\\r"; break;
+                    case '\t': buffer_ += "\\t"; break;
+                    default:
+                        if ((unsigned char)c < 0x20) {
+                            char code[8];
+                            snprintf(code, sizeof(code), "\\u%04x", c);
+                            buffer_ += code;
+                        } else {
+                            buffer_ += c;
+                        }
+                }
+            }
+            break;
+        case Format_Csv:
+            if (value.find_first_of(",\"\r\n") == std::string_view::npos) {
+                buffer_.append(value.data(), value.size());
+            } else {
+                buffer_ += '"';
+                for (char c : value) {
+                    if (c == '"')
+                        buffer_ += '"';
+                    buffer_ += c;
+                }
+                buffer_ += '"';
+            }
+            break;
+        default:
+            for (char c : value)
+                buffer_ += (c == '\t' || c == '\r' || c == '\n') ? ' ' : c;
+            break;
+    }
+}
+
+static size_t DecodeUtf8(std::string_view utf8, size_t index, uint32_t& codepoint)
+{
+    unsigned char c = utf8[index];
+    size_t size = (c < 0x80) ? 1 : (c < 0xE0) ? 2 : (c < 0xF0) ? 3 : 4;
+    if (c >= 0x80 && c < 0xC0)
+        size = 1;
+    if (index + size > utf8.size())
+        size = utf8.size() - index;
+
+    codepoint = (size == 1) ? c : (c & (0x7F >> size));
+    for (size_t i = 1; i < size; i++)
+        codepoint = (codepoint << 6) | (utf8[index + i] & 0x3F);
+    return size;
+}
+
+static size_t GetCodepointWidth(uint32_t codepoint)
+{
+    if (codepoint >= 0x0300 && codepoint <= 0x036F)
+        return 0;
+    if ((codepoint >= 0x1100 && codepoint <= 0x115F)
+        || (codepoint >= 0x2E80 && codepoint <= 0xA4CF && codepoint != 0x303F)
+        || (codepoint >= 0xAC00 && codepoint <= 0xD7A3)
+        || (codepoint >= 0xF900 && codepoint <= 0xFAFF)
+        || (codepoint >= 0xFE30 && codepoint <= 0xFE4F)
+        || (codepoint >= 0xFF00 && codepoint <= 0xFF60)
+        || (codepoint >= 0xFFE0 && codepoint <= 0xFFE6)
+        || (codepoint >= 0x1F300 && codepoint <= 0x1F64F)
+        || (codepoint >= 0x1F900 && codepoint <= 0x1F9FF)
+        || (codepoint >= 0x20000 && codepoint <= 0x3FFFD))
+        return 2;
+    return 1;
+}
+
+WSTableWriter::WSTableWriter(const std::vector<std::string>& titles, const std::vector<size_t>& maxWidths, FILE* out)
+    : titles_(titles)
+    , maxWidths_(maxWidths)
+    , out_(out)
+    , hasColor_(false)
+    , isInPlace_(false)
+    , rowLimit_(SIZE_MAX)
+{
+    // Colored headers only when writing to a console that understands escape sequences.
+    DWORD mode = 0;
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (out_ == stdout && GetConsoleMode(console, &mode))
+        hasColor_ = SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+
+    AddRow();
+    for (auto& title : titles_)
+        AddCell(title);
+}
+
+size_t WSTableWriter::GetDisplayWidth(std::string_view utf8)
+{
+    size_t width = 0;
+    for (size_t i = 0; i < utf8.size();) {
+        if ((unsigned char)utf8[i] < 0x80) {
+            width++;
+            i++;
+            continue;
+        }
+
+        uint32_t codepoint;
+        i += DecodeUtf8(utf8, i, codepoint);
+        width += GetCodepointWidth(codepoint);
+    }
+    return width;
+}
+
+size_t WSTableWriter::GetWindowRowNum()
+{
+    // The visible window, not the scrollback buffer, 0 when stdout is not a console.
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &csbi))
+        return 0;
+    return (size_t)(csbi.srWindow.Bottom - csbi.srWindow.Top + 1);
+}
+
+void WSTableWriter::Reserve(size_t rowNum)
+{
+    cells_.reserve((rowNum + 1) * titles_.size());
+    arena_.reserve((rowNum + 1) * titles_.size() * 16);
+}
+
+void WSTableWriter::AddRow()
+{
+    // Pad a short row so every row keeps the same number of cells.
+    while (cells_.size() % titles_.size())
+        AddCell("");
+}
+
+void WSTableWriter::AddCell(std::string_view value, bool isAnsi)
+{
+    cells_.push_back(MakeCell(value, isAnsi));
+}
+
+void WSTableWriter::SetCell(size_t row, size_t column, std::string_view value, bool isAnsi)
+{
+    // The old text stays in the arena until the table is rebuilt.
+    cells_[row * titles_.size() + column] = MakeCell(value, isAnsi);
+}
+
+void WSTableWriter::Write()
+{
+    AddRow();
+    Layout();
+    // In place the frame overwrites the previous one line by line instead of clearing the screen.
+    const char* lineEnd = isInPlace_ ? "\033[K\n" : "\n";
+    for (size_t row = 0; row < GetShownRowNum(); row++) {
+        AppendRow(row);
+        buffer_ += lineEnd;
+        if (row == 0) {
+            for (size_t column = 0; column < widths_.size(); column++) {
+                if (column)
+                    buffer_ += "  ";
+                buffer_.append(widths_[column], '-');
+            }
+            buffer_ += lineEnd;
+        }
+    }
+    if (isInPlace_)
+        buffer_ += "\033[J";
+    Flush();
+}
+
+void WSTableWriter::Layout()
+{
+    size_t columnNum = titles_.size();
+    widths_.assign(columnNum, 0);
+    for (size_t i = 0; i < cells_.size(); i++) {
+        size_t column = i % columnNum;
+        widths_[column] = (std::max)(widths_[column], (size_t)cells_[i].width);
+    }
+
+    size_t lineSize = columnNum * 2;
+    for (size_t column = 0; column < columnNum; column++) {
+        if (column < maxWidths_.size() && maxWidths_[column])
+            widths_[column] = (std::min)(widths_[column], maxWidths_[column]);
+        lineSize += widths_[column] * 3;
+    }
+    buffer_.reserve(lineSize * (GetShownRowNum() + 1) + 32);
+}
+
+void WSTableWriter::AppendRow(size_t row)
+{
+    size_t columnNum = titles_.size();
+    bool isHeader = (row == 0);
+    if (isHeader && hasColor_)
+        buffer_ += "\033[1;33m";
+    for (size_t column = 0; column < columnNum; column++) {
+        if (column)
+            buffer_ += "  ";
+        AppendCell(cells_[row * columnNum + column], widths_[column]);
+    }
+
+    // Trailing spaces of the last column are dropped.
+    while (!buffer_.empty() && buffer_.back() == ' ')
+        buffer_.pop_back();
+    if (isHeader && hasColor_)
+        buffer_ += "\033[0m";
+}
+
+void WSTableWriter::Flush()
+{
+    fwrite(buffer_.data(), 1, buffer_.size(), out_);
+    fflush(out_);
+    buffer_.clear();
+}
+
+WSTableWriter::Cell WSTableWriter::MakeCell(std::string_view value, bool isAnsi)
+{
+    Cell cell;
+    cell.offset = (uint32_t)arena_.size();
+    if (isAnsi)
+        AppendAnsiToUtf8(arena_, value);
+    else
+        arena_.append(value.data(), value.size());
+    cell.size = (uint32_t)(arena_.size() - cell.offset);
+    cell.width = (uint32_t)GetDisplayWidth(std::string_view(arena_).substr(cell.offset, cell.size));
+    return cell;
+}
+
+void WSTableWriter::AppendCell(const Cell& cell, size_t width)
+{
+    std::string_view value = std::string_view(arena_).substr(cell.offset, cell.size);
+    if (cell.width <= width) {
+        buffer_.append(value.data(), value.size());
+        buffer_.append(width - cell.width, ' ');
+        return;
+    }
+
+    // Cut on a codepoint boundary and leave one column for the ellipsis.
+    size_t used = 0;
+    size_t i = 0;
+    while (i < value.size()) {
+        uint32_t codepoint;
+        size_t size = DecodeUtf8(value, i, codepoint);
+        size_t charWidth = GetCodepointWidth(codepoint);
+        if (used + charWidth + 1 > width)
+            break;
+        used += charWidth;
+        i += size;
+    }
+    buffer_.append(value.data(), i);
+    if (width) {
+        buffer_ += "\xE2\x80\xA6";
+        used++;
+    }
+    buffer_.append(width - used, ' ');
+}
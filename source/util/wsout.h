@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string_view>
+#include "util/wsutil.h"
+
+class WSRowWriter final
+{
+public:
+    enum Format {
+        Format_Table,
+        Format_NDJson,
+        Format_Csv,
+        Format_Tsv,
+    };
+
+    WSRowWriter(Format format, const std::vector<std::string>& columns, FILE* out = stdout);
+    ~WSRowWriter();
+
+    static std::optional<Format> GetFormat(const std::string& format);
+
+    void WriteHeader();
+    void BeginRow();
+    void AddField(std::string_view value, bool isAnsi = false);
+    void AddField(unsigned long value);
+    void AddField(double value, int precision);
+    void AddFlag(bool value);
+    void EndRow();
+    void Flush();
+
+private:
+    void BeginField();
+    void AppendEscaped(std::string_view value);
+
+private:
+    Format format_;
+    std::vector<std::string> columns_;
+    FILE* out_;
+    std::string buffer_;
+    std::string field_;
+    size_t fieldIndex_;
+};
+
+class WSTableWriter final
+{
+public:
+    WSTableWriter(const std::vector<std::string>& titles, const std::vector<size_t>& maxWidths, FILE* out = stdout);
+
+    static size_t GetDisplayWidth(std::string_view utf8);
+    static size_t GetWindowRowNum();
+
+    bool HasColor() const { return hasColor_; }
+    void SetColor(bool hasColor) { hasColor_ = hasColor; }
+    void SetInPlace(bool isInPlace) { isInPlace_ = isInPlace; }
+    void SetRowLimit(size_t rowLimit) { rowLimit_ = rowLimit; }
+    size_t GetRowNum() const { return cells_.size() / titles_.size(); }
+    size_t GetShownRowNum() const { return (std::min)(GetRowNum(), rowLimit_); }
+    void Reserve(size_t rowNum);
+    void AddRow();
+    void AddCell(std::string_view value, bool isAnsi = false);
+    void SetCell(size_t row, size_t column, std::string_view value, bool isAnsi = false);
+    void Write();
+
+    void Layout();
+    void Append(std::string_view text) { buffer_.append(text.data(), text.size()); }
+    void AppendRow(size_t row);
+    void Flush();
+
+private:
+    struct Cell {
+        uint32_t offset;
+        uint32_t size;
+        uint32_t width;
+    };
+
+    Cell MakeCell(std::string_view value, bool isAnsi);
+    void AppendCell(const Cell& cell, size_t width);
+
+private:
+    std::vector<std::string> titles_;
+    std::vector<size_t> maxWidths_;
+    FILE* out_;
+    bool hasColor_;
+    bool isInPlace_;
+    size_t rowLimit_;
+    std::string arena_;
+    std::vector<Cell> cells_;
+    std::vector<size_t> widths_;
+    std::string buffer_;
+};
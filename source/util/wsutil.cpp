@@ -183,6 +183,15 @@ std::string GetLogDirectory()
     return logDir.string();
 }
 
+std::string GetCacheDirectory()
+{
+    std::filesystem::path workDir(GetWorkDirectory());
+    std::filesystem::path subCache("cache");
+    std::filesystem::path cacheDir = workDir / subCache;
+    CreateDirectory(cacheDir.string().data(), NULL);
+    return cacheDir.string();
+}
+
 std::string GetProgramName()
 {
     char modulePath[MAX_PATH];
@@ -241,6 +250,28 @@ std::string AnsiToUtf8(const std::string& ansi)
     return result;
 }
 
+void AppendAnsiToUtf8(std::string& utf8, std::string_view ansi)
+{
+    // Most service strings are plain ASCII, which is the same in both code pages.
+    if (std::all_of(ansi.begin(), ansi.end(), [](char c) { return (unsigned char)c < 0x80; })) {
+        utf8.append(ansi.data(), ansi.size());
+        return;
+    }
+
+    thread_local std::vector<wchar_t> wide;
+    wide.resize(ansi.size());
+    int wideSize = ::MultiByteToWideChar(CP_ACP, 0, ansi.data(), (int)ansi.size(), wide.data(), (int)wide.size());
+    if (wideSize == 0)
+        throw std::runtime_error("Failed to convert ACP to wide-string.");
+
+    size_t offset = utf8.size();
+    utf8.resize(offset + wideSize * 3);
+    int utf8Size = ::WideCharToMultiByte(CP_UTF8, 0, wide.data(), wideSize, &utf8[offset], wideSize * 3, nullptr, nullptr);
+    if (utf8Size == 0)
+        throw std::runtime_error("Failed to convert wide-string to UTF8");
+    utf8.resize(offset + utf8Size);
+}
+
 void ForceKillProcess(DWORD processId)
 {
     HANDLE hProcess = OpenProcess(PROCESS_TERMINATE, FALSE, processId);
@@ -258,6 +289,177 @@ void ForceKillProcess(DWORD processId)
     CloseHandle(hProcess);
 }
 
+// I/O priority is only reachable through the native api (PROCESSINFOCLASS::ProcessIoPriority).
+#define PROCESS_INFO_IO_PRIORITY 33
+typedef LONG (WINAPI *NtSetInformationProcessProc)(HANDLE, ULONG, PVOID, ULONG);
+typedef LONG (WINAPI *NtQueryInformationProcessProc)(HANDLE, ULONG, PVOID, ULONG, PULONG);
+
+bool SetProcessSched(HANDLE process, const WSvcSched& sched)
+{
+    bool result = true;
+    DWORD_PTR affinityMask = (DWORD_PTR)sched.affinityMask;
+    if (sched.numaNode != WSvcSched::Inherit) {
+        ULONGLONG nodeMask = 0;
+        if (!GetNumaNodeProcessorMask((UCHAR)sched.numaNode, &nodeMask)) {
+            SPDLOG_ERROR("GetNumaNodeProcessorMask({}) failed! WinApi@", sched.numaNode);
+            result = false;
+        } else {
+            affinityMask = affinityMask ? (affinityMask & (DWORD_PTR)nodeMask) : (DWORD_PTR)nodeMask;
+        }
+    }
+
+    if (affinityMask && !SetProcessAffinityMask(process, affinityMask)) {
+        SPDLOG_ERROR("SetProcessAffinityMask(0X{:X}) failed! WinApi@", affinityMask);
+        result = false;
+    }
+
+    if (sched.priorityClass != WSvcSched::Inherit && !SetPriorityClass(process, sched.priorityClass)) {
+        SPDLOG_ERROR("SetPriorityClass({}) failed! WinApi@", WSvcSched::GetPriorityClass(sched.priorityClass));
+        result = false;
+    }
+
+    if (sched.memoryPriority != WSvcSched::Inherit) {
+        MEMORY_PRIORITY_INFORMATION mpi;
+        ZeroMemory(&mpi, sizeof(mpi));
+        mpi.MemoryPriority = sched.memoryPriority;
+        if (!SetProcessInformation(process, ProcessMemoryPriority, &mpi, sizeof(mpi))) {
+            SPDLOG_ERROR("SetProcessInformation({}) failed! WinApi@", WSvcSched::GetMemoryPriority(sched.memoryPriority));
+            result = false;
+        }
+    }
+
+    if (sched.ioPriority != WSvcSched::Inherit) {
+        auto ntSetInformationProcess = (NtSetInformationProcessProc)GetProcAddress(
+            GetModuleHandle("ntdll.dll"), "NtSetInformationProcess");
+        ULONG ioPriority = sched.ioPriority;
+        LONG status = ntSetInformationProcess
+            ? ntSetInformationProcess(process, PROCESS_INFO_IO_PRIORITY, &ioPriority, sizeof(ioPriority))
+            : -1;
+        if (status < 0) {
+            SPDLOG_ERROR("NtSetInformationProcess({}) failed with 0X{:X}",
+                WSvcSched::GetIoPriority(sched.ioPriority), (ULONG)status);
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+std::optional<WSvcSched> GetProcessSched(DWORD processId)
+{
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION, FALSE, processId);
+    if (!hProcess) {
+        SPDLOG_ERROR("Process:{} open failed! WinApi@", processId);
+        return std::nullopt;
+    }
+
+    WSvcSched sched;
+    DWORD_PTR processMask = 0, systemMask = 0;
+    if (GetProcessAffinityMask(hProcess, &processMask, &systemMask))
+        sched.affinityMask = processMask;
+
+    DWORD priorityClass = GetPriorityClass(hProcess);
+    if (priorityClass)
+        sched.priorityClass = priorityClass;
+
+    MEMORY_PRIORITY_INFORMATION mpi;
+    ZeroMemory(&mpi, sizeof(mpi));
+    if (GetProcessInformation(hProcess, ProcessMemoryPriority, &mpi, sizeof(mpi)))
+        sched.memoryPriority = mpi.MemoryPriority;
+
+    auto ntQueryInformationProcess = (NtQueryInformationProcessProc)GetProcAddress(
+        GetModuleHandle("ntdll.dll"), "NtQueryInformationProcess");
+    ULONG ioPriority = 0;
+    if (ntQueryInformationProcess
+        && ntQueryInformationProcess(hProcess, PROCESS_INFO_IO_PRIORITY, &ioPriority, sizeof(ioPriority), NULL) >= 0)
+        sched.ioPriority = ioPriority;
+
+    CloseHandle(hProcess);
+    return sched;
+}
+
+// Leading part of SYSTEM_PROCESS_INFORMATION up to the transfer counters.
+#define SYSTEM_INFO_PROCESS 5
+#define STATUS_INFO_LENGTH_MISMATCH ((LONG)0xC0000004L)
+typedef LONG (WINAPI *NtQuerySystemInformationProc)(ULONG, PVOID, ULONG, PULONG);
+
+struct WSSystemProcessInfo
+{
+    ULONG NextEntryOffset;
+    ULONG NumberOfThreads;
+    LARGE_INTEGER WorkingSetPrivateSize;
+    ULONG HardFaultCount;
+    ULONG NumberOfThreadsHighWatermark;
+    ULONGLONG CycleTime;
+    LARGE_INTEGER CreateTime;
+    LARGE_INTEGER UserTime;
+    LARGE_INTEGER KernelTime;
+    struct { USHORT Length; USHORT MaximumLength; wchar_t* Buffer; } ImageName;
+    LONG BasePriority;
+    HANDLE UniqueProcessId;
+    HANDLE InheritedFromUniqueProcessId;
+    ULONG HandleCount;
+    ULONG SessionId;
+    ULONG_PTR UniqueProcessKey;
+    SIZE_T PeakVirtualSize;
+    SIZE_T VirtualSize;
+    ULONG PageFaultCount;
+    SIZE_T PeakWorkingSetSize;
+    SIZE_T WorkingSetSize;
+    SIZE_T QuotaPeakPagedPoolUsage;
+    SIZE_T QuotaPagedPoolUsage;
+    SIZE_T QuotaPeakNonPagedPoolUsage;
+    SIZE_T QuotaNonPagedPoolUsage;
+    SIZE_T PagefileUsage;
+    SIZE_T PeakPagefileUsage;
+    SIZE_T PrivatePageCount;
+    LARGE_INTEGER ReadOperationCount;
+    LARGE_INTEGER WriteOperationCount;
+    LARGE_INTEGER OtherOperationCount;
+    LARGE_INTEGER ReadTransferCount;
+    LARGE_INTEGER WriteTransferCount;
+    LARGE_INTEGER OtherTransferCount;
+};
+
+bool SampleProcesses(std::unordered_map<unsigned long, WSProcessSample>& samples)
+{
+    // One native call returns the whole process table, no per-process handles are opened.
+    static auto ntQuerySystemInformation = (NtQuerySystemInformationProc)GetProcAddress(
+        GetModuleHandle("ntdll.dll"), "NtQuerySystemInformation");
+    if (!ntQuerySystemInformation) {
+        SPDLOG_ERROR("NtQuerySystemInformation not found! WinApi@");
+        return false;
+    }
+
+    thread_local std::vector<BYTE> buffer(1 << 20);
+    ULONG bufSize = 0;
+    LONG status;
+    while ((status = ntQuerySystemInformation(SYSTEM_INFO_PROCESS, buffer.data(), (ULONG)buffer.size(), &bufSize))
+        == STATUS_INFO_LENGTH_MISMATCH) {
+        buffer.resize((std::max)((size_t)bufSize, buffer.size()) + (64 << 10));
+    }
+    if (status < 0) {
+        SPDLOG_ERROR("NtQuerySystemInformation failed: {:#x}", (unsigned long)status);
+        return false;
+    }
+
+    samples.clear();
+    for (size_t offset = 0;;) {
+        auto info = (const WSSystemProcessInfo*)(buffer.data() + offset);
+        WSProcessSample sample;
+        sample.processId = (unsigned long)(ULONG_PTR)info->UniqueProcessId;
+        sample.cpuTime = info->UserTime.QuadPart + info->KernelTime.QuadPart;
+        sample.workingSet = info->WorkingSetSize;
+        sample.ioBytes = info->ReadTransferCount.QuadPart + info->WriteTransferCount.QuadPart
+            + info->OtherTransferCount.QuadPart;
+        samples[sample.processId] = sample;
+        if (!info->NextEntryOffset)
+            break;
+        offset += info->NextEntryOffset;
+    }
+    return true;
+}
+
 void PrintStackContext(CONTEXT* ctx)
 {
 #ifdef _DEBUG
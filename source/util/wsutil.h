@@ -1,5 +1,6 @@
 #pragma once
 
+#include <winsock2.h>
 #include <aclapi.h>
 #include <shlwapi.h>
 #include <strsafe.h>
@@ -7,6 +8,8 @@
 #ifdef _DEBUG
 #include <DbgHelp.h>
 #endif
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <codecvt>
 #include <filesystem>
@@ -18,6 +21,10 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "spdlog/spdlog.h"
 
@@ -189,8 +196,12 @@ struct WSvcConfig : public WSvcBase
             serviceStartName = qsc.lpServiceStartName;
         if (qsc.lpBinaryPathName)
             binaryPathName = qsc.lpBinaryPathName;
-        if (qsc.lpDependencies)
-            dependencies = qsc.lpDependencies;
+        // Dependencies come as a double null terminated list, kept '/' separated like sc.exe.
+        for (LPCSTR dependency = qsc.lpDependencies; dependency && *dependency; dependency += strlen(dependency) + 1) {
+            if (!dependencies.empty())
+                dependencies += '/';
+            dependencies += dependency;
+        }
         if (sd.lpDescription)
             description = sd.lpDescription;
         if (qsc.lpLoadOrderGroup)
@@ -237,15 +248,259 @@ struct WSvcConfig : public WSvcBase
     }
 };
 
+struct WSvcSched
+{
+    static constexpr unsigned long Inherit = 0xFFFFFFFF;
+
+    unsigned long long affinityMask = 0;
+    unsigned long numaNode = Inherit;
+    unsigned long priorityClass = Inherit;
+    unsigned long memoryPriority = Inherit;
+    unsigned long ioPriority = Inherit;
+
+    bool IsInherit() const {
+        return affinityMask == 0
+            && numaNode == Inherit
+            && priorityClass == Inherit
+            && memoryPriority == Inherit
+            && ioPriority == Inherit;
+    }
+
+    std::string ToString() const {
+        if (IsInherit())
+            return "Inherit";
+
+        std::stringstream ss;
+        if (affinityMask)
+            ss << "cpu=0x" << std::hex << affinityMask << std::dec << " ";
+        if (numaNode != Inherit)
+            ss << "numa=" << numaNode << " ";
+        if (priorityClass != Inherit)
+            ss << "prio=" << GetPriorityClass(priorityClass) << " ";
+        if (memoryPriority != Inherit)
+            ss << "mem=" << GetMemoryPriority(memoryPriority) << " ";
+        if (ioPriority != Inherit)
+            ss << "io=" << GetIoPriority(ioPriority) << " ";
+
+        std::string result = ss.str();
+        result.pop_back();
+        return result;
+    }
+
+    static std::string GetPriorityClass(unsigned long priorityClass) {
+        switch (priorityClass) {
+            case IDLE_PRIORITY_CLASS:
+                return "Idle";
+            case BELOW_NORMAL_PRIORITY_CLASS:
+                return "BelowNormal";
+            case NORMAL_PRIORITY_CLASS:
+                return "Normal";
+            case ABOVE_NORMAL_PRIORITY_CLASS:
+                return "AboveNormal";
+            case HIGH_PRIORITY_CLASS:
+                return "High";
+            case REALTIME_PRIORITY_CLASS:
+                return "Realtime";
+            default:
+                return "Inherit";
+        }
+    }
+
+    static unsigned long GetPriorityClass(const std::string& priorityClass) {
+        if (priorityClass == "Idle")
+            return IDLE_PRIORITY_CLASS;
+        else if (priorityClass == "BelowNormal")
+            return BELOW_NORMAL_PRIORITY_CLASS;
+        else if (priorityClass == "Normal")
+            return NORMAL_PRIORITY_CLASS;
+        else if (priorityClass == "AboveNormal")
+            return ABOVE_NORMAL_PRIORITY_CLASS;
+        else if (priorityClass == "High")
+            return HIGH_PRIORITY_CLASS;
+        else if (priorityClass == "Realtime")
+            return REALTIME_PRIORITY_CLASS;
+        else
+            return Inherit;
+    }
+
+    static std::string GetMemoryPriority(unsigned long memoryPriority) {
+        switch (memoryPriority) {
+            case MEMORY_PRIORITY_VERY_LOW:
+                return "VeryLow";
+            case MEMORY_PRIORITY_LOW:
+                return "Low";
+            case MEMORY_PRIORITY_MEDIUM:
+                return "Medium";
+            case MEMORY_PRIORITY_BELOW_NORMAL:
+                return "BelowNormal";
+            case MEMORY_PRIORITY_NORMAL:
+                return "Normal";
+            default:
+                return "Inherit";
+        }
+    }
+
+    static unsigned long GetMemoryPriority(const std::string& memoryPriority) {
+        if (memoryPriority == "VeryLow")
+            return MEMORY_PRIORITY_VERY_LOW;
+        else if (memoryPriority == "Low")
+            return MEMORY_PRIORITY_LOW;
+        else if (memoryPriority == "Medium")
+            return MEMORY_PRIORITY_MEDIUM;
+        else if (memoryPriority == "BelowNormal")
+            return MEMORY_PRIORITY_BELOW_NORMAL;
+        else if (memoryPriority == "Normal")
+            return MEMORY_PRIORITY_NORMAL;
+        else
+            return Inherit;
+    }
+
+    // Values of the IO_PRIORITY_HINT enumeration used by NtSetInformationProcess.
+    static std::string GetIoPriority(unsigned long ioPriority) {
+        switch (ioPriority) {
+            case 0:
+                return "VeryLow";
+            case 1:
+                return "Low";
+            case 2:
+                return "Normal";
+            case 3:
+                return "High";
+            default:
+                return "Inherit";
+        }
+    }
+
+    static unsigned long GetIoPriority(const std::string& ioPriority) {
+        if (ioPriority == "VeryLow")
+            return 0;
+        else if (ioPriority == "Low")
+            return 1;
+        else if (ioPriority == "Normal")
+            return 2;
+        else if (ioPriority == "High")
+            return 3;
+        else
+            return Inherit;
+    }
+};
+
+struct WSvcLimit
+{
+    unsigned long long memoryLimit = 0;  // bytes of the whole job, 0 is unlimited
+    unsigned long cpuRate = 0;           // percent of all cpus, 0 is unlimited
+    unsigned long processLimit = 0;      // active processes, 0 is unlimited
+
+    bool IsUnlimited() const {
+        return memoryLimit == 0 && cpuRate == 0 && processLimit == 0;
+    }
+
+    std::string ToString() const {
+        if (IsUnlimited())
+            return "Unlimited";
+
+        std::stringstream ss;
+        if (memoryLimit)
+            ss << "mem=" << (memoryLimit >> 20) << "MB ";
+        if (cpuRate)
+            ss << "cpu=" << cpuRate << "% ";
+        if (processLimit)
+            ss << "procs=" << processLimit << " ";
+
+        std::string result = ss.str();
+        result.pop_back();
+        return result;
+    }
+};
+
+struct WSvcActivation
+{
+    unsigned long listenPort = 0;    // agent listens on 127.0.0.1, 0 keeps command always running
+    unsigned long targetPort = 0;    // command listens on 127.0.0.1
+    unsigned long idleTimeout = 0;   // seconds without connection before stopping command, 0 is never
+
+    bool IsOnDemand() const {
+        return listenPort != 0 && targetPort != 0;
+    }
+
+    std::string ToString() const {
+        if (!IsOnDemand())
+            return "Always";
+
+        std::stringstream ss;
+        ss << "listen=" << listenPort << " target=" << targetPort;
+        if (idleTimeout)
+            ss << " idle=" << idleTimeout << "s";
+        return ss.str();
+    }
+};
+
+// A listening port cannot mark readiness, the standby runs the same command and the active instance holds the port.
+struct WSvcStandby
+{
+    bool enabled = false;            // keep a warmed second instance of command
+    std::string readyFile;           // standby is ready once this file exists
+    std::string readyMarker;         // or once it prints this text to stdout
+    unsigned long readyTimeout = 120; // seconds before an unready standby is respawned
+
+    std::string ToString() const {
+        if (!enabled)
+            return "Off";
+
+        std::stringstream ss;
+        ss << "On";
+        if (!readyFile.empty())
+            ss << " file=" << readyFile;
+        if (!readyMarker.empty())
+            ss << " marker=\"" << readyMarker << "\"";
+        ss << " timeout=" << readyTimeout << "s";
+        return ss.str();
+    }
+};
+
+struct WSvcUsage
+{
+    unsigned long long cpuTime = 0;      // user + kernel time in 100ns
+    unsigned long long peakMemory = 0;   // bytes committed by the whole job
+    unsigned long long readBytes = 0;
+    unsigned long long writeBytes = 0;
+    unsigned long activeProcesses = 0;
+    unsigned long limitHits = 0;
+
+    std::string ToString() const {
+        std::stringstream ss;
+        ss << "cpu=" << (cpuTime / 10000) << "ms"
+           << " peak=" << (peakMemory >> 20) << "MB"
+           << " read=" << (readBytes >> 10) << "KB"
+           << " write=" << (writeBytes >> 10) << "KB"
+           << " procs=" << activeProcesses
+           << " hits=" << limitHits;
+        return ss.str();
+    }
+};
+
+struct WSProcessSample
+{
+    unsigned long processId = 0;
+    unsigned long long cpuTime = 0;      // user + kernel time in 100ns
+    unsigned long long workingSet = 0;
+    unsigned long long ioBytes = 0;      // read + write + other transfer bytes
+};
+
 
 void InitSpdlog(bool isGui, bool enableFile);
 void WriteServiceLog(const std::string& svcName, const std::string& logContext);
 std::string GetWorkDirectory();
 std::string GetLogDirectory();
+std::string GetCacheDirectory();
 std::string GetProgramName();
 std::string Utf8ToAnsi(const std::string& utf8);
 std::string AnsiToUtf8(const std::string& ansi);
+void AppendAnsiToUtf8(std::string& utf8, std::string_view ansi);
 void ForceKillProcess(DWORD processId);
+bool SetProcessSched(HANDLE process, const WSvcSched& sched);
+std::optional<WSvcSched> GetProcessSched(DWORD processId);
+bool SampleProcesses(std::unordered_map<unsigned long, WSProcessSample>& samples);
 void PrintStackContext(CONTEXT* ctx);
 struct RtlContextException
 {